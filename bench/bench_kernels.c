@@ -0,0 +1,206 @@
+#include "bench_util.h"
+#include "body.h"
+#include "collision.h"
+#include "list.h"
+#include "polygon.h"
+#include "rng.h"
+#include "vector.h"
+#include <stdlib.h>
+
+// Elements in the lists benchmarked by the list_* kernels
+const size_t LIST_LENGTH = 1000;
+// Vectors in the array benchmarked by the vec_* kernels
+#define NUM_VECTORS 1024
+// Vertex counts of a box, an octagon and doodlejump's player
+const size_t SHAPE_SIZES[] = {4, 8, 62};
+const double SHAPE_RADIUS = 10;
+const rgb_color_t BENCH_COLOR = {0, 0, 0};
+
+/** Makes a regular polygon of the benchmark radius */
+list_t *make_polygon(size_t num_vertices, vector_t center) {
+  return bench_make_polygon(num_vertices, center, SHAPE_RADIUS);
+}
+
+void bench_list_add(void *aux, size_t iterations) {
+  int value;
+  for (size_t i = 0; i < iterations; i++) {
+    list_t *list = list_init(1, NULL);
+    for (size_t j = 0; j < LIST_LENGTH; j++) {
+      list_add(list, &value);
+    }
+    list_free(list);
+  }
+}
+
+/** Removes every element from the back, which needs no shifting */
+void bench_list_remove_back(void *aux, size_t iterations) {
+  list_t *source = aux;
+  for (size_t i = 0; i < iterations; i++) {
+    list_t *list = list_copy(source);
+    while (list_size(list) > 0) {
+      list_remove(list, list_size(list) - 1);
+    }
+    list_free(list);
+  }
+}
+
+/** Removes every element from the front, shifting the rest each time */
+void bench_list_remove_front(void *aux, size_t iterations) {
+  list_t *source = aux;
+  for (size_t i = 0; i < iterations; i++) {
+    list_t *list = list_copy(source);
+    while (list_size(list) > 0) {
+      list_remove(list, 0);
+    }
+    list_free(list);
+  }
+}
+
+void bench_list_copy(void *aux, size_t iterations) {
+  for (size_t i = 0; i < iterations; i++) {
+    list_free(list_copy(aux));
+  }
+}
+
+void bench_vec_add(void *aux, size_t iterations) {
+  vector_t *vectors = aux;
+  for (size_t i = 0; i < iterations; i++) {
+    vector_t sum = VEC_ZERO;
+    for (size_t j = 0; j < NUM_VECTORS; j++) {
+      sum = vec_add(sum, vectors[j]);
+    }
+    bench_consume(sum.x + sum.y);
+  }
+}
+
+void bench_vec_dot(void *aux, size_t iterations) {
+  vector_t *vectors = aux;
+  for (size_t i = 0; i < iterations; i++) {
+    double sum = 0;
+    for (size_t j = 1; j < NUM_VECTORS; j++) {
+      sum += vec_dot(vectors[j - 1], vectors[j]);
+    }
+    bench_consume(sum);
+  }
+}
+
+void bench_vec_rotate(void *aux, size_t iterations) {
+  vector_t *vectors = aux;
+  for (size_t i = 0; i < iterations; i++) {
+    double sum = 0;
+    for (size_t j = 0; j < NUM_VECTORS; j++) {
+      sum += vec_rotate(vectors[j], 0.5).x;
+    }
+    bench_consume(sum);
+  }
+}
+
+void bench_vec_norm(void *aux, size_t iterations) {
+  vector_t *vectors = aux;
+  for (size_t i = 0; i < iterations; i++) {
+    double sum = 0;
+    for (size_t j = 0; j < NUM_VECTORS; j++) {
+      sum += vec_norm(vectors[j]).x;
+    }
+    bench_consume(sum);
+  }
+}
+
+void bench_polygon_centroid(void *aux, size_t iterations) {
+  for (size_t i = 0; i < iterations; i++) {
+    bench_consume(polygon_centroid(aux).x);
+  }
+}
+
+/** Translates back and forth so the shape stays put across repetitions */
+void bench_polygon_translate(void *aux, size_t iterations) {
+  for (size_t i = 0; i < iterations; i++) {
+    polygon_translate(aux, (i & 1) ? (vector_t){-1, -1} : (vector_t){1, 1});
+  }
+}
+
+void bench_polygon_rotate(void *aux, size_t iterations) {
+  for (size_t i = 0; i < iterations; i++) {
+    polygon_rotate(aux, 0.01, VEC_ZERO);
+  }
+}
+
+/** Two shapes to test against each other */
+typedef struct shape_pair {
+  list_t *shape1;
+  list_t *shape2;
+} shape_pair_t;
+
+void bench_find_collision(void *aux, size_t iterations) {
+  shape_pair_t *pair = aux;
+  for (size_t i = 0; i < iterations; i++) {
+    bench_consume(find_collision(pair->shape1, pair->shape2).collided);
+  }
+}
+
+void bench_body_tick(void *aux, size_t iterations) {
+  for (size_t i = 0; i < iterations; i++) {
+    body_add_force(aux, (vector_t){1, 0});
+    body_tick(aux, 1e-3);
+  }
+}
+
+void run_list_benchmarks(void) {
+  int value;
+  list_t *list = list_init(LIST_LENGTH, NULL);
+  for (size_t i = 0; i < LIST_LENGTH; i++) {
+    list_add(list, &value);
+  }
+  bench("list_add", LIST_LENGTH, bench_list_add, NULL);
+  bench("list_remove_back", LIST_LENGTH, bench_list_remove_back, list);
+  bench("list_remove_front", LIST_LENGTH, bench_list_remove_front, list);
+  bench("list_copy", LIST_LENGTH, bench_list_copy, list);
+  list_free(list);
+}
+
+void run_vector_benchmarks(void) {
+  vector_t vectors[NUM_VECTORS];
+  rng_t rng;
+  rng_seed(&rng, 0);
+  for (size_t i = 0; i < NUM_VECTORS; i++) {
+    vectors[i] = (vector_t){rng_between(&rng, 1, 2), rng_between(&rng, 1, 2)};
+  }
+  bench("vec_add", NUM_VECTORS, bench_vec_add, vectors);
+  bench("vec_dot", NUM_VECTORS, bench_vec_dot, vectors);
+  bench("vec_rotate", NUM_VECTORS, bench_vec_rotate, vectors);
+  bench("vec_norm", NUM_VECTORS, bench_vec_norm, vectors);
+}
+
+void run_shape_benchmarks(size_t size) {
+  list_t *shape = make_polygon(size, VEC_ZERO);
+  bench("polygon_centroid", size, bench_polygon_centroid, shape);
+  bench("polygon_translate", size, bench_polygon_translate, shape);
+  bench("polygon_rotate", size, bench_polygon_rotate, shape);
+  list_free(shape);
+
+  // Overlapping shapes test every axis; separated ones can stop at the first
+  shape_pair_t overlapping = {make_polygon(size, VEC_ZERO),
+                              make_polygon(size, (vector_t){SHAPE_RADIUS, 0})};
+  bench("find_collision_overlapping", size, bench_find_collision, &overlapping);
+  shape_pair_t separated = {
+      make_polygon(size, VEC_ZERO),
+      make_polygon(size, (vector_t){4 * SHAPE_RADIUS, 0})};
+  bench("find_collision_separated", size, bench_find_collision, &separated);
+  list_free(overlapping.shape1);
+  list_free(overlapping.shape2);
+  list_free(separated.shape1);
+  list_free(separated.shape2);
+
+  body_t *body = body_init(make_polygon(size, VEC_ZERO), 1, BENCH_COLOR);
+  bench("body_tick", size, bench_body_tick, body);
+  body_free(body);
+}
+
+int main(void) {
+  bench_print_header(stdout);
+  run_list_benchmarks();
+  run_vector_benchmarks();
+  for (size_t i = 0; i < sizeof(SHAPE_SIZES) / sizeof(SHAPE_SIZES[0]); i++) {
+    run_shape_benchmarks(SHAPE_SIZES[i]);
+  }
+}
@@ -0,0 +1,459 @@
+#include "bench_util.h"
+#include "body.h"
+#include "collision.h"
+#include "forces.h"
+#include "list.h"
+#include "mem.h"
+#include "profiler.h"
+#include "scene.h"
+#include "vector.h"
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/**
+ * Headless versions of the demos, scaled up by one parameter each, to find
+ * where each subsystem stops scaling linearly. Each size runs in its own
+ * process, so the memory high-water mark belongs to that size alone.
+ *
+ * Usage: bin/bench_scenarios [scenario...]
+ * Set BENCH_TICKS to change the number of ticks run per size (default 300),
+ * and BENCH_INTEGRATOR to averaged_euler (default), semi_implicit_euler,
+ * velocity_verlet or rk4 to pick the scenes' integrator.
+ */
+
+#define NUM_SIZES 4
+
+const size_t DEFAULT_TICKS = 300;
+const double DT = 1e-2;
+const uint64_t SEED = 3;
+const vector_t WORLD_MIN = {0, 0};
+const vector_t WORLD_MAX = {1000, 1000};
+const size_t CIRCLE_POINTS = 16;
+const rgb_color_t SCENARIO_COLOR = {0, 0, 1};
+
+// nbodies
+const double STAR_RADIUS = 5;
+const double STAR_G = 100;
+// pegs
+const double PEG_RADIUS = 5;
+const double PEG_SPACING = 30;
+const double BALL_RADIUS = 8;
+const double BALL_ELASTICITY = 0.7;
+const double FALL_ACCELERATION = -100;
+// breakout
+const size_t BRICKS_PER_ROW = 10;
+const vector_t BRICK_SIZE = {90, 20};
+const vector_t BREAKOUT_BALL_VELOCITY = {300, 400};
+// spaceinvaders
+const size_t INVADERS_PER_ROW = 12;
+const double INVADER_RADIUS = 15;
+const size_t INVADER_SPEED = 100;
+const size_t INVADER_BUFFER = 50;
+const size_t TICKS_PER_BULLET = 10;
+const double BULLET_SPEED = 800;
+// pacman
+const double PACMAN_RADIUS = 30;
+const double PELLET_RADIUS = 3;
+const double PACMAN_ORBIT = 400;
+// damping
+const double SPRING_K = 50;
+const double DRAG_GAMMA = 2;
+// cloth
+const double CLOTH_SPACING = 10;
+const double CLOTH_STIFFNESS = 500;
+const double CLOTH_DAMPING = 1;
+
+typedef enum { INFO_OTHER, INFO_BULLET } body_info_t;
+
+// Indexed by integrator_t
+const char *INTEGRATOR_NAMES[] = {"averaged_euler", "semi_implicit_euler",
+                                  "velocity_verlet", "rk4"};
+
+/** One of the demos, rebuilt without drawing, at a given size */
+typedef struct scenario {
+  const char *name;
+  /** What the size parameter counts */
+  const char *param_name;
+  size_t sizes[NUM_SIZES];
+  void (*setup)(scene_t *scene, size_t n);
+  /** Called before each tick, e.g. to spawn bodies, or NULL */
+  void (*step)(scene_t *scene, size_t n, size_t tick);
+} scenario_t;
+
+/** What a child process reports for one size */
+typedef struct scenario_result {
+  size_t bodies;
+  size_t pairs;
+  double seconds;
+  long max_rss_kb;
+} scenario_result_t;
+
+double rand_between(scene_t *scene, double min, double max) {
+  return rng_between(scene_get_rng(scene), min, max);
+}
+
+vector_t rand_position(scene_t *scene) {
+  return (vector_t){rand_between(scene, WORLD_MIN.x, WORLD_MAX.x),
+                    rand_between(scene, WORLD_MIN.y, WORLD_MAX.y)};
+}
+
+body_t *make_circle(scene_t *scene, vector_t center, double radius,
+                    double mass) {
+  body_t *body = body_init(bench_make_polygon(CIRCLE_POINTS, center, radius),
+                           mass, SCENARIO_COLOR);
+  scene_add_body(scene, body);
+  return body;
+}
+
+body_t *make_box(scene_t *scene, vector_t center, vector_t size, double mass) {
+  const vector_t corners[] = {{-1, -1}, {1, -1}, {1, 1}, {-1, 1}};
+  list_t *shape = list_init(4, mem_free);
+  for (size_t i = 0; i < 4; i++) {
+    vector_t *vertex = mem_alloc(sizeof(vector_t));
+    assert(vertex);
+    *vertex = (vector_t){center.x + corners[i].x * size.x / 2,
+                         center.y + corners[i].y * size.y / 2};
+    list_add(shape, vertex);
+  }
+  body_t *body = body_init(shape, mass, SCENARIO_COLOR);
+  scene_add_body(scene, body);
+  return body;
+}
+
+/** Keeps bodies in the world by reflecting them off its edges */
+void reflect_in_world(scene_t *scene, size_t n, size_t tick) {
+  for (size_t i = 0; i < scene_bodies(scene); i++) {
+    body_t *body = scene_get_body(scene, i);
+    vector_t centroid = body_get_centroid(body);
+    vector_t velocity = body_get_velocity(body);
+    if ((centroid.x < WORLD_MIN.x && velocity.x < 0) ||
+        (centroid.x > WORLD_MAX.x && velocity.x > 0)) {
+      velocity.x = -velocity.x;
+    }
+    if ((centroid.y < WORLD_MIN.y && velocity.y < 0) ||
+        (centroid.y > WORLD_MAX.y && velocity.y > 0)) {
+      velocity.y = -velocity.y;
+    }
+    body_set_velocity(body, velocity);
+  }
+}
+
+void remove_second_body(body_t *body1, body_t *body2, vector_t axis,
+                        void *aux) {
+  body_remove(body2);
+}
+
+void setup_nbodies(scene_t *scene, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    make_circle(scene, rand_position(scene), STAR_RADIUS,
+                rand_between(scene, 1, 10));
+  }
+  // One force creator per pair, like the nbodies demo
+  for (size_t i = 0; i < n; i++) {
+    for (size_t j = i + 1; j < n; j++) {
+      create_newtonian_gravity_old(scene, STAR_G, scene_get_body(scene, i),
+                                   scene_get_body(scene, j));
+    }
+  }
+}
+
+void setup_pegs(scene_t *scene, size_t n) {
+  list_t *pegs = list_init(n * n, NULL);
+  for (size_t row = 0; row < n; row++) {
+    for (size_t col = 0; col < n; col++) {
+      // Offset every other row, like the pegs demo
+      vector_t center = {PEG_SPACING * (col + 1 + 0.5 * (row % 2)),
+                         PEG_SPACING * (row + 1)};
+      list_add(pegs, make_circle(scene, center, PEG_RADIUS, INFINITY));
+    }
+  }
+  for (size_t i = 0; i < n; i++) {
+    vector_t drop = {rand_between(scene, 0, PEG_SPACING * (n + 1)),
+                     PEG_SPACING * (n + 2)};
+    body_t *ball = make_circle(scene, drop, BALL_RADIUS, 1);
+    create_downward_gravity(scene, FALL_ACCELERATION, ball);
+    for (size_t j = 0; j < list_size(pegs); j++) {
+      create_physics_collision(scene, BALL_ELASTICITY, ball, list_get(pegs, j));
+    }
+  }
+  list_free(pegs);
+}
+
+void setup_breakout(scene_t *scene, size_t n) {
+  body_t *ball = make_circle(scene, (vector_t){WORLD_MAX.x / 2, BRICK_SIZE.y},
+                             BALL_RADIUS, 1);
+  body_set_velocity(ball, BREAKOUT_BALL_VELOCITY);
+  for (size_t row = 0; row < n; row++) {
+    for (size_t col = 0; col < BRICKS_PER_ROW; col++) {
+      vector_t center = {BRICK_SIZE.x * (col + 0.5) + col,
+                         WORLD_MAX.y - BRICK_SIZE.y * (row + 0.5) - row};
+      body_t *brick = make_box(scene, center, BRICK_SIZE, INFINITY);
+      create_physics_collision(scene, 1, ball, brick);
+      create_collision(scene, ball, brick, remove_second_body, NULL, NULL);
+    }
+  }
+}
+
+void setup_spaceinvaders(scene_t *scene, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    size_t row = i / INVADERS_PER_ROW, col = i % INVADERS_PER_ROW;
+    vector_t center = {INVADER_BUFFER + 3 * INVADER_RADIUS * col,
+                       WORLD_MAX.y - 3 * INVADER_RADIUS * (row + 1)};
+    body_t *invader = make_circle(scene, center, INVADER_RADIUS, 1);
+    create_horizontal_motion(scene, WORLD_MAX, INVADER_SPEED, INVADER_BUFFER,
+                             invader);
+  }
+}
+
+/** Fires a bullet at every invader regularly, and drops missed bullets */
+void step_spaceinvaders(scene_t *scene, size_t n, size_t tick) {
+  for (size_t i = 0; i < scene_bodies(scene); i++) {
+    body_t *body = scene_get_body(scene, i);
+    if (body_get_info(body) != NULL &&
+        body_get_centroid(body).y > WORLD_MAX.y) {
+      body_remove(body);
+    }
+  }
+  if (tick % TICKS_PER_BULLET != 0) {
+    return;
+  }
+  body_info_t *info = mem_alloc(sizeof(body_info_t));
+  assert(info);
+  *info = INFO_BULLET;
+  vector_t start = {rand_between(scene, WORLD_MIN.x, WORLD_MAX.x), WORLD_MIN.y};
+  body_t *bullet =
+      body_init_with_info(bench_make_polygon(4, start, PELLET_RADIUS), 1,
+                          SCENARIO_COLOR, info, mem_free, NULL);
+  body_set_velocity(bullet, (vector_t){0, BULLET_SPEED});
+  scene_add_body(scene, bullet);
+  for (size_t i = 0; i < scene_bodies(scene); i++) {
+    body_t *body = scene_get_body(scene, i);
+    if (body_get_info(body) == NULL && !body_is_removed(body)) {
+      create_destructive_collision(scene, bullet, body);
+    }
+  }
+}
+
+void setup_pacman(scene_t *scene, size_t n) {
+  body_t *pacman = make_circle(
+      scene, vec_add(vec_multiply(0.5, WORLD_MAX), (vector_t){PACMAN_ORBIT, 0}),
+      PACMAN_RADIUS, 1);
+  for (size_t i = 0; i < n; i++) {
+    body_t *pellet = make_circle(scene, rand_position(scene), PELLET_RADIUS, 1);
+    create_collision(scene, pacman, pellet, remove_second_body, NULL, NULL);
+  }
+}
+
+/** Steers pacman around a circle through the pellets */
+void step_pacman(scene_t *scene, size_t n, size_t tick) {
+  body_t *pacman = scene_get_body(scene, 0);
+  double angle = tick * DT;
+  body_set_velocity(pacman,
+                    vec_multiply(PACMAN_ORBIT, (vector_t){-sin(angle),
+                                                          cos(angle)}));
+}
+
+void setup_damping(scene_t *scene, size_t n) {
+  list_t *dragged = list_init(n, NULL);
+  for (size_t i = 0; i < n; i++) {
+    vector_t center = rand_position(scene);
+    body_t *anchor = make_circle(scene, center, STAR_RADIUS, INFINITY);
+    body_t *body = make_circle(
+        scene, vec_add(center, (vector_t){0, rand_between(scene, -50, 50)}),
+        STAR_RADIUS, 1);
+    list_t *spring = list_init(2, NULL);
+    list_add(spring, anchor);
+    list_add(spring, body);
+    create_spring(scene, SPRING_K, spring);
+    list_add(dragged, body);
+  }
+  create_drag(scene, DRAG_GAMMA, dragged);
+}
+
+void setup_gravity(scene_t *scene, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    body_t *body = make_circle(scene, rand_position(scene), STAR_RADIUS, 1);
+    create_downward_gravity(scene, FALL_ACCELERATION, body);
+  }
+}
+
+/** gravity, with one scene-wide field instead of a force creator per ball */
+void setup_gravity_field(scene_t *scene, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    make_circle(scene, rand_position(scene), STAR_RADIUS, 1);
+  }
+  scene_set_field(scene, 0,
+                  (scene_field_t){.acceleration = {0, FALL_ACCELERATION}});
+}
+
+void setup_bounce(scene_t *scene, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    body_t *body = make_circle(scene, rand_position(scene), STAR_RADIUS, 1);
+    body_set_velocity(body, (vector_t){rand_between(scene, -200, 200),
+                                       rand_between(scene, -200, 200)});
+  }
+}
+
+/** An n by n grid of points hanging from its top row by springs */
+void setup_cloth(scene_t *scene, size_t n) {
+  list_t *points = list_init(n * n, NULL);
+  spring_edge_t *edges = mem_alloc(2 * n * n * sizeof(spring_edge_t));
+  assert(edges);
+  size_t num_edges = 0;
+  for (size_t row = 0; row < n; row++) {
+    for (size_t column = 0; column < n; column++) {
+      vector_t center = {WORLD_MIN.x + CLOTH_SPACING * (column + 1),
+                         WORLD_MAX.y - CLOTH_SPACING * (row + 1)};
+      double mass = row == 0 ? INFINITY : 1;
+      body_t *point = make_box(scene, center, (vector_t){2, 2}, mass);
+      if (row > 0) {
+        create_downward_gravity(scene, FALL_ACCELERATION, point);
+      }
+      list_add(points, point);
+      size_t index = row * n + column;
+      if (column > 0) {
+        edges[num_edges++] = (spring_edge_t){index - 1, index, CLOTH_STIFFNESS,
+                                             CLOTH_SPACING, CLOTH_DAMPING};
+      }
+      if (row > 0) {
+        edges[num_edges++] = (spring_edge_t){index - n, index, CLOTH_STIFFNESS,
+                                             CLOTH_SPACING, CLOTH_DAMPING};
+      }
+    }
+  }
+  create_spring_network(scene, points, edges, num_edges);
+  mem_free(edges);
+}
+
+const scenario_t SCENARIOS[] = {
+    {"nbodies", "stars", {25, 50, 100, 200}, setup_nbodies, NULL},
+    {"pegs", "grid_size", {4, 8, 12, 16}, setup_pegs, reflect_in_world},
+    {"breakout", "brick_rows", {2, 4, 8, 16}, setup_breakout, reflect_in_world},
+    {"spaceinvaders", "invaders", {12, 24, 48, 96}, setup_spaceinvaders,
+     step_spaceinvaders},
+    {"pacman", "pellets", {50, 100, 200, 400}, setup_pacman, step_pacman},
+    {"damping", "springs", {100, 200, 400, 800}, setup_damping, NULL},
+    {"gravity", "balls", {100, 200, 400, 800}, setup_gravity, reflect_in_world},
+    {"gravity_field", "balls", {100, 200, 400, 800}, setup_gravity_field,
+     reflect_in_world},
+    {"bounce", "balls", {100, 200, 400, 800}, setup_bounce, reflect_in_world},
+    {"cloth", "grid_size", {16, 32, 64, 128}, setup_cloth, NULL},
+};
+
+/** Reads BENCH_INTEGRATOR, defaulting to the scene's default */
+integrator_t integrator_from_env(void) {
+  char *name = getenv("BENCH_INTEGRATOR");
+  size_t count = sizeof(INTEGRATOR_NAMES) / sizeof(INTEGRATOR_NAMES[0]);
+  for (size_t i = 0; name != NULL && i < count; i++) {
+    if (strcmp(name, INTEGRATOR_NAMES[i]) == 0) {
+      return i;
+    }
+  }
+  return INTEGRATOR_AVERAGED_EULER;
+}
+
+/** Runs one size of a scenario in the calling process */
+scenario_result_t run_scenario(const scenario_t *scenario, size_t n,
+                               size_t ticks) {
+  scene_t *scene = scene_init();
+  rng_seed(scene_get_rng(scene), SEED);
+  scene_set_integrator(scene, integrator_from_env());
+  scenario->setup(scene, n);
+  uint64_t start = profiler_now_ns();
+  for (size_t tick = 0; tick < ticks; tick++) {
+    if (scenario->step != NULL) {
+      scenario->step(scene, n, tick);
+    }
+    scene_tick(scene, DT);
+  }
+  scenario_result_t result;
+  result.seconds = (profiler_now_ns() - start) / 1e9;
+  result.bodies = scene_bodies(scene);
+  result.pairs = scene_get_collision_stats(scene).pairs_registered;
+  scene_free(scene);
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  result.max_rss_kb = usage.ru_maxrss;
+  return result;
+}
+
+/** Runs one size of a scenario in a child process */
+bool run_isolated(const scenario_t *scenario, size_t n, size_t ticks,
+                  scenario_result_t *result) {
+  int fds[2];
+  if (pipe(fds) != 0) {
+    return false;
+  }
+  pid_t pid = fork();
+  if (pid == 0) {
+    close(fds[0]);
+    scenario_result_t child_result = run_scenario(scenario, n, ticks);
+    ssize_t written = write(fds[1], &child_result, sizeof(child_result));
+    _exit(written == sizeof(child_result) ? 0 : 1);
+  }
+  close(fds[1]);
+  bool ok = pid > 0 && read(fds[0], result, sizeof(*result)) == sizeof(*result);
+  close(fds[0]);
+  int status = 0;
+  if (pid > 0) {
+    waitpid(pid, &status, 0);
+  }
+  return ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+bool is_selected(const char *name, int argc, char **argv) {
+  if (argc < 2) {
+    return true;
+  }
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], name) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int main(int argc, char **argv) {
+  size_t ticks = DEFAULT_TICKS;
+  char *ticks_env = getenv("BENCH_TICKS");
+  if (ticks_env != NULL && atoi(ticks_env) > 0) {
+    ticks = atoi(ticks_env);
+  }
+
+  printf("scenario,param,n,bodies,pairs,ticks,seconds,ticks_per_sec,"
+         "max_rss_kb,scaling_exponent\n");
+  for (size_t i = 0; i < sizeof(SCENARIOS) / sizeof(SCENARIOS[0]); i++) {
+    const scenario_t *scenario = &SCENARIOS[i];
+    if (!is_selected(scenario->name, argc, argv)) {
+      continue;
+    }
+    double last_seconds = 0;
+    for (size_t j = 0; j < NUM_SIZES; j++) {
+      size_t n = scenario->sizes[j];
+      scenario_result_t result;
+      if (!run_isolated(scenario, n, ticks, &result)) {
+        fprintf(stderr, "%s: size %zu failed\n", scenario->name, n);
+        break;
+      }
+      // Slope of log(time) against log(n) since the previous size:
+      // 1 is linear, 2 is quadratic
+      double exponent = NAN;
+      if (j > 0 && last_seconds > 0) {
+        exponent = log(result.seconds / last_seconds) /
+                   log((double)n / scenario->sizes[j - 1]);
+      }
+      printf("%s,%s,%zu,%zu,%zu,%zu,%.6f,%.1f,%ld,%.2f\n", scenario->name,
+             scenario->param_name, n, result.bodies, result.pairs, ticks,
+             result.seconds, ticks / result.seconds, result.max_rss_kb,
+             exponent);
+      fflush(stdout);
+      last_seconds = result.seconds;
+    }
+  }
+}
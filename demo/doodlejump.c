@@ -1,9 +1,14 @@
+#include "asset.h"
 #include "body.h"
 #include "collision.h"
+#include "env.h"
 #include "color.h"
 #include "forces.h"
 #include "list.h"
+#include "mem.h"
 #include "polygon.h"
+#include "profiler.h"
+#include "replay.h"
 #include "scene.h"
 #include "sdl_wrapper.h"
 #include "state.h"
@@ -32,6 +37,11 @@ typedef enum {
 
 // scene constants
 const double GRAVITY_CONST = -2500;
+// Only the player falls; monsters and bullets keep their speed
+const size_t FALLING_LAYER = 1;
+// Enough for the jetpacking player not to pass through monsters; platforms
+// and bullets use swept collisions instead
+const size_t MAX_SUBSTEPS = 4;
 const double SCROLL_THRESHOLD = 600;
 const double SPAWN_PLATFORM_THRESHOLD = 1800;
 const double SPAWN_OBJECT_THRESHOLD = 1500;
@@ -71,6 +81,11 @@ const double BULLET_SPEED = 1500;
 
 // blackhole constants
 const size_t BLACK_HOLE_BUFFER = 150;
+// Where the player starts being pulled in, and where they are lost
+const double BLACK_HOLE_PULL_RADIUS = 250;
+const double BLACK_HOLE_PULL = 2000;
+const double BLACK_HOLE_FALLOFF = 2;
+const double BLACK_HOLE_KILL_RADIUS = 70;
 
 // monster constants
 const size_t MONSTER_BUFFER = 60;
@@ -91,9 +106,25 @@ SDL_Rect TITLE_RECT = {0, 0, 330, 500};
 SDL_Rect SCORE_RECT = {720, 170, 200, 60};
 SDL_Rect HIGH_SCORE_RECT = {720, 250, 200, 40};
 
+// asset constants
+const char SCORE_FONT[] = "assets/GROCHES.ttf";
+const int SCORE_FONT_SIZE = 15;
+
 // game management constants
+const size_t BACKGROUND_INDEX = 0;
+const size_t TITLE_INDEX = 1;
 const size_t SCREEN_INDEX = 2;
 
+// Images the first frame can do without, shown once they have loaded
+typedef struct deferred_image {
+  size_t index;
+  const char *path;
+} deferred_image_t;
+const deferred_image_t DEFERRED_IMAGES[] = {
+  {BACKGROUND_INDEX, "assets/background.bmp"},
+  {TITLE_INDEX, "assets/sidetitle.bmp"}
+};
+
 typedef struct state {
   scene_t *scene;
   body_t *player;
@@ -104,33 +135,48 @@ typedef struct state {
   list_t *images;
   list_t *texts;
   TTF_Font *score_font;
+  // Whether the score font was opened, or failed to; it is tried only once,
+  // since without a renderer fonts never open
+  bool font_loaded;
   bool start_screen;
+  // The scene at the start of a game, saved by the first reset_game()
+  scene_snapshot_t *initial_scene;
+  // The most substeps each tick is split into
+  size_t max_substeps;
 } state_t;
 
-// bounces body1 off of body2 upon top border collision on body2
+// copies a jump multiplier, the aux of the player's collisions
+void *copy_multiplier(void *mult) {
+  double *copy = mem_alloc(sizeof(double));
+  assert(copy);
+  *copy = *(double *)mult;
+  return copy;
+}
+
+// bounces body1 off of body2 upon landing on top of body2;
+// body1 passes through body2 from below and the sides
 void vertical_collision_handler(body_t *body1, body_t *body2,
-                                vector_t axis, void *aux) {
+                                vector_t axis, double time, void *aux) {
   size_t *id = (size_t *)body_get_info(body1);                       
   if (*id == PLAYER_WITH_JETPACK) {
     return;
   }
-  list_t *shape1 = body_get_shape(body1);
-  list_t *shape2 = body_get_shape(body2);
   double *mag = (double *)aux;
-  collision_info_t col_info = find_collision(shape1, shape2);
-  free(list_get_data(shape1));
-  free(list_get_data(shape2));
-  free(shape1);
-  free(shape2);
-  if (body_get_velocity(body1).y < 0 && col_info.collided) {
-    vector_t curr_velocity = body_get_velocity(body1);
-    if (col_info.axis.y > 0) {
-      body_set_velocity(body1, vec_multiply(*mag,
-                        (vector_t){curr_velocity.x, PLAYER_JUMP_SPEED}));
-    }
+  vector_t curr_velocity = body_get_velocity(body1);
+  // axis points from body1 down towards body2 when landing on it
+  if (curr_velocity.y < 0 && axis.y < 0) {
+    body_set_velocity(body1, vec_multiply(*mag,
+                      (vector_t){curr_velocity.x, PLAYER_JUMP_SPEED}));
   }
 }
 
+// destroys a bullet and the monster it hits
+void bullet_impact_handler(body_t *bullet, body_t *monster, vector_t axis,
+                           double time, void *aux) {
+  body_remove(bullet);
+  body_remove(monster);
+}
+
 // handles settings for when player gets a jetpack boost
 void jetpack_collision_handler(body_t *body1, body_t *body2,
                                vector_t axis, void *aux) {
@@ -142,23 +188,23 @@ void jetpack_collision_handler(body_t *body1, body_t *body2,
   list_t *shape2 = body_get_shape(body2);
   double *mag = (double *)aux;
   collision_info_t col_info = find_collision(shape1, shape2);
-  free(list_get_data(shape1));
-  free(list_get_data(shape2));
-  free(shape1);
-  free(shape2);
+  mem_free(list_get_data(shape1));
+  mem_free(list_get_data(shape2));
+  mem_free(shape1);
+  mem_free(shape2);
   if (col_info.collided) {
     vector_t curr_velocity = body_get_velocity(body1);
     body_set_velocity(body1, vec_multiply(*mag,
                       (vector_t){curr_velocity.x, PLAYER_JUMP_SPEED}));
-    free(body_get_info(body1));
-    size_t *id = malloc(sizeof(size_t));
+    mem_free(body_get_info(body1));
+    size_t *id = mem_alloc(sizeof(size_t));
     assert(id);
     *id = PLAYER_WITH_JETPACK;
     body_set_info(body1, id);
     body_remove(body2);
     image_t *image = body_get_image(body1);
     SDL_FreeSurface(image->image);
-    image->image = SDL_LoadBMP("assets/red_alien.bmp");
+    image->image = asset_load_image("assets/red_alien.bmp");
   }
 }
 
@@ -166,9 +212,9 @@ void display_end_screen(state_t *state) {
   for(size_t i = 0; i < scene_bodies(state->scene); i++) {
     body_remove(scene_get_body(state->scene, i));
   }
-  image_t *losing_screen_img = malloc(sizeof(image_t));
+  image_t *losing_screen_img = mem_alloc(sizeof(image_t));
   assert(losing_screen_img);
-  losing_screen_img->image = SDL_LoadBMP("assets/losing_screen.bmp");
+  losing_screen_img->image = asset_load_image("assets/losing_screen.bmp");
   losing_screen_img->rect = IMAGE_RECT;
   list_add(state->images, losing_screen_img);
   state->game_over = true;
@@ -236,7 +282,7 @@ void bullet_init(state_t *state, vector_t velo) {
     body_t *curr_body = scene_get_body(state->scene, i);
     size_t *info = (size_t *)body_get_info(curr_body);
     if (*info == MONSTER) {
-      create_destructive_collision(state->scene, bullet, curr_body);
+      scene_add_swept_collision(state->scene, "bullet_impact_handler", bullet, curr_body, bullet_impact_handler, NULL, NULL, NULL);
     }
   }
   scene_add_body(state->scene, bullet);
@@ -305,14 +351,14 @@ void spawn_platforms(state_t *state, size_t configuration, bool init, size_t add
   scene_t *scene = state->scene;
   body_t *player = state->player;
   for (size_t i = 0; i < NUM_CONFIGURATIONS; i++) {
-    size_t move = rand();
+    size_t move = rng_below(scene_get_rng(scene), MOVING_PROPORTION);
     body_t *curr_platform = NULL;
     if (init) {
       curr_platform = generate_platform((vector_t){PLATFORM_CONFIGURATIONS[configuration][i].x, 
       PLATFORM_CONFIGURATIONS[configuration][i].y + additional_offset});
     }
     else {
-      if (move % MOVING_PROPORTION == 0) {
+      if (move == 0) {
         curr_platform = generate_blue_platform((vector_t){PLATFORM_CONFIGURATIONS[configuration][i].x,
         PLATFORM_CONFIGURATIONS[configuration][i].y + SPAWN_PLATFORM_THRESHOLD});
         create_horizontal_motion(scene, WINDOW, PLATFORM_SPEED, PLATFORM_BUFFER, curr_platform);
@@ -323,10 +369,10 @@ void spawn_platforms(state_t *state, size_t configuration, bool init, size_t add
       }
     }
     scene_add_body(scene, curr_platform);
-    double *mult = malloc(sizeof(double));
+    double *mult = mem_alloc(sizeof(double));
     assert(mult);
     *mult = PLATFORM_JUMP_MULTIPLIER;
-    create_collision(scene, player, curr_platform, vertical_collision_handler, mult, free);
+    scene_add_swept_collision(scene, "vertical_collision_handler", player, curr_platform, vertical_collision_handler, mult, mem_free, copy_multiplier);
   }
 }
 
@@ -352,21 +398,21 @@ bool should_spawn_platforms(state_t *state) {
 void spawn_object(state_t *state){
   body_t *platform = get_highest_platform(state);
   vector_t platform_pos = body_get_centroid(platform);
-  sprite_type_t type = OBJECT_TYPES[rand() % (sizeof(OBJECT_TYPES) / sizeof(OBJECT_TYPES[0]))];
+  sprite_type_t type = OBJECT_TYPES[rng_below(scene_get_rng(state->scene), sizeof(OBJECT_TYPES) / sizeof(OBJECT_TYPES[0]))];
   body_t *body;
   switch (type) {
     case SPRING:
       body = generate_spring((vector_t){.x = platform_pos.x, .y = platform_pos.y + SPRING_BUFFER});
       scene_add_body(state->scene, body);
-      double *mult = malloc(sizeof(double));
+      double *mult = mem_alloc(sizeof(double));
       assert(mult);
       *mult = SPRING_JUMP_MULTIPLIER;
-      create_collision(state->scene, state->player, body, vertical_collision_handler, mult, free);
+      scene_add_swept_collision(state->scene, "vertical_collision_handler", state->player, body, vertical_collision_handler, mult, mem_free, copy_multiplier);
       break;
     case MONSTER:
       body = generate_monster((vector_t){.x = platform_pos.x, .y = platform_pos.y + MONSTER_BUFFER});
       scene_add_body(state->scene, body);
-      create_collision(state->scene, state->player, body, loss_collision_handler, state, NULL);
+      create_named_collision(state->scene, "loss_collision_handler", state->player, body, loss_collision_handler, state, NULL, NULL);
       break;
     case BLACKHOLE:
       if (platform_pos.x > CENTER.x) {
@@ -375,15 +421,20 @@ void spawn_object(state_t *state){
         body = generate_blackhole((vector_t){.x = WINDOW.x - BLACK_HOLE_BUFFER, .y = platform_pos.y});
       }
       scene_add_body(state->scene, body);
-      create_collision(state->scene, state->player, body, loss_collision_handler, state, NULL);
+      radial_field_t pull = {.radius = BLACK_HOLE_PULL_RADIUS,
+                             .strength = BLACK_HOLE_PULL,
+                             .falloff = BLACK_HOLE_FALLOFF,
+                             .kill_radius = BLACK_HOLE_KILL_RADIUS,
+                             .layers = 1u << FALLING_LAYER};
+      scene_add_radial_field(state->scene, body, pull, loss_collision_handler, state, NULL, NULL);
       break;
     case JETPACK:
       body = generate_jetpack((vector_t){.x = platform_pos.x, .y = platform_pos.y + JETPACK_BUFFER});
       scene_add_body(state->scene, body);
-      double *jet_mult = malloc(sizeof(double));
+      double *jet_mult = mem_alloc(sizeof(double));
       assert(jet_mult);
       *jet_mult = JETPACK_JUMP_MULTIPLIER;
-      create_collision(state->scene, state->player, body, jetpack_collision_handler, jet_mult, free);
+      create_named_collision(state->scene, "jetpack_collision_handler", state->player, body, jetpack_collision_handler, jet_mult, mem_free, copy_multiplier);
       break;
     default:
       break;
@@ -391,17 +442,31 @@ void spawn_object(state_t *state){
 }
 
 void reset_game(state_t *state) {
-  
-  state->scene = scene_init();
+  // Carry the random numbers on from the last game instead of repeating them
+  rng_t rng = *scene_get_rng(state->scene);
   state->score = 0;
+  state->scrolled_since_last_spawn = SPAWN_OBJECT_THRESHOLD;
+  state->game_over = false;
+  if (state->initial_scene != NULL) {
+    // Every game starts the same way, so restore it instead of rebuilding it
+    scene_restore(state->scene, state->initial_scene);
+    *scene_get_rng(state->scene) = rng;
+    state->player = scene_get_body(state->scene, 0);
+    return;
+  }
+
+  scene_free(state->scene);
+  state->scene = scene_init();
+  scene_set_max_substeps(state->scene, state->max_substeps);
+  *scene_get_rng(state->scene) = rng;
 
   body_t *player = generate_player(PLAYER_INIT_LOCATION);
   state->player = player;
-  create_downward_gravity(state->scene, GRAVITY_CONST, player);
+  body_set_layer(player, FALLING_LAYER);
+  scene_set_field(state->scene, FALLING_LAYER,
+                  (scene_field_t){.acceleration = {0, GRAVITY_CONST}});
   scene_add_body(state->scene, player);
 
-  state->scrolled_since_last_spawn = SPAWN_OBJECT_THRESHOLD;
-
   //Initialization using spawn_platforms instead of harcoding initialization
   //Adds 3 platform configurations of 600 pixels each to beginning scene
   for (size_t i = 0; i < 3; i++) {
@@ -409,7 +474,7 @@ void reset_game(state_t *state) {
     //prevents instant loss
     size_t config = 0;
     if (i != 0) {
-      config = rand() % NUM_CONFIGURATIONS;
+      config = rng_below(scene_get_rng(state->scene), NUM_CONFIGURATIONS);
     }
     if (i == 1) {
       config = 2;
@@ -419,8 +484,7 @@ void reset_game(state_t *state) {
     }
     spawn_platforms(state, config, true, PLATFORM_CONFIG_SIZE * i);
   }
-
-  state->game_over = false;
+  state->initial_scene = scene_snapshot(state->scene);
 }
 
 void on_key(char key, key_event_type_t type, double held_time, void *status) {
@@ -428,10 +492,10 @@ void on_key(char key, key_event_type_t type, double held_time, void *status) {
   if (type == KEY_PRESSED && key == ' ') {
     if (state->start_screen) {
       state->start_screen = false;
-      list_remove(state->images, SCREEN_INDEX);
+      image_free(list_remove(state->images, SCREEN_INDEX));
       reset_game(state);
     } else if (state->game_over) {
-      list_remove(state->images, SCREEN_INDEX);
+      image_free(list_remove(state->images, SCREEN_INDEX));
       reset_game(state);
     }
     return;
@@ -483,42 +547,47 @@ state_t *emscripten_init() {
   vector_t max = WINDOW;
   sdl_init(min, max);
 
-  time_t t;
-  srand((unsigned)time(&t));
-
-  state_t *state = malloc(sizeof(state_t));
+  state_t *state = mem_alloc(sizeof(state_t));
   assert(state);
   state->scene = scene_init();
+  state->max_substeps = MAX_SUBSTEPS;
+  scene_set_max_substeps(state->scene, state->max_substeps);
+  // Seed from the replay being recorded or played back, if any
+  rng_seed(scene_get_rng(state->scene), replay_seed());
   state->texts = NULL;
   state->images = NULL;
   state->score = 0;
   state->high_score = 0;
-  state->score_font = TTF_OpenFont("assets/GROCHES.ttf", 15);
+  // Only the welcome screen holds up the first frame; the font, background
+  // and title are shown once loaded (see load_deferred_assets())
+  state->score_font = NULL;
+  state->font_loaded = false;
   state->texts = list_init(2, text_free);
   state->images = list_init(2, image_free);
   state->start_screen = true;
+  state->initial_scene = NULL;
   state->game_over = true;
 
   // background image
-  image_t *background_img = malloc(sizeof(image_t));
+  image_t *background_img = mem_alloc(sizeof(image_t));
   assert(background_img);
-  background_img->image = SDL_LoadBMP("assets/background.bmp");
+  background_img->image = NULL;
   background_img->rect = IMAGE_RECT;
   list_add(state->images, background_img);
 
   // side title
-  image_t *title_image = malloc(sizeof(image_t));
+  image_t *title_image = mem_alloc(sizeof(image_t));
   assert(title_image);
-  title_image->image = SDL_LoadBMP("assets/sidetitle.bmp");
+  title_image->image = NULL;
   title_image->rect = TITLE_RECT;
   list_add(state->images, title_image);
 
   // score text
-  text_t *score_text = malloc(sizeof(text_t));
+  text_t *score_text = mem_alloc(sizeof(text_t));
   assert(score_text);
   score_text->font = state->score_font;
   score_text->color = RED;
-  char *text = malloc(sizeof(char) * MAX_DIGITS);
+  char *text = mem_alloc(sizeof(char) * MAX_DIGITS);
   assert(text);
   snprintf(text, MAX_DIGITS, "Score: %zu\n", (size_t)(state->score));
   score_text->message_rect = SCORE_RECT;
@@ -526,11 +595,11 @@ state_t *emscripten_init() {
   list_add(state->texts, score_text);
 
   // high score text
-  text_t *high_score_text = malloc(sizeof(text_t));
+  text_t *high_score_text = mem_alloc(sizeof(text_t));
   assert(high_score_text);
   high_score_text->font = state->score_font;
   high_score_text->color = RED;
-  char *hs_text = malloc(sizeof(char) * MAX_DIGITS);
+  char *hs_text = mem_alloc(sizeof(char) * MAX_DIGITS);
   assert(hs_text);
   snprintf(hs_text, MAX_DIGITS, "High Score: %zu\n", (state->high_score));
   high_score_text->message_rect = HIGH_SCORE_RECT;
@@ -538,20 +607,42 @@ state_t *emscripten_init() {
   list_add(state->texts, high_score_text); 
 
   // start screen
-  image_t *start_image = malloc(sizeof(image_t));
+  image_t *start_image = mem_alloc(sizeof(image_t));
   assert(start_image);
-  start_image->image = SDL_LoadBMP("assets/welcome_screen.bmp");
+  start_image->image = asset_load_image("assets/welcome_screen.bmp");
   start_image->rect = IMAGE_RECT;
   list_add(state->images, start_image);
 
   return state;
 }
 
+/** Picks up the assets emscripten_init() left loading, once they are ready */
+void load_deferred_assets(state_t *state) {
+  if (!state->font_loaded && asset_is_ready(SCORE_FONT)) {
+    state->font_loaded = true;
+    state->score_font = asset_open_font(SCORE_FONT, SCORE_FONT_SIZE);
+    for (size_t i = 0; i < list_size(state->texts); i++) {
+      text_t *text = list_get(state->texts, i);
+      text->font = state->score_font;
+    }
+  }
+  size_t num_deferred = sizeof(DEFERRED_IMAGES) / sizeof(DEFERRED_IMAGES[0]);
+  for (size_t i = 0; i < num_deferred; i++) {
+    image_t *image = list_get(state->images, DEFERRED_IMAGES[i].index);
+    if (image->image == NULL && asset_is_ready(DEFERRED_IMAGES[i].path)) {
+      image->image = asset_load_image(DEFERRED_IMAGES[i].path);
+    }
+  }
+}
+
 void emscripten_main(state_t *state) {
+  PROFILE_ZONE("emscripten_main");
   scene_t *scene = state->scene;
+  load_deferred_assets(state);
   double dt = time_since_last_tick();
   sdl_on_key(on_key);
 
+  PROFILE_BEGIN(score_zone, "update_score");
   if (state->score > state->high_score) {
     state->high_score = state->score;
   }
@@ -559,9 +650,11 @@ void emscripten_main(state_t *state) {
   snprintf(score_text->text, MAX_DIGITS, "Score: %zu\n", (size_t)(state->score));
   text_t *high_score_text = list_get(state->texts, 1);
   snprintf(high_score_text->text, MAX_DIGITS, "High Score: %zu\n", (state->high_score));
+  PROFILE_END(score_zone);
   
   if (!state->game_over) {
     body_t *player = state->player;
+    PROFILE_BEGIN(boundary_zone, "boundaries_and_scroll");
     boundary_type_t boundary_detection = check_off_screen(state->player);
     if (boundary_detection == BOTTOM_BOUNDARY) {
       display_end_screen(state);
@@ -575,9 +668,11 @@ void emscripten_main(state_t *state) {
       state->scrolled_since_last_spawn += offset;
       state->score += offset / SCORE_SCALER;
     }
+    PROFILE_END(boundary_zone);
 
+    PROFILE_BEGIN(spawn_zone, "spawn");
     if (should_spawn_platforms(state)) {
-      spawn_platforms(state, rand() % NUM_CONFIGURATIONS, false, 0);  
+      spawn_platforms(state, rng_below(scene_get_rng(state->scene), NUM_CONFIGURATIONS), false, 0);  
     }
 
     if (state->scrolled_since_last_spawn > SPAWN_OBJECT_THRESHOLD) {
@@ -588,18 +683,19 @@ void emscripten_main(state_t *state) {
         spawn_object(state);
       }
     }
+    PROFILE_END(spawn_zone);
 
     size_t *player_id = (size_t *)body_get_info(player);
     vector_t player_velo = body_get_velocity(player);
     if (*player_id == PLAYER_WITH_JETPACK && player_velo.y < PLAYER_JUMP_SPEED) {
-      free(body_get_info(player));
-      size_t *p_id = malloc(sizeof(size_t));
+      mem_free(body_get_info(player));
+      size_t *p_id = mem_alloc(sizeof(size_t));
       assert(p_id);
       *p_id = PLAYER;
       body_set_info(player, p_id);
       image_t *image = body_get_image(player);
       SDL_FreeSurface(image->image);
-      image->image = SDL_LoadBMP("assets/alien.bmp");
+      image->image = asset_load_image("assets/alien.bmp");
     }
 
     size_t prev_monst = count_monsters(scene);
@@ -607,7 +703,9 @@ void emscripten_main(state_t *state) {
     size_t after_monst = count_monsters(scene);
     state->score += (prev_monst - after_monst) * MONSTER_BONUS;
     
+    PROFILE_BEGIN(clean_zone, "clean_scene");
     clean_scene(scene);
+    PROFILE_END(clean_zone);
   } else {
     scene_tick(scene, dt);    
   }
@@ -616,8 +714,205 @@ void emscripten_main(state_t *state) {
 
 // frees the memory associated with everything
 void emscripten_free(state_t *state) {
+  // CALLBACK_STATS=1 shows which force creators and handlers cost the most
+  if (getenv("CALLBACK_STATS") != NULL) {
+    scene_write_callback_stats(state->scene, stderr);
+  }
+  if (state->initial_scene != NULL) {
+    scene_snapshot_free(state->initial_scene);
+  }
   scene_free(state->scene);
   list_free(state->texts);
   list_free(state->images);
-  TTF_CloseFont(state->score_font);
+  if (state->score_font != NULL) {
+    TTF_CloseFont(state->score_font);
+  }
+  mem_free(state);
+}
+
+// environment constants
+const double ENV_TICK_DT = 1.0 / 60;
+// Observation offsets of the player and of each kind of nearby body
+const size_t ENV_PLAYER_FEATURES = 4;
+const size_t ENV_BODY_FEATURES = 3;
+typedef enum {
+  NEAR_PLATFORM,
+  NEAR_MONSTER,
+  NEAR_BLACKHOLE,
+  NUM_NEAR_KINDS
+} near_kind_t;
+
+// the nearest bodies of one kind, nearest first
+typedef struct nearest {
+  size_t count;
+  double distances[ENV_NEAREST];
+  vector_t offsets[ENV_NEAREST];
+} nearest_t;
+
+// inserts a body's offset from the player if it is among the nearest
+void nearest_insert(nearest_t *nearest, vector_t offset) {
+  double distance = vec_dot(offset, offset);
+  size_t i = nearest->count < ENV_NEAREST ? nearest->count++ : ENV_NEAREST;
+  while (i > 0 && nearest->distances[i - 1] > distance) {
+    if (i < ENV_NEAREST) {
+      nearest->distances[i] = nearest->distances[i - 1];
+      nearest->offsets[i] = nearest->offsets[i - 1];
+    }
+    i--;
+  }
+  if (i < ENV_NEAREST) {
+    nearest->distances[i] = distance;
+    nearest->offsets[i] = offset;
+  }
+}
+
+// writes the observation of a state, without allocating
+void env_observe(state_t *state, float *observation) {
+  for (size_t i = 0; i < ENV_OBSERVATION_SIZE; i++) {
+    observation[i] = 0;
+  }
+  // the player is removed with everything else once the game is over
+  if (state->game_over) {
+    return;
+  }
+  vector_t player_pos = body_get_centroid(state->player);
+  vector_t player_velo = body_get_velocity(state->player);
+  observation[0] = player_pos.x;
+  observation[1] = player_pos.y;
+  observation[2] = player_velo.x;
+  observation[3] = player_velo.y;
+
+  nearest_t nearest[NUM_NEAR_KINDS] = {{0}};
+  for (size_t i = 0; i < scene_bodies(state->scene); i++) {
+    body_t *body = scene_get_body(state->scene, i);
+    if (body_is_removed(body)) {
+      continue;
+    }
+    vector_t offset = vec_subtract(body_get_centroid(body), player_pos);
+    switch (*(size_t *)body_get_info(body)) {
+      case PLATFORM:
+      case MOVING_PLATFORM:
+        nearest_insert(&nearest[NEAR_PLATFORM], offset);
+        break;
+      case MONSTER:
+        nearest_insert(&nearest[NEAR_MONSTER], offset);
+        break;
+      case BLACKHOLE:
+        nearest_insert(&nearest[NEAR_BLACKHOLE], offset);
+        break;
+      default:
+        break;
+    }
+  }
+  for (size_t kind = 0; kind < NUM_NEAR_KINDS; kind++) {
+    for (size_t i = 0; i < nearest[kind].count; i++) {
+      float *features = &observation[ENV_PLAYER_FEATURES +
+                                     (kind * ENV_NEAREST + i) * ENV_BODY_FEATURES];
+      features[0] = nearest[kind].offsets[i].x;
+      features[1] = nearest[kind].offsets[i].y;
+      features[2] = 1;
+    }
+  }
+}
+
+state_t *env_init(uint64_t seed) {
+  replay_set_seed(seed);
+  sdl_set_fixed_dt(ENV_TICK_DT);
+  return emscripten_init();
+}
+
+void env_free(state_t *env) { emscripten_free(env); }
+
+void env_set_max_substeps(state_t *env, size_t max_substeps) {
+  env->max_substeps = max_substeps;
+  scene_set_max_substeps(env->scene, max_substeps);
+}
+
+void env_reset(state_t *env, float *observation) {
+  if (env->start_screen || env->game_over) {
+    // the same as pressing space on the start or losing screen
+    on_key(' ', KEY_PRESSED, 0, env);
+  } else {
+    reset_game(env);
+  }
+  env_observe(env, observation);
+}
+
+env_result_t env_step(state_t *env, env_action_t action, float *observation) {
+  assert(!env->game_over);
+  switch (action) {
+    case ENV_ACTION_NONE:
+      on_key(LEFT_ARROW, KEY_RELEASED, 0, env);
+      break;
+    case ENV_ACTION_LEFT:
+      on_key(LEFT_ARROW, KEY_PRESSED, 0, env);
+      break;
+    case ENV_ACTION_RIGHT:
+      on_key(RIGHT_ARROW, KEY_PRESSED, 0, env);
+      break;
+    case ENV_ACTION_FIRE_UP:
+      on_key('w', KEY_PRESSED, 0, env);
+      break;
+    case ENV_ACTION_FIRE_DOWN:
+      on_key('s', KEY_PRESSED, 0, env);
+      break;
+    case ENV_ACTION_FIRE_LEFT:
+      on_key('a', KEY_PRESSED, 0, env);
+      break;
+    case ENV_ACTION_FIRE_RIGHT:
+      on_key('d', KEY_PRESSED, 0, env);
+      break;
+    default:
+      break;
+  }
+  double score = env->score;
+  emscripten_main(env);
+  env_observe(env, observation);
+  return (env_result_t){.reward = env->score - score, .done = env->game_over};
+}
+
+typedef struct env_batch {
+  size_t count;
+  state_t **envs;
+} env_batch_t;
+
+env_batch_t *env_batch_init(size_t count, uint64_t seed) {
+  env_batch_t *batch = mem_alloc(sizeof(env_batch_t));
+  assert(batch);
+  batch->count = count;
+  batch->envs = mem_alloc(count * sizeof(state_t *));
+  assert(batch->envs);
+  for (size_t i = 0; i < count; i++) {
+    batch->envs[i] = env_init(seed + i);
+  }
+  return batch;
+}
+
+void env_batch_free(env_batch_t *batch) {
+  for (size_t i = 0; i < batch->count; i++) {
+    env_free(batch->envs[i]);
+  }
+  mem_free(batch->envs);
+  mem_free(batch);
+}
+
+size_t env_batch_size(env_batch_t *batch) { return batch->count; }
+
+void env_batch_reset(env_batch_t *batch, float *observations) {
+  for (size_t i = 0; i < batch->count; i++) {
+    env_reset(batch->envs[i], &observations[i * ENV_OBSERVATION_SIZE]);
+  }
+}
+
+void env_batch_step(env_batch_t *batch, const env_action_t *actions,
+                    float *observations, float *rewards, bool *dones) {
+  for (size_t i = 0; i < batch->count; i++) {
+    float *observation = &observations[i * ENV_OBSERVATION_SIZE];
+    env_result_t result = env_step(batch->envs[i], actions[i], observation);
+    rewards[i] = result.reward;
+    dones[i] = result.done;
+    if (result.done) {
+      env_reset(batch->envs[i], observation);
+    }
+  }
 }
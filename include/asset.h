@@ -0,0 +1,103 @@
+#ifndef __ASSET_H__
+#define __ASSET_H__
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Loads images and fonts from a packed asset archive, built offline by
+ * bin/asset_pack (see asset_pack.c and 'make assets').
+ *
+ * The archive holds every image already decoded and converted to the
+ * renderer's pixel format, plus the raw bytes of every font, behind an index
+ * of names. asset_open() maps the whole file into memory once; loading an
+ * asset after that only looks up its name and wraps the mapped bytes, so
+ * there is no per-file I/O, decoding or format conversion.
+ *
+ * Assets are named by their path, e.g. "assets/alien.bmp". When no archive is
+ * open, or a name is not in it, the asset is loaded from that path instead.
+ *
+ * asset_preload() loads a whole directory of assets on worker threads in the
+ * background. Loading a preloaded asset waits only for that asset, and
+ * asset_is_ready() tells whether it would wait at all, so a demo can block
+ * on what its first frame needs and pick up the rest as it arrives.
+ */
+
+/**
+ * The pixel format images are stored in: the format textures are created in,
+ * so SDL_CreateTextureFromSurface() can upload them without converting.
+ */
+#define ASSET_PIXEL_FORMAT SDL_PIXELFORMAT_ARGB8888
+
+/**
+ * Maps an archive into memory for every thread to load from.
+ * Call before loading any assets, and before starting threads that do.
+ *
+ * @param path the archive to map
+ * @return whether the archive could be mapped and has a valid header
+ */
+bool asset_open(const char *path);
+
+/**
+ * Waits for the preload workers, then releases preloaded assets and unmaps
+ * the open archive, if any. Every surface and font loaded before must be
+ * freed first, since they point into preloaded or mapped memory.
+ */
+void asset_close(void);
+
+/**
+ * Starts loading every image and font in a directory on worker threads.
+ * Call at most once, after asset_open() and before threads that load assets
+ * start. Without threads, e.g. on the web, each asset is instead loaded the
+ * first time it is asked for.
+ *
+ * @param directory the directory to load, e.g. "assets"
+ */
+void asset_preload(const char *directory);
+
+/**
+ * Checks whether loading an asset would wait for a worker thread.
+ *
+ * @param path the asset's name
+ * @return false if the asset is being or about to be preloaded,
+ *   true if it is loaded or will be loaded by the caller
+ */
+bool asset_is_ready(const char *path);
+
+/**
+ * Loads an image in ASSET_PIXEL_FORMAT. A surface from the archive or the
+ * preloaded images points into memory shared by every surface loaded for
+ * the same name, so it costs one small allocation; do not draw on it.
+ * Waits if the image is being preloaded.
+ *
+ * @param path the image's name, which is its path under the repository
+ * @return a surface to free with SDL_FreeSurface(), or NULL if not found
+ */
+SDL_Surface *asset_load_image(const char *path);
+
+/**
+ * Opens a font at a point size. A font from the archive or the preloaded
+ * fonts is read straight from memory. Waits if the font is being preloaded.
+ *
+ * @param path the font's name, which is its path under the repository
+ * @param size the point size
+ * @return a font to free with TTF_CloseFont(), or NULL if not found
+ */
+TTF_Font *asset_open_font(const char *path, int size);
+
+/**
+ * Writes an archive of images and fonts. Files ending in ".bmp" are decoded
+ * and converted to ASSET_PIXEL_FORMAT; anything else, e.g. a font, is stored
+ * as is. Run offline, since it does all the work asset_open() saves.
+ *
+ * @param archive_path the archive to write, replacing it
+ * @param paths the files to pack, which also become their names
+ * @param count the number of files
+ * @return whether every file was read and the archive was written
+ */
+bool asset_pack(const char *archive_path, const char *const *paths,
+                size_t count);
+
+#endif // #ifndef __ASSET_H__
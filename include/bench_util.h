@@ -0,0 +1,81 @@
+/** Common functions for benchmarks. */
+
+#ifndef __BENCH_UTIL_H__
+#define __BENCH_UTIL_H__
+
+#include "list.h"
+#include "vector.h"
+#include <stddef.h>
+#include <stdio.h>
+
+/**
+ * The code being measured. Should do its work `iterations` times.
+ * Takes in an auxiliary value that can store inputs prepared in advance.
+ */
+typedef void (*bench_func_t)(void *aux, size_t iterations);
+
+/**
+ * Statistics over the repetitions of one benchmark.
+ * Times are per iteration, in nanoseconds.
+ */
+typedef struct {
+  const char *name;
+  /** The size the benchmark was run at, e.g. the number of vertices */
+  size_t param;
+  size_t repetitions;
+  size_t iterations;
+  double min_ns;
+  double median_ns;
+  double mean_ns;
+  double p90_ns;
+  double max_ns;
+  double stddev_ns;
+} bench_result_t;
+
+/**
+ * Runs a benchmark.
+ * First picks an iteration count so that one repetition takes at least about
+ * a millisecond, then runs a few warmup repetitions that are discarded,
+ * then times BENCH_REPS (default 20) repetitions.
+ *
+ * @param name the benchmark's name, e.g. "find_collision"
+ * @param param the size the benchmark is run at, reported alongside it
+ * @param func the code to measure
+ * @param aux an auxiliary value to pass to func
+ * @return statistics over the timed repetitions
+ */
+bench_result_t bench_run(const char *name, size_t param, bench_func_t func,
+                         void *aux);
+
+/**
+ * Writes the CSV header matching bench_print_result().
+ */
+void bench_print_header(FILE *file);
+
+/**
+ * Writes a result as one CSV row.
+ */
+void bench_print_result(FILE *file, bench_result_t *result);
+
+/**
+ * Runs a benchmark and prints its result to stdout.
+ * Equivalent to bench_run() followed by bench_print_result().
+ */
+void bench(const char *name, size_t param, bench_func_t func, void *aux);
+
+/**
+ * Makes a regular polygon, e.g. to stand in for a body's shape.
+ *
+ * @param num_vertices the number of vertices
+ * @param center the center of the polygon
+ * @param radius the distance from the center to each vertex
+ * @return a list of vertices in counterclockwise order, which owns them
+ */
+list_t *bench_make_polygon(size_t num_vertices, vector_t center, double radius);
+
+/**
+ * Keeps the compiler from optimizing away a computed value.
+ */
+void bench_consume(double value);
+
+#endif // #ifndef __BENCH_UTIL_H__
@@ -15,6 +15,13 @@
  */
 typedef struct body body_t;
 
+/**
+ * A function that copies a body's info or a force creator's aux into new
+ * memory, which the value's freer can release, e.g. for scene_snapshot().
+ * Examples: copy_sprite_id
+ */
+typedef void *(*copy_func_t)(void *);
+
 /**
  * Initializes a body without any info.
  * Acts like body_init_with_info() where info and info_freer are NULL.
@@ -80,6 +87,14 @@ vector_t body_get_centroid(body_t *body);
  */
 vector_t body_get_velocity(body_t *body);
 
+/**
+ * Gets the current orientation of a body.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the angle last passed to body_set_rotation(), in radians
+ */
+double body_get_angle(body_t *body);
+
 /**
  * Gets the mass of a body.
  *
@@ -88,6 +103,53 @@ vector_t body_get_velocity(body_t *body);
  */
 double body_get_mass(body_t *body);
 
+/**
+ * Gets how thin a body is, e.g. to tell how far it can move in one step
+ * before another body could pass through it.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the smaller side of the body's bounding box (see polygon_min_extent())
+ */
+double body_get_extent(body_t *body);
+
+/**
+ * Gets the elasticity of a body's material.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the elasticity from body_set_elasticity(), or NAN if never set
+ */
+double body_get_elasticity(body_t *body);
+
+/**
+ * Sets the elasticity of a body's material, its "coefficient of restitution".
+ * A contact between two bodies bounces with the larger of their
+ * elasticities (see scene_add_contact()).
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param elasticity 0 for no bounce, up to 1 for a perfectly elastic bounce
+ */
+void body_set_elasticity(body_t *body, double elasticity);
+
+// The number of layers bodies can be in, e.g. to give each its own field
+#define BODY_LAYERS 8
+
+/**
+ * Gets which of its scene's force fields acts on a body.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the layer from body_set_layer(), or 0 if never set
+ */
+size_t body_get_layer(body_t *body);
+
+/**
+ * Moves a body to another layer, so that layer's field acts on it
+ * (see scene_set_field()).
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param layer the layer, less than BODY_LAYERS
+ */
+void body_set_layer(body_t *body, size_t layer);
+
 /**
  * Gets the display color of a body.
  *
@@ -182,6 +244,19 @@ void body_add_impulse(body_t *body, vector_t impulse);
  */
 void body_tick(body_t *body, double dt);
 
+/**
+ * Moves a body by the result of an integration step, like the end of
+ * body_tick(), for integrators that compute many bodies' steps at once.
+ * Resets the forces and impulses accumulated on the body.
+ *
+ * @param body the body to move
+ * @param dx how far to translate the body and its shape
+ * @param velocity the body's new velocity
+ * @param acceleration the body's new acceleration
+ */
+void body_apply_step(body_t *body, vector_t dx, vector_t velocity,
+                     vector_t acceleration);
+
 /**
  * Marks a body for removal--future calls to body_is_removed() will return true.
  * Does not free the body.
@@ -201,4 +276,66 @@ void body_remove(body_t *body);
  */
 bool body_is_removed(body_t *body);
 
+/**
+ * Everything about a body except its shape, info and image.
+ * body_state_t is defined here instead of body.c because it is passed
+ * *by value*, e.g. when scene_snapshot() saves bodies.
+ */
+typedef struct {
+  double mass;
+  double angle;
+  vector_t velocity;
+  vector_t acceleration;
+  vector_t force;
+  vector_t impulse;
+  rgb_color_t color;
+  vector_t centroid;
+  double elasticity;
+  size_t layer;
+  bool removed;
+} body_state_t;
+
+/**
+ * Gets a body's state.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the body's motion, pending forces and impulses, mass, material,
+ *   layer and color
+ */
+body_state_t body_get_state(body_t *body);
+
+/**
+ * Overwrites a body's state. Does not move its shape, so the state's
+ * centroid and angle must match the shape, e.g. both saved together.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param state the state to give the body
+ */
+void body_set_state(body_t *body, body_state_t state);
+
+/**
+ * Gets the function a body's info is freed with.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the info_freer passed to body_init_with_info(), possibly NULL
+ */
+free_func_t body_get_info_freer(body_t *body);
+
+/**
+ * Sets the function a body's info is copied with. A body that owns its info,
+ * i.e. has an info_freer, needs one to be saved by scene_snapshot().
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param info_copier a function that copies the info, or NULL
+ */
+void body_set_info_copier(body_t *body, copy_func_t info_copier);
+
+/**
+ * Gets the function a body's info is copied with.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the function passed to body_set_info_copier(), or NULL
+ */
+copy_func_t body_get_info_copier(body_t *body);
+
 #endif // #ifndef __BODY_H__
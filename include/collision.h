@@ -19,6 +19,11 @@ typedef struct {
      * If collided is false, this value is undefined.
      */
     vector_t axis;
+    /**
+     * The number of separating axes that were projected onto.
+     * If collided is false, the last of these separated the shapes.
+     */
+    size_t axes_tested;
 } collision_info_t;
 
 /**
@@ -34,4 +39,41 @@ typedef struct {
  */
 collision_info_t find_collision(list_t *shape1, list_t *shape2);
 
+/**
+ * Represents when two moving shapes first touch during a step, if they do.
+ */
+typedef struct {
+    /** Whether the shapes touch at any point during the step */
+    bool collided;
+    /**
+     * The fraction of the step at which they first touch, from 0 to 1.
+     * Shapes that already overlap at the start touch at time 0.
+     */
+    double time;
+    /**
+     * The contact normal: a unit vector pointing from the first shape towards
+     * the second, perpendicular to the edge they touch along.
+     * If collided is false, this value is undefined.
+     */
+    vector_t axis;
+} impact_info_t;
+
+/**
+ * Computes the time of impact of two convex polygons, each translated
+ * at a constant velocity over a step, with the separating axis theorem:
+ * on every axis, the shapes' projections must overlap at the same times.
+ * Unlike testing the shapes only where the step ends, this finds impacts
+ * that happen partway through, so fast shapes cannot tunnel through thin
+ * ones. Circles are polygons here, so this covers them too.
+ *
+ * @param shape1 the first shape, where the step starts
+ * @param motion1 how far the first shape moves during the step
+ * @param shape2 the second shape, where the step starts
+ * @param motion2 how far the second shape moves during the step
+ * @return whether the shapes touch during the step, and if so, when and
+ *   along which axis
+ */
+impact_info_t find_impact(list_t *shape1, vector_t motion1, list_t *shape2,
+                          vector_t motion2);
+
 #endif // #ifndef __COLLISION_H__
@@ -0,0 +1,156 @@
+#ifndef __ENV_H__
+#define __ENV_H__
+
+#include "state.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A reinforcement-learning style interface to a demo's state, for training
+ * and evaluating agents. Like state.h, it is implemented by the demo.
+ *
+ * An environment is a state_t advanced one fixed tick per env_step().
+ * Environments only simulate; run them on a thread whose sdl_context_t uses
+ * RENDER_BACKEND_NONE (see sdl_set_context()), one context per thread.
+ */
+
+/**
+ * The number of nearest bodies of each kind included in an observation.
+ */
+#define ENV_NEAREST 4
+
+/**
+ * The number of floats in an observation:
+ * the player's position and velocity (x, y, vx, vy), then for each of
+ * platforms, monsters and black holes, the ENV_NEAREST nearest ones as
+ * (dx, dy, present) relative to the player, nearest first.
+ * Missing bodies are written as (0, 0, 0). Distances are in scene units.
+ */
+#define ENV_OBSERVATION_SIZE (4 + 3 * 3 * ENV_NEAREST)
+
+/**
+ * The actions an agent can take each tick.
+ * ENV_ACTION_NONE stops moving sideways; the fire actions shoot a bullet
+ * without changing the player's movement.
+ */
+typedef enum {
+  ENV_ACTION_NONE,
+  ENV_ACTION_LEFT,
+  ENV_ACTION_RIGHT,
+  ENV_ACTION_FIRE_UP,
+  ENV_ACTION_FIRE_DOWN,
+  ENV_ACTION_FIRE_LEFT,
+  ENV_ACTION_FIRE_RIGHT,
+  ENV_NUM_ACTIONS
+} env_action_t;
+
+/**
+ * The outcome of one step.
+ */
+typedef struct {
+  /** The increase in score during the step */
+  float reward;
+  /** Whether the game ended during the step */
+  bool done;
+} env_result_t;
+
+/**
+ * Creates an environment. Also makes the calling thread's context use a
+ * fixed tick length, so every step advances the same simulated time.
+ * Call env_reset() before the first step.
+ *
+ * @param seed the seed for the game's random numbers
+ * @return the new environment
+ */
+state_t *env_init(uint64_t seed);
+
+/**
+ * Frees an environment.
+ *
+ * @param env an environment returned from env_init()
+ */
+void env_free(state_t *env);
+
+/**
+ * Sets the most substeps each tick is split into (see
+ * scene_set_max_substeps()). The game allows 4 unless this is called.
+ *
+ * @param env an environment returned from env_init()
+ * @param max_substeps the most substeps per tick, at least 1
+ */
+void env_set_max_substeps(state_t *env, size_t max_substeps);
+
+/**
+ * Starts a new game.
+ *
+ * @param env an environment returned from env_init()
+ * @param observation where to write the first ENV_OBSERVATION_SIZE floats
+ */
+void env_reset(state_t *env, float *observation);
+
+/**
+ * Takes an action and advances the game by one tick.
+ * Once a game is done, env_reset() must be called before stepping again.
+ *
+ * @param env an environment returned from env_init()
+ * @param action the action to take
+ * @param observation where to write the next ENV_OBSERVATION_SIZE floats
+ * @return the reward and whether the game ended
+ */
+env_result_t env_step(state_t *env, env_action_t action, float *observation);
+
+/**
+ * A fixed number of environments stepped together.
+ */
+typedef struct env_batch env_batch_t;
+
+/**
+ * Creates a batch of environments, seeded seed, seed + 1, ...
+ *
+ * @param count the number of environments
+ * @param seed the seed of the first environment
+ * @return the new batch
+ */
+env_batch_t *env_batch_init(size_t count, uint64_t seed);
+
+/**
+ * Frees a batch and its environments.
+ *
+ * @param batch a batch returned from env_batch_init()
+ */
+void env_batch_free(env_batch_t *batch);
+
+/**
+ * Gets the number of environments in a batch.
+ *
+ * @param batch a batch returned from env_batch_init()
+ * @return the number of environments
+ */
+size_t env_batch_size(env_batch_t *batch);
+
+/**
+ * Starts a new game in every environment.
+ *
+ * @param batch a batch returned from env_batch_init()
+ * @param observations where to write env_batch_size() observations,
+ *   one after another
+ */
+void env_batch_reset(env_batch_t *batch, float *observations);
+
+/**
+ * Steps every environment with its own action. An environment whose game
+ * ends is reset straight away, and its observation is the new game's first,
+ * so the batch can be stepped forever. Nothing is allocated per step.
+ *
+ * @param batch a batch returned from env_batch_init()
+ * @param actions one action per environment
+ * @param observations where to write env_batch_size() observations,
+ *   one after another
+ * @param rewards where to write one reward per environment
+ * @param dones where to write whether each environment's game ended
+ */
+void env_batch_step(env_batch_t *batch, const env_action_t *actions,
+                    float *observations, float *rewards, bool *dones);
+
+#endif // #ifndef __ENV_H__
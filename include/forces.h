@@ -46,8 +46,46 @@ void create_newtonian_gravity(scene_t *scene, double G, list_t *bodies);
  */
 void create_spring_old(scene_t *scene, double k, body_t *body1, body_t *body2);
 
+/**
+ * Adds a force creator to a scene that puts a zero-length spring between
+ * *every pair* of bodies in a list, so N bodies cost N * (N - 1) / 2 springs.
+ * To connect only some pairs, use create_spring_network().
+ *
+ * @param scene the scene containing the bodies
+ * @param k the Hooke's constant for every spring
+ * @param bodies the bodies to connect, which the scene takes ownership of
+ */
 void create_spring(scene_t *scene, double k, list_t *bodies);
 
+/** One spring in a network, between two bodies of its list */
+typedef struct spring_edge {
+  /** The index of one end in the network's list of bodies */
+  size_t body1;
+  /** The index of the other end, which must differ from body1 */
+  size_t body2;
+  /** The Hooke's constant */
+  double stiffness;
+  /** The distance between the ends at which the spring exerts no force */
+  double rest_length;
+  /** Resists the ends moving apart or together, like drag along the spring */
+  double damping;
+} spring_edge_t;
+
+/**
+ * Adds a force creator to a scene that applies springs between given pairs
+ * of bodies, e.g. the neighbouring points of a rope or cloth.
+ * The edges are stored grouped by body, in compressed sparse row form,
+ * so each tick evaluates them in one pass whose cost is linear in the number
+ * of springs rather than the number of pairs of bodies.
+ *
+ * @param scene the scene containing the bodies
+ * @param bodies the bodies the edges index, which the scene takes ownership of
+ * @param edges the springs, which are copied
+ * @param num_edges the number of springs
+ */
+void create_spring_network(scene_t *scene, list_t *bodies,
+                           const spring_edge_t *edges, size_t num_edges);
+
 /** @deprecated version of create_drag
  * 
 */
@@ -91,12 +129,33 @@ void create_horizontal_motion(scene_t *scene, vector_t window, size_t speed,
  * @param body2 the second body
  * @param handler a function to call whenever the bodies collide
  * @param aux an auxiliary value to pass to the handler
- * @param freer if non-NULL, a function to call in order to free aux
+ * @param freer if non-NULL, a function to call in order to free aux.
+ *   scene_snapshot() cannot copy such an aux; use create_named_collision()
+ *   with a copier in scenes that are saved.
  */
 void create_collision(scene_t *scene, body_t *body1, body_t *body2,
                       collision_handler_t handler, void *aux,
                       free_func_t freer);
 
+/**
+ * Like create_collision(), but records the cost of each call to the handler
+ * under the given name (see scene_add_named_bodies_force_creator()).
+ *
+ * @param scene the scene containing the bodies
+ * @param name the name to attribute calls to, e.g. the handler's name;
+ *   must outlive the scene
+ * @param body1 the first body
+ * @param body2 the second body
+ * @param handler a function to call whenever the bodies collide
+ * @param aux an auxiliary value to pass to the handler
+ * @param freer if non-NULL, a function to call in order to free aux
+ * @param copier if non-NULL, a function to copy aux with for scene_snapshot(),
+ *   which needs one if there is a freer
+ */
+void create_named_collision(scene_t *scene, const char *name, body_t *body1,
+                            body_t *body2, collision_handler_t handler,
+                            void *aux, free_func_t freer, copy_func_t copier);
+
 /**
  * Adds a force creator to a scene that destroys two bodies when they collide.
  * The bodies should be destroyed by calling body_remove().
@@ -110,18 +169,13 @@ void create_collision(scene_t *scene, body_t *body1, body_t *body2,
 void create_destructive_collision(scene_t *scene, body_t *body1, body_t *body2);
 
 /**
- * Adds a force creator to a scene that applies impulses
- * to resolve collisions between two bodies in the scene.
- * This should be represented as an on-collision callback
- * registered with create_collision().
- *
- * You may remember from project01 that you should avoid applying impulses
- * multiple times while the bodies are still colliding.
- * You should also have a special case that allows either body1 or body2
- * to have mass INFINITY, as this is useful for simulating walls.
+ * Makes two bodies in the scene bounce off each other, as a contact solved
+ * together with the scene's other contacts (see scene_add_contact()).
+ * Either body1 or body2 may have mass INFINITY, e.g. to simulate walls.
  *
  * @param scene the scene containing the bodies
- * @param elasticity the "coefficient of restitution" of the collision;
+ * @param elasticity the "coefficient of restitution" of the collision,
+ * used when neither body has an elasticity of its own;
  * 0 is a perfectly inelastic collision and 1 is a perfectly elastic collision
  * @param body1 the first body
  * @param body2 the second body
@@ -0,0 +1,115 @@
+#ifndef __FRAME_PACER_H__
+#define __FRAME_PACER_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * How a frame pacer decides when the next frame starts.
+ * PACING_TARGET sleeps until each frame's deadline at the target frame rate,
+ *   without relying on vsync.
+ * PACING_UNCAPPED starts the next frame immediately, simulating however much
+ *   real time has passed.
+ * PACING_HEADLESS starts the next frame immediately and advances a virtual
+ *   clock by exactly one frame period, so every frame runs the same ticks.
+ */
+typedef enum { PACING_TARGET, PACING_UNCAPPED, PACING_HEADLESS } pacing_mode_t;
+
+/**
+ * Runs the simulation at a fixed tick rate while pacing frames,
+ * and lowers the render rate when frames keep missing their deadlines.
+ */
+typedef struct frame_pacer frame_pacer_t;
+
+/**
+ * Telemetry gathered by a frame pacer since it was created.
+ */
+typedef struct {
+  /** Frames started with frame_pacer_begin_frame() */
+  size_t frames;
+  /** Fixed simulation ticks handed out */
+  size_t ticks;
+  /** Frames for which frame_pacer_should_render() returned true */
+  size_t rendered_frames;
+  /** Frames that finished after their deadline */
+  size_t late_frames;
+  /** Whole frame periods that passed without a frame starting */
+  size_t missed_frames;
+  /** Simulation ticks dropped because a frame fell too far behind */
+  size_t dropped_ticks;
+  /** The current render interval: one frame in this many is drawn */
+  size_t render_interval;
+  /** The longest time a frame took, in seconds */
+  double max_frame_time;
+} frame_pacer_stats_t;
+
+/**
+ * Allocates a frame pacer.
+ *
+ * @param mode how frames are paced
+ * @param target_fps the frame rate PACING_TARGET aims for,
+ *   and the virtual frame rate of PACING_HEADLESS
+ * @param tick_rate the fixed number of simulation ticks per second
+ * @return the new frame pacer
+ */
+frame_pacer_t *frame_pacer_init(pacing_mode_t mode, double target_fps,
+                                double tick_rate);
+
+/**
+ * Releases the memory allocated for a frame pacer.
+ *
+ * @param pacer a frame pacer returned from frame_pacer_init()
+ */
+void frame_pacer_free(frame_pacer_t *pacer);
+
+/**
+ * Reads the pacing mode requested by the FRAME_PACING environment variable
+ * ("target", "uncapped" or "headless").
+ *
+ * @return the requested mode, or PACING_TARGET if unset or unknown
+ */
+pacing_mode_t frame_pacer_mode_from_env(void);
+
+/**
+ * Starts a frame.
+ *
+ * @param pacer a frame pacer returned from frame_pacer_init()
+ * @return the number of fixed ticks to simulate during this frame (may be 0)
+ */
+size_t frame_pacer_begin_frame(frame_pacer_t *pacer);
+
+/**
+ * Gets the fixed length of a simulation tick.
+ *
+ * @param pacer a frame pacer returned from frame_pacer_init()
+ * @return 1 / tick_rate, in seconds
+ */
+double frame_pacer_tick_dt(frame_pacer_t *pacer);
+
+/**
+ * Returns whether the current frame should be drawn.
+ * While frames are running late, only one frame in every render interval is
+ * drawn; the simulation keeps running every tick regardless.
+ *
+ * @param pacer a frame pacer returned from frame_pacer_init()
+ * @return whether to render the frame started by frame_pacer_begin_frame()
+ */
+bool frame_pacer_should_render(frame_pacer_t *pacer);
+
+/**
+ * Finishes a frame: records whether it was late, adapts the render interval
+ * and, with PACING_TARGET, sleeps until the next frame's deadline.
+ *
+ * @param pacer a frame pacer returned from frame_pacer_init()
+ */
+void frame_pacer_end_frame(frame_pacer_t *pacer);
+
+/**
+ * Gets the telemetry gathered by a frame pacer.
+ *
+ * @param pacer a frame pacer returned from frame_pacer_init()
+ * @return the counts of rendered, late and missed frames
+ */
+frame_pacer_stats_t frame_pacer_get_stats(frame_pacer_t *pacer);
+
+#endif // #ifndef __FRAME_PACER_H__
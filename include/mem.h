@@ -0,0 +1,148 @@
+#ifndef __MEM_H__
+#define __MEM_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/**
+ * Allocation accounting for the library.
+ * All library, demo and benchmark code allocates through mem_alloc(),
+ * mem_calloc() and mem_realloc(), which record the call site of every
+ * allocation, and releases memory with mem_free().
+ *
+ * Example: find what the frame loop still allocates
+ * ```
+ * mem_tick_begin();
+ * emscripten_main(state);
+ * mem_tick_end();
+ * mem_report(stderr);
+ * ```
+ */
+
+#define MEM_STRINGIFY_INNER(x) #x
+#define MEM_STRINGIFY(x) MEM_STRINGIFY_INNER(x)
+/** A string literal naming the current line, used to attribute allocations */
+#define MEM_SITE __FILE__ ":" MEM_STRINGIFY(__LINE__)
+
+#define mem_alloc(size) mem_alloc_at((size), MEM_SITE)
+#define mem_calloc(count, size) mem_calloc_at((count), (size), MEM_SITE)
+#define mem_realloc(ptr, size) mem_realloc_at((ptr), (size), MEM_SITE)
+
+/**
+ * The functions mem_alloc() and friends allocate with.
+ * The library, the demos and the benchmarks allocate and release everything
+ * they pass each other through mem_alloc() and mem_free(), so the hooks can be
+ * any allocator, e.g. an arena. Memory must be released with the hooks it was
+ * allocated with, so set them before allocating anything.
+ */
+typedef struct {
+  void *(*malloc)(size_t size, void *aux);
+  void *(*realloc)(void *ptr, size_t size, void *aux);
+  void (*free)(void *ptr, void *aux);
+  /** Passed to each of the functions above */
+  void *aux;
+} mem_hooks_t;
+
+/**
+ * Allocation counts over some period.
+ */
+typedef struct {
+  /** Calls to mem_alloc(), mem_calloc() and mem_realloc() */
+  size_t allocations;
+  /** Bytes requested by those calls */
+  size_t bytes;
+  /** Calls to mem_free() with a non-NULL pointer */
+  size_t frees;
+} mem_stats_t;
+
+/**
+ * Replaces the allocator used by the library.
+ *
+ * @param hooks the functions to allocate with
+ */
+void mem_set_hooks(mem_hooks_t hooks);
+
+/**
+ * Restores the default hooks, which call malloc(), realloc() and free().
+ */
+void mem_reset_hooks(void);
+
+/**
+ * Allocates memory and records the allocation against a call site.
+ * Asserts that the memory was allocated. Use the mem_alloc() macro instead.
+ *
+ * @param size the number of bytes to allocate
+ * @param site a string literal naming the call site (see MEM_SITE)
+ * @return the allocated memory
+ */
+void *mem_alloc_at(size_t size, const char *site);
+
+/**
+ * Like mem_alloc_at(), but zeroes the memory. Use mem_calloc() instead.
+ */
+void *mem_calloc_at(size_t count, size_t size, const char *site);
+
+/**
+ * Resizes memory and records the allocation against a call site.
+ * Asserts that the memory was allocated. Use the mem_realloc() macro instead.
+ *
+ * @param ptr memory returned from mem_alloc() or friends, or NULL
+ * @param size the new size in bytes
+ * @param site a string literal naming the call site (see MEM_SITE)
+ * @return the resized memory
+ */
+void *mem_realloc_at(void *ptr, size_t size, const char *site);
+
+/**
+ * Releases memory returned from mem_alloc() or friends.
+ * Has the same signature as free(), so it can be used as a free_func_t.
+ *
+ * @param ptr the memory to release, or NULL
+ */
+void mem_free(void *ptr);
+
+/**
+ * Starts a tick on the calling thread, resetting its per-tick counts.
+ */
+void mem_tick_begin(void);
+
+/**
+ * Ends the calling thread's tick, making its counts available through
+ * mem_get_tick_stats().
+ */
+void mem_tick_end(void);
+
+/**
+ * Enables or disables steady-state checking.
+ * While enabled, any allocation between mem_tick_begin() and mem_tick_end()
+ * prints its call site and aborts, which makes a zero-allocation frame loop
+ * something that can be enforced.
+ *
+ * @param enabled whether allocating inside a tick should abort
+ */
+void mem_set_steady_state(bool enabled);
+
+/**
+ * Gets the counts of the calling thread's last finished tick.
+ *
+ * @return the allocations made between the last mem_tick_begin() and
+ *   mem_tick_end() on this thread
+ */
+mem_stats_t mem_get_tick_stats(void);
+
+/**
+ * Gets the counts across all threads since the program started.
+ *
+ * @return every allocation made through the library
+ */
+mem_stats_t mem_get_total_stats(void);
+
+/**
+ * Writes the total counts and one line per call site, busiest sites first.
+ *
+ * @param file where to write the report, e.g. stderr
+ */
+void mem_report(FILE *file);
+
+#endif // #ifndef __MEM_H__
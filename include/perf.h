@@ -0,0 +1,141 @@
+#ifndef __PERF_H__
+#define __PERF_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Hardware performance counters around the phases of a frame, for checking
+ * whether a change really reduced cache or branch misses.
+ *
+ * Counters are only compiled in when PERF_COUNTERS is defined
+ * (run `make PERF=1`), and are only read on Linux, through perf_event_open.
+ * Elsewhere, or when the kernel refuses access (see
+ * /proc/sys/kernel/perf_event_paranoid), the zones record nothing.
+ *
+ * Example:
+ * ```
+ * void scene_tick(scene_t *scene, double dt) {
+ *     PERF_ZONE("scene_tick"); // counts the rest of the enclosing block
+ *     ...
+ * }
+ * ```
+ *
+ * Each thread opens its own counter group the first time it enters a zone,
+ * so zones on the render thread count that thread's work.
+ */
+
+#ifdef PERF_COUNTERS
+#define PERF_CONCAT_INNER(a, b) a##b
+#define PERF_CONCAT(a, b) PERF_CONCAT_INNER(a, b)
+#define PERF_ZONE(name)                                                        \
+  perf_zone_t PERF_CONCAT(perf_zone_, __LINE__)                                \
+      __attribute__((cleanup(perf_zone_end))) = perf_zone_begin(name)
+#define PERF_BEGIN(zone, name) perf_zone_t zone = perf_zone_begin(name)
+#define PERF_END(zone) perf_zone_end(&zone)
+#else
+#define PERF_ZONE(name)
+#define PERF_BEGIN(zone, name)
+#define PERF_END(zone)
+#endif
+
+/**
+ * The events counted, in the order they are stored in perf_counts_t.
+ */
+typedef enum {
+  PERF_CYCLES,
+  PERF_INSTRUCTIONS,
+  PERF_CACHE_MISSES,
+  PERF_BRANCH_MISSES,
+  PERF_NUM_EVENTS
+} perf_event_t;
+
+/**
+ * Counter values, indexed by perf_event_t.
+ */
+typedef struct {
+  uint64_t counts[PERF_NUM_EVENTS];
+} perf_counts_t;
+
+/**
+ * A zone that has been entered but not yet left.
+ * Use the PERF_* macros rather than this type directly.
+ */
+typedef struct {
+  const char *name;
+  perf_counts_t start;
+  bool valid;
+} perf_zone_t;
+
+/**
+ * The totals of every zone entered under one name.
+ */
+typedef struct {
+  const char *name;
+  size_t count;
+  perf_counts_t total;
+} perf_phase_stats_t;
+
+/**
+ * Checks whether counters can be read on the calling thread,
+ * opening its counter group if needed.
+ *
+ * @return whether zones on this thread record anything
+ */
+bool perf_available(void);
+
+/**
+ * Enters a zone. Called by PERF_ZONE() and PERF_BEGIN().
+ *
+ * @param name the zone's name; must outlive the program's use of the counters,
+ *   e.g. a string literal
+ * @return the started zone
+ */
+perf_zone_t perf_zone_begin(const char *name);
+
+/**
+ * Leaves a zone and adds the events counted since it was entered
+ * to the totals of its name.
+ * Called by PERF_END() and when a PERF_ZONE() goes out of scope.
+ *
+ * @param zone the zone returned from perf_zone_begin()
+ */
+void perf_zone_end(perf_zone_t *zone);
+
+/**
+ * Gets the number of names zones have been recorded under.
+ *
+ * @return the number of phases, in order of first use
+ */
+size_t perf_phases(void);
+
+/**
+ * Gets the totals of the phase at an index.
+ * Asserts that the index is valid.
+ *
+ * @param index the index of the phase (starting at 0)
+ * @return a copy of the phase's totals
+ */
+perf_phase_stats_t perf_get_phase(size_t index);
+
+/**
+ * Gets the events counted by the most recent zone with a given name,
+ * e.g. "frame" for the last whole frame.
+ *
+ * @param name the zone's name
+ * @param counts where to copy the counts, if found
+ * @return whether a zone with the name has been recorded
+ */
+bool perf_get_last(const char *name, perf_counts_t *counts);
+
+/**
+ * Writes one CSV row per phase with its zone count, the mean of each event
+ * per zone, and instructions per cycle.
+ *
+ * @param path the CSV file to write
+ * @return whether the file was written successfully
+ */
+bool perf_write_csv(const char *path);
+
+#endif // #ifndef __PERF_H__
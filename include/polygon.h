@@ -46,4 +46,13 @@ void polygon_translate(list_t *polygon, vector_t translation);
  */
 void polygon_rotate(list_t *polygon, double angle, vector_t point);
 
+/**
+ * Computes how thin a polygon is: the smaller side of its axis-aligned
+ * bounding box.
+ *
+ * @param polygon the list of vertices that make up the polygon
+ * @return the smaller of the polygon's width and height
+ */
+double polygon_min_extent(list_t *polygon);
+
 #endif // #ifndef __POLYGON_H__
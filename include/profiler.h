@@ -0,0 +1,101 @@
+#ifndef __PROFILER_H__
+#define __PROFILER_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Lightweight timing zones for finding which phase of a frame is slow.
+ *
+ * Zones are only compiled in when PROFILE is defined (run `make PROFILE=1`).
+ * Otherwise the macros below expand to nothing, so they cost nothing.
+ *
+ * Example:
+ * ```
+ * void scene_tick(scene_t *scene, double dt) {
+ *     PROFILE_ZONE("scene_tick"); // times the rest of the enclosing block
+ *     PROFILE_BEGIN(forces, "forces");
+ *     ...
+ *     PROFILE_END(forces);
+ * }
+ * ```
+ *
+ * Each thread records its finished zones into its own ring buffer, which only
+ * that thread writes, so recording takes no locks. When a ring buffer fills up
+ * the oldest samples are overwritten.
+ */
+
+#ifdef PROFILE
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(name)                                                     \
+  profile_zone_t PROFILE_CONCAT(profile_zone_, __LINE__)                       \
+      __attribute__((cleanup(profile_zone_end))) = profile_zone_begin(name)
+#define PROFILE_BEGIN(zone, name) profile_zone_t zone = profile_zone_begin(name)
+#define PROFILE_END(zone) profile_zone_end(&zone)
+#else
+#define PROFILE_ZONE(name)
+#define PROFILE_BEGIN(zone, name)
+#define PROFILE_END(zone)
+#endif
+
+/**
+ * A zone that has been entered but not yet left.
+ * Use the PROFILE_* macros rather than this type directly.
+ */
+typedef struct {
+  const char *name;
+  uint64_t start_ns;
+} profile_zone_t;
+
+/**
+ * Reads a monotonic clock. Available whether or not PROFILE is defined.
+ *
+ * @return the current time in nanoseconds since an arbitrary point
+ */
+uint64_t profiler_now_ns(void);
+
+/**
+ * Enters a zone. Called by PROFILE_ZONE() and PROFILE_BEGIN().
+ *
+ * @param name the zone's name; must be a string that outlives the profiler,
+ *   e.g. a string literal
+ * @return the started zone
+ */
+profile_zone_t profile_zone_begin(const char *name);
+
+/**
+ * Leaves a zone and records it in the calling thread's ring buffer.
+ * Called by PROFILE_END() and when a PROFILE_ZONE() goes out of scope.
+ *
+ * @param zone the zone returned from profile_zone_begin()
+ */
+void profile_zone_end(profile_zone_t *zone);
+
+/**
+ * Writes every recorded sample as a Chrome trace
+ * (open it in chrome://tracing or https://ui.perfetto.dev).
+ * Should be called while no other thread is recording samples.
+ *
+ * @param path the JSON file to write
+ * @return whether the file was written successfully
+ */
+bool profiler_write_chrome_trace(const char *path);
+
+/**
+ * Writes one CSV row per zone name with its sample count and the total,
+ * mean and maximum time spent in it.
+ * Should be called while no other thread is recording samples.
+ *
+ * @param path the CSV file to write
+ * @return whether the file was written successfully
+ */
+bool profiler_write_csv_summary(const char *path);
+
+/**
+ * Discards all recorded samples.
+ * Should be called while no other thread is recording samples.
+ */
+void profiler_reset(void);
+
+#endif // #ifndef __PROFILER_H__
@@ -0,0 +1,137 @@
+#ifndef __RENDER_SNAPSHOT_H__
+#define __RENDER_SNAPSHOT_H__
+
+#include "color.h"
+#include "image.h"
+#include "list.h"
+#include "scene.h"
+#include "text.h"
+#include "vector.h"
+#include <stddef.h>
+
+/**
+ * How to draw one body, copied out of the scene when a snapshot is captured.
+ * Nothing here points into a body_t, so the body may be moved, removed or
+ * freed while the snapshot is being drawn.
+ */
+typedef struct render_item {
+  /** The body's centroid and angle at capture time */
+  vector_t centroid;
+  double angle;
+  /**
+   * The body's sprite, or NULL to draw its polygon.
+   * The snapshot holds a reference on the surface (see SDL_Surface.refcount)
+   * until it is cleared, so the body's image may be freed in the meantime.
+   */
+  SDL_Surface *sprite;
+  vector_t sprite_size;
+  rgb_color_t color;
+  /** The range of the snapshot's vertex array holding the polygon */
+  size_t first_vertex;
+  size_t num_vertices;
+} render_item_t;
+
+/**
+ * An immutable copy of everything sdl_render_scene() draws in one frame:
+ * the standalone images, the texts and the scene's bodies.
+ * Its arrays are reused between captures, so once a snapshot has grown
+ * to fit a scene, capturing it again does not allocate.
+ */
+typedef struct render_snapshot render_snapshot_t;
+
+/**
+ * Allocates an empty snapshot.
+ *
+ * @return the new snapshot
+ */
+render_snapshot_t *render_snapshot_init(void);
+
+/**
+ * Releases a snapshot along with the surface references it holds.
+ *
+ * @param snapshot a snapshot returned from render_snapshot_init()
+ */
+void render_snapshot_free(render_snapshot_t *snapshot);
+
+/**
+ * Replaces the contents of a snapshot with the current state of a frame.
+ * Must be called on the thread that owns the scene.
+ *
+ * @param snapshot the snapshot to overwrite
+ * @param scene the scene whose bodies should be drawn
+ * @param texts a list of text_t * to draw, or NULL
+ * @param images a list of image_t * to draw behind the bodies, or NULL
+ */
+void render_snapshot_capture(render_snapshot_t *snapshot, scene_t *scene,
+                             list_t *texts, list_t *images);
+
+/**
+ * Drops the contents of a snapshot, releasing its surface references.
+ *
+ * @param snapshot the snapshot to clear
+ */
+void render_snapshot_clear(render_snapshot_t *snapshot);
+
+/**
+ * Gets the number of bodies in a snapshot.
+ *
+ * @param snapshot the snapshot to inspect
+ * @return the number of captured bodies
+ */
+size_t render_snapshot_items(render_snapshot_t *snapshot);
+
+/**
+ * Gets a captured body. Items are stored in scene order.
+ *
+ * @param snapshot the snapshot to inspect
+ * @param index the index of the body
+ * @return a pointer to the item, valid until the snapshot is recaptured
+ */
+render_item_t *render_snapshot_get_item(render_snapshot_t *snapshot,
+                                        size_t index);
+
+/**
+ * Gets the vertex array that render_item_t.first_vertex indexes into.
+ *
+ * @param snapshot the snapshot to inspect
+ * @return the captured vertices of all polygon bodies
+ */
+vector_t *render_snapshot_get_vertices(render_snapshot_t *snapshot);
+
+/**
+ * Gets the number of standalone images in a snapshot.
+ *
+ * @param snapshot the snapshot to inspect
+ * @return the number of captured images
+ */
+size_t render_snapshot_images(render_snapshot_t *snapshot);
+
+/**
+ * Gets a captured standalone image.
+ * Its surface is referenced by the snapshot, as for render_item_t.sprite.
+ *
+ * @param snapshot the snapshot to inspect
+ * @param index the index of the image
+ * @return a pointer to the image, valid until the snapshot is recaptured
+ */
+image_t *render_snapshot_get_image(render_snapshot_t *snapshot, size_t index);
+
+/**
+ * Gets the number of texts in a snapshot.
+ *
+ * @param snapshot the snapshot to inspect
+ * @return the number of captured texts
+ */
+size_t render_snapshot_texts(render_snapshot_t *snapshot);
+
+/**
+ * Gets a captured text. Its string is a copy owned by the snapshot;
+ * the font is shared and must stay open while the snapshot is drawn.
+ *
+ * @param snapshot the snapshot to inspect
+ * @param index the index of the text
+ * @return a pointer to the text, valid until the snapshot is recaptured
+ */
+text_t *render_snapshot_get_text(render_snapshot_t *snapshot, size_t index);
+
+#endif // #ifndef __RENDER_SNAPSHOT_H__
@@ -0,0 +1,95 @@
+#ifndef __REPLAY_H__
+#define __REPLAY_H__
+
+#include "sdl_wrapper.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Records the key events of a session so it can be played back exactly,
+ * e.g. as a repeatable performance workload or a regression fixture.
+ *
+ * A replay file holds the seed the game was started with, the fixed tick
+ * length, the tick the session ended on, and every key event with the tick it
+ * was delivered on. Ticks are counted by calls to replay_next_tick().
+ *
+ * While recording, sdl_is_done() writes each key event it delivers.
+ * While playing back, sdl_is_done() ignores SDL's events and instead delivers
+ * the recorded ones on the same ticks, then reports the session as done
+ * on the tick the recording ended.
+ */
+
+/**
+ * Starts recording to a file, replacing it.
+ *
+ * @param path the replay file to write
+ * @param seed the seed the game will use (see replay_seed())
+ * @param dt the fixed tick length the game will be simulated with
+ * @return whether the file could be opened
+ */
+bool replay_start_recording(const char *path, uint64_t seed, double dt);
+
+/**
+ * Starts playing back a replay file.
+ *
+ * @param path the replay file to read
+ * @return whether the file could be opened and has a valid header
+ */
+bool replay_start_playback(const char *path);
+
+/**
+ * Finishes recording or playing back. Must be called for a recording
+ * to be complete, since it writes the tick the session ended on.
+ */
+void replay_stop(void);
+
+bool replay_is_recording(void);
+
+bool replay_is_playing(void);
+
+/**
+ * Gets the seed to seed the game's random numbers with.
+ * While playing back, this is the recorded seed; while recording, the seed
+ * being recorded. Otherwise the seed last set with replay_set_seed(),
+ * or a seed based on the time, chosen on first use.
+ * Seeds are per thread; recording and playback set the calling thread's.
+ *
+ * @return the seed for games started on the calling thread
+ */
+uint64_t replay_seed(void);
+
+/**
+ * Chooses the seed replay_seed() returns on the calling thread,
+ * e.g. to give each of many games run side by side a different one.
+ *
+ * @param seed the seed for games started on the calling thread
+ */
+void replay_set_seed(uint64_t seed);
+
+/**
+ * Gets the tick length of the replay being played back.
+ *
+ * @return the recorded tick length in seconds, or 0 if not playing back
+ */
+double replay_dt(void);
+
+/**
+ * Records a key event on the current tick, if recording.
+ */
+void replay_record_key(char key, key_event_type_t type, double held_time);
+
+/**
+ * Delivers the recorded key events of the current tick, if playing back.
+ *
+ * @param handler the key handler to deliver the events to, or NULL
+ * @param state the state to pass to the handler
+ * @return whether the replay has reached the tick the recording ended on
+ */
+bool replay_dispatch(key_handler_t handler, void *state);
+
+/**
+ * Advances to the next tick. Called once per tick by the main loop.
+ */
+void replay_next_tick(void);
+
+#endif // #ifndef __REPLAY_H__
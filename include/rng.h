@@ -0,0 +1,72 @@
+#ifndef __RNG_H__
+#define __RNG_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A seedable pseudorandom number generator (xoshiro256**).
+ * Each scene owns one, so independent scenes can run on different threads
+ * and a scene's random numbers depend only on its seed and its own draws.
+ * rng_t is defined here instead of rng.c so it can be copied and stored
+ * *by value*, like vector_t.
+ */
+typedef struct {
+  uint64_t state[4];
+} rng_t;
+
+/**
+ * Resets a generator to the start of the sequence for a seed.
+ * Any seed, including 0, gives a well-mixed starting state.
+ *
+ * @param rng the generator to seed
+ * @param seed the seed
+ */
+void rng_seed(rng_t *rng, uint64_t seed);
+
+/**
+ * Draws 64 uniformly random bits.
+ *
+ * @param rng the generator to draw from
+ * @return the next number in the sequence
+ */
+uint64_t rng_next(rng_t *rng);
+
+/**
+ * Draws a uniformly random integer below a bound, without modulo bias.
+ *
+ * @param rng the generator to draw from
+ * @param bound the number of possible results; must be positive
+ * @return an integer in [0, bound)
+ */
+size_t rng_below(rng_t *rng, size_t bound);
+
+/**
+ * Draws a uniformly random real number in [min, max).
+ *
+ * @param rng the generator to draw from
+ * @param min the lower bound
+ * @param max the upper bound
+ * @return a number in [min, max)
+ */
+double rng_between(rng_t *rng, double min, double max);
+
+/**
+ * Advances a generator by 2^128 draws.
+ * Calling this repeatedly on copies of one generator gives parallel streams
+ * that will not overlap.
+ *
+ * @param rng the generator to advance
+ */
+void rng_jump(rng_t *rng);
+
+/**
+ * Splits off an independent stream, e.g. for a scene on another thread.
+ * The returned generator continues where rng was, and rng jumps ahead.
+ *
+ * @param rng the generator to split; jumps ahead by 2^128 draws
+ * @return a generator whose draws will not overlap rng's
+ */
+rng_t rng_split(rng_t *rng);
+
+#endif // #ifndef __RNG_H__
@@ -3,6 +3,9 @@
 
 #include "body.h"
 #include "list.h"
+#include "rng.h"
+#include <stdint.h>
+#include <stdio.h>
 
 /**
  * A collection of bodies and force creators.
@@ -16,6 +19,18 @@ typedef struct bodies_force_container bodies_force_container_t;
 typedef void (*collision_handler_t)(body_t *body1, body_t *body2, vector_t axis,
                                     void *aux);
 
+/**
+ * A function called when two bodies of a swept collision will touch.
+ * @param body1 the first body passed to scene_add_swept_collision()
+ * @param body2 the second body passed to scene_add_swept_collision()
+ * @param axis the contact normal, a unit vector pointing from body1
+ *   towards body2 at the moment they touch
+ * @param time the fraction of the tick, from 0 to 1, at which they touch
+ * @param aux the auxiliary value passed to scene_add_swept_collision()
+ */
+typedef void (*impact_handler_t)(body_t *body1, body_t *body2, vector_t axis,
+                                 double time, void *aux);
+
 /**
  * A function which adds some forces or impulses to bodies,
  * e.g. from collisions, gravity, or spring forces.
@@ -28,6 +43,89 @@ typedef void (*force_creator_t)(void *aux, list_t *bodies);
  */
 typedef void (*force_creator_old_t)(void *aux);
 
+/**
+ * How scene_tick() advances every body's motion.
+ * All of them step every body at once, in loops over arrays.
+ * The multi-stage integrators rerun the pure force creators (see
+ * scene_add_pure_force_creator()) and radial fields at points inside the
+ * tick, and hold every other force at its value from the start of the tick.
+ * Collisions are only detected once per tick, at its start.
+ */
+typedef enum {
+  /** Euler, moving at the average of the old and new velocities (default) */
+  INTEGRATOR_AVERAGED_EULER,
+  /** Updates velocity, then moves at the new velocity; keeps orbits stable */
+  INTEGRATOR_SEMI_IMPLICIT_EULER,
+  /** Second order; runs the pure force creators 3 times per tick */
+  INTEGRATOR_VELOCITY_VERLET,
+  /** Classic fourth-order Runge-Kutta; runs the pure force creators 5 times */
+  INTEGRATOR_RK4
+} integrator_t;
+
+/**
+ * A force acting on every body in a layer, applied by the scene itself in one
+ * loop over its bodies instead of by a force creator per body.
+ * Bodies with infinite mass are not affected.
+ */
+typedef struct {
+  /** Added to every body's acceleration, e.g. (0, -g) for uniform gravity */
+  vector_t acceleration;
+  /** Linear drag: each body feels a force of -drag times its velocity */
+  double drag;
+} scene_field_t;
+
+/**
+ * Aggregated cost of every force creator or collision handler
+ * registered under one name (see scene_add_named_bodies_force_creator()).
+ */
+typedef struct {
+  const char *name;
+  /** Number of times a callback with this name was called */
+  size_t invocations;
+  /** Total and longest time spent in a single call, in nanoseconds */
+  uint64_t total_ns;
+  uint64_t max_ns;
+  /** Sum over all calls of the number of bodies passed to the callback */
+  size_t bodies_touched;
+} callback_stats_t;
+
+// Early-outs after this many axes or more share the last histogram bucket
+#define COLLISION_STATS_MAX_AXES 16
+
+/**
+ * What the collision pipeline did during the last scene_tick(),
+ * summed over its substeps.
+ */
+typedef struct {
+  /** Collision handlers registered with the scene */
+  size_t pairs_registered;
+  /**
+   * Pairs skipped without running the narrow phase (find_collision()):
+   * those with a removed body, and contacts between two bodies of infinite
+   * mass, which the solver could not move
+   */
+  size_t pairs_culled;
+  /** Pairs passed to find_collision() */
+  size_t pairs_tested;
+  /** Separating axes projected onto, summed over all tested pairs */
+  size_t axes_tested;
+  /**
+   * early_outs[i] counts pairs found to be separated on their (i + 1)th axis,
+   * so a pipeline that rejects pairs quickly has most counts near index 0
+   */
+  size_t early_outs[COLLISION_STATS_MAX_AXES];
+  /** Pairs that overlapped on every axis */
+  size_t overlaps;
+  /** Calls to collision handlers */
+  size_t handler_invocations;
+  /** Overlapping pairs whose handler was skipped as they already collided */
+  size_t just_collided_suppressions;
+  /** Touching contacts passed to the contact solver */
+  size_t contacts_solved;
+  /** The steps the tick was split into (see scene_set_max_substeps()) */
+  size_t substeps;
+} collision_stats_t;
+
 /**
  * Allocates memory for an empty scene.
  * Makes a reasonable guess of the number of bodies to allocate space for.
@@ -126,17 +224,328 @@ void scene_add_force_creator(scene_t *scene, force_creator_old_t forcer,
  * @param bodies the list of bodies affected by the force creator.
  *   The force creator will be removed if any of these bodies are removed.
  *   This list does not own the bodies, so its freer should be NULL.
- * @param freer if non-NULL, a function to call in order to free aux
+ * @param freer if non-NULL, a function to call in order to free aux.
+ *   Such an aux is owned by the scene, which cannot copy it for
+ *   scene_snapshot(); use scene_add_named_bodies_force_creator() with a
+ *   copier for force creators in scenes that are saved.
  */
 void scene_add_bodies_force_creator(scene_t *scene, force_creator_t forcer,
                                     collision_handler_t collision_handler,
                                     void *aux, list_t *bodies,
                                     free_func_t freer);
 
+/**
+ * Like scene_add_bodies_force_creator(), but records the cost of each call
+ * to the force creator or collision handler under the given name.
+ * Callbacks registered under the same name share their statistics.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param name the name to attribute calls to; must outlive the scene,
+ *   e.g. a string literal. If NULL, calls are not recorded.
+ * @param forcer a force creator function
+ * @param collision_handler a function to handle collisions
+ * @param aux an auxiliary value to pass to forcer when it is called
+ * @param bodies the list of bodies affected by the force creator
+ * @param freer if non-NULL, a function to call in order to free aux
+ * @param copier if non-NULL, a function to copy aux with for scene_snapshot(),
+ *   which needs one if there is a freer
+ */
+void scene_add_named_bodies_force_creator(scene_t *scene, const char *name,
+                                          force_creator_t forcer,
+                                          collision_handler_t collision_handler,
+                                          void *aux, list_t *bodies,
+                                          free_func_t freer,
+                                          copy_func_t copier);
+
+/**
+ * Like scene_add_named_bodies_force_creator() with no collision handler,
+ * for a pure force creator: one that only adds forces to its bodies, which
+ * depend on nothing but the bodies' positions and velocities.
+ * The multi-stage integrators rerun pure force creators inside the tick;
+ * every other force creator runs once per tick, and its forces are held
+ * over the tick.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param name the name to attribute calls to, or NULL
+ * @param forcer a pure force creator function
+ * @param aux an auxiliary value to pass to forcer when it is called
+ * @param bodies the list of bodies affected by the force creator
+ * @param freer if non-NULL, a function to call in order to free aux
+ * @param copier if non-NULL, a function to copy aux with for scene_snapshot()
+ */
+void scene_add_pure_force_creator(scene_t *scene, const char *name,
+                                  force_creator_t forcer, void *aux,
+                                  list_t *bodies, free_func_t freer,
+                                  copy_func_t copier);
+
+/**
+ * Gets the number of names that callbacks have been registered under.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @return the number of distinct names, in order of first registration
+ */
+size_t scene_callback_stats_count(scene_t *scene);
+
+/**
+ * Gets the statistics of the callbacks registered under the name at an index.
+ * Asserts that the index is valid.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param index the index of the name (starting at 0)
+ * @return a copy of the statistics
+ */
+callback_stats_t scene_get_callback_stats(scene_t *scene, size_t index);
+
+/**
+ * Finds the statistics of the callbacks registered under a name.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param name the name passed at registration
+ * @param stats where to copy the statistics, if found
+ * @return whether any callback has been registered under the name
+ */
+bool scene_find_callback_stats(scene_t *scene, const char *name,
+                               callback_stats_t *stats);
+
+/**
+ * Zeroes the statistics of every name, e.g. after a warm-up period.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ */
+void scene_reset_callback_stats(scene_t *scene);
+
+/**
+ * Writes one line per name with its statistics, most total time first.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param file where to write the statistics, e.g. stderr
+ */
+void scene_write_callback_stats(scene_t *scene, FILE *file);
+
+/**
+ * Gets the collision pipeline counters of the last scene_tick().
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @return the counters, which are reset at the start of each tick
+ */
+collision_stats_t scene_get_collision_stats(scene_t *scene);
+
+/**
+ * Gets the scene's random number generator, for anything that places or
+ * picks bodies at random. It starts from the same default seed in every
+ * scene; reseed it with rng_seed() for a different sequence.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @return the scene's generator, which lives as long as the scene
+ */
+rng_t *scene_get_rng(scene_t *scene);
+
+/**
+ * Adds a contact between two bodies, resolved by the scene's contact solver.
+ * Each tick, every touching contact is gathered and solved together:
+ * a fixed number of passes of impulses that stop the bodies approaching
+ * along the collision axis, starting from the previous tick's impulses.
+ * So unlike a collision handler, a contact keeps acting while the bodies
+ * rest on each other, and stacks stay put instead of jittering or sinking.
+ *
+ * The contact bounces with the larger of the bodies' elasticities
+ * (see body_set_elasticity()); if neither body has one, with the elasticity
+ * given here. Only approaches faster than a small resting speed bounce.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param body1 the first body
+ * @param body2 the second body
+ * @param elasticity the elasticity for bodies without a material
+ */
+void scene_add_contact(scene_t *scene, body_t *body1, body_t *body2,
+                       double elasticity);
+
+/**
+ * Adds a collision between two bodies that is detected continuously:
+ * instead of testing whether they overlap at the start of the tick, the
+ * scene sweeps both shapes along the motion their velocity, forces and
+ * impulses predict for the tick and finds when they first touch
+ * (see find_impact()). A fast body, e.g. a bullet, therefore hits a thin one
+ * instead of passing through it between ticks, without substeps
+ * (see scene_set_max_substeps(), which ignores swept pairs).
+ *
+ * Like a collision handler, the handler is called once when the bodies
+ * start touching, before they are moved, and not again until they part.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param name the name to gather the handler's statistics under, or NULL
+ * @param body1 the first body
+ * @param body2 the second body
+ * @param handler the function to call with the time and normal of impact
+ * @param aux an auxiliary value to pass to the handler
+ * @param freer if non-NULL, a function to call on aux to free it
+ * @param copier if non-NULL, a function to copy aux with for scene_snapshot(),
+ *   which needs one if there is a freer
+ */
+void scene_add_swept_collision(scene_t *scene, const char *name,
+                               body_t *body1, body_t *body2,
+                               impact_handler_t handler, void *aux,
+                               free_func_t freer, copy_func_t copier);
+
+/**
+ * A field pulling bodies towards a point, e.g. a black hole or a magnet.
+ * Unlike a collision, it only looks at bodies' centroids.
+ */
+typedef struct {
+  /** Bodies further than this from the center are not affected */
+  double radius;
+  /** The acceleration towards the center, at the center */
+  double strength;
+  /**
+   * How the pull weakens towards the edge: it is strength times
+   * (1 - distance / radius) to this power, so 0 is uniform, 1 is linear
+   */
+  double falloff;
+  /** Bodies closer than this trigger the field's handler, or 0 for none */
+  double kill_radius;
+  /** The layers pulled, as a bitmask: bit i is layer i (see body_set_layer()) */
+  unsigned layers;
+} radial_field_t;
+
+/**
+ * Adds a radial field centered on a body, which moves with it and is removed
+ * with it. Each tick, the scene indexes the centroids of the bodies that any
+ * radial field can pull in a spatial hash, so each field only looks at the
+ * bodies within its radius. Bodies with infinite mass are not affected.
+ * The field is applied with the force creators, including at every stage of
+ * the multi-stage integrators.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param source the body at the center
+ * @param field the field's shape and the layers it pulls
+ * @param handler if non-NULL, called with collision handlers on every tick
+ *   a pulled body is within the kill radius, with that body as body1
+ *   and the source as body2, unless an earlier handler that tick removed
+ *   either of them
+ * @param aux an auxiliary value to pass to the handler
+ * @param freer if non-NULL, a function to call on aux to free it
+ * @param copier if non-NULL, a function to copy aux with for scene_snapshot(),
+ *   which needs one if there is a freer
+ */
+void scene_add_radial_field(scene_t *scene, body_t *source,
+                            radial_field_t field, collision_handler_t handler,
+                            void *aux, free_func_t freer, copy_func_t copier);
+
+/**
+ * Chooses how the scene's bodies are integrated from the next tick on.
+ * Stiff systems, e.g. networks of springs, stay stable at much larger
+ * ticks with INTEGRATOR_VELOCITY_VERLET or INTEGRATOR_RK4.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param integrator the integrator to use
+ */
+void scene_set_integrator(scene_t *scene, integrator_t integrator);
+
+/**
+ * Gets the integrator a scene uses.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @return the integrator, INTEGRATOR_AVERAGED_EULER unless set
+ */
+integrator_t scene_get_integrator(scene_t *scene);
+
+/**
+ * Lets scene_tick() split a tick into up to this many equal substeps, each
+ * running the whole tick (forces, collisions, handlers and integration).
+ * The count is chosen every tick, so that no pair of bodies with a
+ * collision or contact moves further relative to each other in one substep
+ * than half the thinner body's extent (see body_get_extent()).
+ * Fast bodies therefore collide with thin ones instead of skipping over them,
+ * and ticks without fast bodies cost no more than before.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param max_substeps the most substeps per tick; 1 (default) never splits
+ */
+void scene_set_max_substeps(scene_t *scene, size_t max_substeps);
+
+/**
+ * Gets the most substeps a scene splits a tick into.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @return the limit from scene_set_max_substeps(), or 1 if never set
+ */
+size_t scene_get_max_substeps(scene_t *scene);
+
+/**
+ * Sets the field acting on every body in a layer from the next tick on.
+ * Like forces, it is applied before integration, and again at each stage
+ * of the multi-stage integrators. Every layer has no field until set.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param layer the layer, less than BODY_LAYERS (see body_set_layer())
+ * @param field the layer's uniform acceleration and drag
+ */
+void scene_set_field(scene_t *scene, size_t layer, scene_field_t field);
+
+/**
+ * Gets the field acting on every body in a layer.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param layer the layer, less than BODY_LAYERS
+ * @return the field from scene_set_field(), or no field if never set
+ */
+scene_field_t scene_get_field(scene_t *scene, size_t layer);
+
+/**
+ * A saved copy of a scene's bodies, force creators and random number
+ * generator, kept in a single allocation, for resetting or rewinding a scene.
+ */
+typedef struct scene_snapshot scene_snapshot_t;
+
+/**
+ * Saves a scene so it can be restored later with scene_restore().
+ * Saves every body (shape, motion, info and image), every force creator and
+ * collision (functions, bodies, aux and name) and the generator.
+ *
+ * Infos and auxes with a freer are owned by the scene, so they are copied
+ * with their copier (see body_set_info_copier() and
+ * scene_add_named_bodies_force_creator()); asserts that each has one.
+ * Ones without a freer are borrowed, e.g. a demo's state, and are shared.
+ * Images are shared too: their surfaces are reference counted.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @return the snapshot, which is independent of the scene
+ */
+scene_snapshot_t *scene_snapshot(scene_t *scene);
+
+/**
+ * Replaces a scene's bodies, force creators and generator with a snapshot's,
+ * in one pass over the snapshot. Existing bodies are freed, so pointers to
+ * them must be looked up again, e.g. with scene_get_body(); bodies are
+ * restored in the same order. Callback and collision statistics are kept.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param snapshot a snapshot returned from scene_snapshot(),
+ *   which can be restored any number of times
+ */
+void scene_restore(scene_t *scene, scene_snapshot_t *snapshot);
+
+/**
+ * Gets the number of bytes a snapshot takes up.
+ *
+ * @param snapshot a snapshot returned from scene_snapshot()
+ * @return the size of its single allocation, not counting the copies of
+ *   infos and auxes
+ */
+size_t scene_snapshot_size(scene_snapshot_t *snapshot);
+
+/**
+ * Releases a snapshot and its copies of infos and auxes.
+ *
+ * @param snapshot a snapshot returned from scene_snapshot()
+ */
+void scene_snapshot_free(scene_snapshot_t *snapshot);
+
 /**
  * Executes a tick of a given scene over a small time interval.
  * This requires executing all the force creators
- * and then ticking each body (see body_tick()).
+ * and then integrating each body (see scene_set_integrator()),
+ * possibly in several substeps (see scene_set_max_substeps()).
  * If any bodies are marked for removal, they should be removed from the scene
  * and freed, along with any force creators acting on them.
  *
@@ -8,6 +8,7 @@
 #include "text.h"
 #include "vector.h"
 #include "image.h"
+#include "render_snapshot.h"
 #include <stdbool.h>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h>
@@ -29,6 +30,23 @@ typedef enum {
  */
 typedef enum { KEY_PRESSED, KEY_RELEASED } key_event_type_t;
 
+/**
+ * The targets the renderer can draw into.
+ * RENDER_BACKEND_WINDOW opens a visible window with a vsync renderer.
+ * RENDER_BACKEND_SOFTWARE draws into an offscreen surface and needs no video
+ *   driver at all, so it works on a headless machine.
+ * RENDER_BACKEND_DUMMY uses SDL's "dummy" video driver with a hidden window
+ *   and a software renderer, exercising the same window code paths.
+ * RENDER_BACKEND_NONE initializes nothing and draws nothing, so that many
+ *   simulation-only instances can run side by side on different threads.
+ */
+typedef enum {
+  RENDER_BACKEND_WINDOW,
+  RENDER_BACKEND_SOFTWARE,
+  RENDER_BACKEND_DUMMY,
+  RENDER_BACKEND_NONE
+} render_backend_t;
+
 /**
  * A keypress handler.
  * When a key is pressed or released, the handler is passed its char value.
@@ -43,9 +61,68 @@ typedef enum { KEY_PRESSED, KEY_RELEASED } key_event_type_t;
 typedef void (*key_handler_t)(char key, key_event_type_t type, double held_time,
                               void *state);
 
+/**
+ * The state of one game instance: its backend, window or offscreen target,
+ * scene-to-pixel mapping, key handler, tick clock and render statistics.
+ * Every other function in this file acts on the calling thread's current
+ * context, so independent games can run on different threads.
+ * A thread that never calls sdl_set_context() uses a shared default context.
+ */
+typedef struct sdl_context sdl_context_t;
+
+/**
+ * Allocates a context with the default settings,
+ * i.e. RENDER_BACKEND_WINDOW and no key handler.
+ * Make it current with sdl_set_context() before calling sdl_init().
+ *
+ * @return the new context
+ */
+sdl_context_t *sdl_context_init(void);
+
+/**
+ * Releases a context and the window and renderer it created.
+ * If it is the calling thread's current context,
+ * the thread goes back to the default context.
+ *
+ * @param context a context returned from sdl_context_init()
+ */
+void sdl_context_free(sdl_context_t *context);
+
+/**
+ * Makes a context current on the calling thread.
+ *
+ * @param context a context returned from sdl_context_init(),
+ *   or NULL for the default context
+ */
+void sdl_set_context(sdl_context_t *context);
+
+/**
+ * Gets the calling thread's current context.
+ *
+ * @return the current context
+ */
+sdl_context_t *sdl_get_context(void);
+
+/**
+ * Selects the backend used by the next call to sdl_init().
+ * Defaults to RENDER_BACKEND_WINDOW.
+ *
+ * @param backend the backend to render into
+ */
+void sdl_set_backend(render_backend_t backend);
+
+/**
+ * Reads the backend requested by the RENDER_BACKEND environment variable
+ * ("window", "software", "dummy" or "none").
+ *
+ * @return the requested backend, or RENDER_BACKEND_WINDOW if unset or unknown
+ */
+render_backend_t sdl_backend_from_env(void);
+
 /**
  * Initializes the SDL window and renderer.
  * Must be called once before any of the other SDL functions.
+ * Uses the backend chosen with sdl_set_backend().
  *
  * @param min the x and y coordinates of the bottom left of the scene
  * @param max the x and y coordinates of the top right of the scene
@@ -89,6 +166,114 @@ void sdl_show(void);
 // void sdl_render_scene(scene_t *scene, char *texts[], size_t num_texts);
 void sdl_render_scene(scene_t *scene, list_t *texts, list_t* images);
 
+/**
+ * Draws a previously captured snapshot of a frame.
+ * This is what the render thread does with each published snapshot.
+ *
+ * @param snapshot the frame to draw
+ */
+void sdl_render_snapshot(render_snapshot_t *snapshot);
+
+/**
+ * Moves drawing onto a separate render thread.
+ * Afterwards sdl_render_scene() only captures a render_snapshot_t of the frame
+ * and publishes it into a triple buffer; the render thread draws the newest
+ * published frame, so simulating the next frame overlaps drawing this one.
+ * Frames published faster than they can be drawn are skipped.
+ * The render thread presents each frame it draws.
+ * After this call, the renderer and any fonts used by texts must only be used
+ * by the render thread until sdl_stop_render_thread() is called, so frames
+ * cannot be read back, e.g. with sdl_read_frame(), in the meantime.
+ * sdl_set_stats_overlay() may still be called: the render thread opens and
+ * closes the overlay's font itself.
+ *
+ * Only RENDER_BACKEND_SOFTWARE and RENDER_BACKEND_DUMMY are supported: their
+ * renderers are not tied to the thread that created them, but a window's
+ * renderer is on some platforms.
+ *
+ * @return whether the thread started; if not, e.g. for another backend,
+ *   rendering stays inline
+ */
+bool sdl_start_render_thread(void);
+
+/**
+ * Waits for the render thread to exit and returns to inline rendering.
+ * Must be called before freeing anything the published frames reference,
+ * such as fonts. Does nothing if the render thread is not running.
+ */
+void sdl_stop_render_thread(void);
+
+/**
+ * Gets the wall-clock time spent drawing the last frame, either inline in
+ * sdl_render_scene() or on the render thread.
+ *
+ * @return the render time of the last frame, in seconds
+ */
+double sdl_get_render_time(void);
+
+/**
+ * The work done to draw one frame.
+ */
+typedef struct {
+  /** Clears, polygon fills and texture copies issued to the renderer */
+  size_t draw_calls;
+  /** Textures created and destroyed; each surface drawn creates one */
+  size_t texture_creates;
+  size_t texture_destroys;
+  /** Pixel bytes of the surfaces uploaded into those textures */
+  size_t upload_bytes;
+  /** Strings rasterized with SDL_ttf */
+  size_t text_rasterizations;
+  /** Polygon vertices submitted */
+  size_t vertices_submitted;
+} render_stats_t;
+
+/**
+ * Gets the work done to draw the last frame, either inline in
+ * sdl_render_scene() or on the render thread.
+ * Work done to draw the stats overlay is not included.
+ *
+ * @return the render stats of the last frame
+ */
+render_stats_t sdl_get_render_stats(void);
+
+/**
+ * Enables or disables drawing the last frame's render stats
+ * in the top left corner of each frame.
+ * Safe to call while the render thread runs; disabling the overlay then
+ * closes its font on the render thread, after the frame it is drawing.
+ *
+ * @param enabled whether to draw the overlay
+ */
+void sdl_set_stats_overlay(bool enabled);
+
+/**
+ * Copies the pixels of the frame currently in the renderer's target.
+ * Works with every backend, but is mostly useful with the headless ones.
+ *
+ * @return a newly allocated ARGB8888 surface, which must be SDL_FreeSurface()d,
+ *   or NULL if the pixels could not be read
+ */
+SDL_Surface *sdl_read_frame(void);
+
+/**
+ * Saves the current frame as a BMP file, e.g. to record a golden image.
+ *
+ * @param path the file to write
+ * @return whether the frame was written successfully
+ */
+bool sdl_save_frame(const char *path);
+
+/**
+ * Compares the current frame against a golden BMP image.
+ *
+ * @param golden_path the BMP file to compare against
+ * @param tolerance the largest per-channel difference treated as equal
+ * @return the number of pixels that differ, or SIZE_MAX if the golden image
+ *   could not be loaded or has different dimensions
+ */
+size_t sdl_compare_frame(const char *golden_path, uint8_t tolerance);
+
 /**
  * Registers a function to be called every time a key is pressed.
  * Overwrites any existing handler.
@@ -117,12 +302,43 @@ void sdl_render_scene(scene_t *scene, list_t *texts, list_t* images);
  */
 void sdl_on_key(key_handler_t handler);
 
+/**
+ * Delivers a key event to the current context's key handler, as if it came
+ * from SDL, e.g. to drive a game from a bot. Recorded if a replay is being
+ * recorded.
+ *
+ * @param key the key, as passed to a key_handler_t
+ * @param type the type of key event (KEY_PRESSED or KEY_RELEASED)
+ * @param held_time if a press event, the time the key has been held in seconds
+ * @param state the state to pass to the handler
+ */
+void sdl_dispatch_key(char key, key_event_type_t type, double held_time,
+                      void *state);
+
 /**
  * Gets the amount of time that has passed since the last time
  * this function was called, in seconds.
+ * If a fixed tick length was set with sdl_set_fixed_dt(), returns that instead.
  *
  * @return the number of seconds that have elapsed
  */
 double time_since_last_tick(void);
 
+/**
+ * Makes time_since_last_tick() return a fixed tick length,
+ * e.g. the one handed out by a frame_pacer_t.
+ *
+ * @param dt the tick length in seconds, or 0 to measure real time again
+ */
+void sdl_set_fixed_dt(double dt);
+
+/**
+ * Enables or disables drawing in sdl_render_scene().
+ * Used to simulate ticks without drawing them, e.g. when a frame pacer
+ * lowers the render rate.
+ *
+ * @param enabled whether sdl_render_scene() should draw
+ */
+void sdl_set_render_enabled(bool enabled);
+
 #endif // #ifndef __SDL_WRAPPER_H__
@@ -0,0 +1,64 @@
+#ifndef __SPATIAL_HASH_H__
+#define __SPATIAL_HASH_H__
+
+#include "vector.h"
+#include <stddef.h>
+
+/**
+ * An index of points on a uniform grid, for finding the points near a
+ * position without testing every one. Grid cells are hashed into buckets,
+ * so the grid is unbounded and costs memory only for the points in it.
+ * It is rebuilt from scratch whenever the points move, which is a couple of
+ * linear passes, and reuses its arrays between builds.
+ */
+typedef struct spatial_hash spatial_hash_t;
+
+/**
+ * Called for each point a query finds.
+ *
+ * @param index the point's index in the array passed to spatial_hash_build()
+ * @param aux the auxiliary value passed to spatial_hash_query()
+ */
+typedef void (*spatial_hash_visitor_t)(size_t index, void *aux);
+
+/**
+ * Allocates an empty spatial hash.
+ *
+ * @return the new spatial hash
+ */
+spatial_hash_t *spatial_hash_init(void);
+
+/**
+ * Releases the memory allocated for a spatial hash.
+ *
+ * @param hash a pointer to a spatial hash returned from spatial_hash_init()
+ */
+void spatial_hash_free(spatial_hash_t *hash);
+
+/**
+ * Replaces the points a spatial hash holds.
+ * Queries are fastest when their radius is about the cell size.
+ *
+ * @param hash a pointer to a spatial hash returned from spatial_hash_init()
+ * @param points the points, which are copied
+ * @param count the number of points
+ * @param cell_size the side of each grid cell, which must be positive
+ */
+void spatial_hash_build(spatial_hash_t *hash, const vector_t *points,
+                        size_t count, double cell_size);
+
+/**
+ * Visits every point within a distance of a position, each once,
+ * in no particular order.
+ *
+ * @param hash a pointer to a spatial hash returned from spatial_hash_init()
+ * @param center the position to search around
+ * @param radius the largest distance to visit points at
+ * @param visitor the function to call on each point found
+ * @param aux an auxiliary value to pass to the visitor
+ * @return the number of points visited
+ */
+size_t spatial_hash_query(spatial_hash_t *hash, vector_t center, double radius,
+                          spatial_hash_visitor_t visitor, void *aux);
+
+#endif // #ifndef __SPATIAL_HASH_H__
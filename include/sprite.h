@@ -28,6 +28,16 @@ typedef enum {
   MOVING_PLATFORM
 } sprite_type_t;
 
+/**
+ * Copies a sprite's info, its sprite_type_t identifier, so scenes of
+ * sprites can be saved with scene_snapshot().
+ * Every generate_*() function gives its body this copier.
+ *
+ * @param id the identifier, allocated with mem_alloc()
+ * @return a copy of the identifier, which mem_free() releases
+ */
+void *copy_sprite_id(void *id);
+
 /**
  * Generates the player sprite for the doodlejump game.
  *
@@ -7,6 +7,7 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "list.h"
 #include "vector.h"
 
 /**
@@ -45,6 +46,13 @@ bool within(double epsilon, double d1, double d2);
  */
 bool vec_within(double epsilon, vector_t v1, vector_t v2);
 
+/**
+ * Returns a list of the corners of an axis-aligned box, counterclockwise
+ * from the bottom left, for use as a body's shape.
+ * The corners are allocated with mem_alloc() and freed with the list.
+ */
+list_t *make_box(vector_t center, double half_width, double half_height);
+
 /**
  * Open the file 'filename', read one word into 'testname', and close the file.
  * If the file cannot be found, exit with error.
@@ -0,0 +1,512 @@
+#include "asset.h"
+#include "mem.h"
+#include <assert.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+ * File layout, in the byte order of the machine that packed it (the archive
+ * is a build product, like the .o files):
+ *   the header, then the index (one asset_entry_t per asset), then each
+ *   asset's bytes, starting on an ASSET_DATA_ALIGNMENT boundary.
+ * An image's bytes are its rows of pixels, pitch bytes apart;
+ * any other asset's bytes are the original file.
+ */
+#define ASSET_NAME_SIZE 64
+
+const char ASSET_MAGIC[4] = {'D', 'J', 'A', 'P'};
+const uint32_t ASSET_VERSION = 1;
+// Aligns pixel rows for SIMD blits and texture uploads
+const size_t ASSET_DATA_ALIGNMENT = 64;
+const uint32_t ASSET_BYTES_PER_PIXEL = 4;
+const char ASSET_IMAGE_SUFFIX[] = ".bmp";
+const char ASSET_FONT_SUFFIX[] = ".ttf";
+// Decoding is mostly file I/O, so a few threads are enough
+#define ASSET_MAX_WORKERS 4
+
+typedef enum { ASSET_IMAGE, ASSET_BLOB } asset_kind_t;
+
+typedef struct asset_header {
+  char magic[4];
+  uint32_t version;
+  uint32_t count;
+  uint32_t reserved;
+} asset_header_t;
+
+typedef struct asset_entry {
+  char name[ASSET_NAME_SIZE];
+  uint32_t kind;
+  uint32_t format;
+  int32_t width;
+  int32_t height;
+  int32_t pitch;
+  uint32_t reserved;
+  uint64_t offset;
+  uint64_t size;
+} asset_entry_t;
+
+// The open archive, shared by every thread; only read after asset_open()
+uint8_t *asset_map = NULL;
+size_t asset_map_size = 0;
+asset_entry_t *asset_entries = NULL;
+size_t asset_count = 0;
+
+typedef enum { ASSET_QUEUED, ASSET_LOADING, ASSET_LOADED } asset_state_t;
+
+/** An asset being loaded in the background: a future for its contents */
+typedef struct asset_preload {
+  char *path;
+  asset_kind_t kind;
+  atomic_int state;
+  // Set once the state is ASSET_LOADED
+  SDL_Surface *surface;
+  const uint8_t *bytes;
+  size_t size;
+  bool owns_bytes;
+} asset_preload_t;
+
+// The preloaded assets; the array is only written by asset_preload()
+asset_preload_t *asset_preloads = NULL;
+size_t asset_preload_count = 0;
+atomic_size_t asset_next_preload;
+SDL_Thread *asset_workers[ASSET_MAX_WORKERS];
+size_t asset_worker_count = 0;
+// Signalled whenever a preload finishes
+SDL_mutex *asset_lock = NULL;
+SDL_cond *asset_loaded = NULL;
+
+bool asset_open(const char *path) {
+  asset_close();
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(asset_header_t)) {
+    close(fd);
+    return false;
+  }
+  // Private and writable, so a stray write to a surface cannot fault
+  // or reach the file; untouched pages stay shared with the page cache
+  void *map = mmap(NULL, info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                   fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    return false;
+  }
+
+  asset_header_t *header = map;
+  size_t index_end =
+      sizeof(asset_header_t) + header->count * sizeof(asset_entry_t);
+  bool valid = memcmp(header->magic, ASSET_MAGIC, sizeof(ASSET_MAGIC)) == 0 &&
+               header->version == ASSET_VERSION &&
+               index_end <= (size_t)info.st_size;
+  asset_entry_t *entries = (asset_entry_t *)&header[1];
+  for (size_t i = 0; valid && i < header->count; i++) {
+    valid = entries[i].offset + entries[i].size <= (size_t)info.st_size &&
+            memchr(entries[i].name, '\0', ASSET_NAME_SIZE) != NULL;
+  }
+  if (!valid) {
+    munmap(map, info.st_size);
+    return false;
+  }
+  asset_map = map;
+  asset_map_size = info.st_size;
+  asset_entries = entries;
+  asset_count = header->count;
+  return true;
+}
+
+void asset_close(void) {
+  for (size_t i = 0; i < asset_worker_count; i++) {
+    SDL_WaitThread(asset_workers[i], NULL);
+  }
+  asset_worker_count = 0;
+  for (size_t i = 0; i < asset_preload_count; i++) {
+    asset_preload_t *preload = &asset_preloads[i];
+    if (preload->surface != NULL) {
+      SDL_FreeSurface(preload->surface);
+    }
+    if (preload->owns_bytes) {
+      mem_free((void *)preload->bytes);
+    }
+    mem_free(preload->path);
+  }
+  mem_free(asset_preloads);
+  asset_preloads = NULL;
+  asset_preload_count = 0;
+  if (asset_lock != NULL) {
+    SDL_DestroyCond(asset_loaded);
+    SDL_DestroyMutex(asset_lock);
+    asset_lock = NULL;
+    asset_loaded = NULL;
+  }
+  if (asset_map != NULL) {
+    munmap(asset_map, asset_map_size);
+  }
+  asset_map = NULL;
+  asset_map_size = 0;
+  asset_entries = NULL;
+  asset_count = 0;
+}
+
+/** Finds an asset in the open archive; there are few enough to scan */
+asset_entry_t *asset_find(const char *path, asset_kind_t kind) {
+  for (size_t i = 0; i < asset_count; i++) {
+    if (asset_entries[i].kind == kind &&
+        strcmp(asset_entries[i].name, path) == 0) {
+      return &asset_entries[i];
+    }
+  }
+  return NULL;
+}
+
+bool asset_has_suffix(const char *path, const char *suffix) {
+  size_t length = strlen(path);
+  size_t suffix_length = strlen(suffix);
+  return length >= suffix_length &&
+         strcmp(&path[length - suffix_length], suffix) == 0;
+}
+
+bool asset_is_image(const char *path) {
+  return asset_has_suffix(path, ASSET_IMAGE_SUFFIX);
+}
+
+/** Reads a whole file into memory; returns NULL if it cannot be read */
+uint8_t *asset_read_file(const char *path, size_t *size) {
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) {
+    return NULL;
+  }
+  uint8_t *bytes = NULL;
+  if (fseek(file, 0, SEEK_END) == 0) {
+    long length = ftell(file);
+    if (length >= 0 && fseek(file, 0, SEEK_SET) == 0) {
+      *size = length;
+      bytes = mem_alloc(*size > 0 ? *size : 1);
+      assert(bytes);
+      if (fread(bytes, 1, *size, file) != *size) {
+        mem_free(bytes);
+        bytes = NULL;
+      }
+    }
+  }
+  fclose(file);
+  return bytes;
+}
+
+/**
+ * Decodes an image into tightly packed rows of ASSET_PIXEL_FORMAT.
+ * Returns NULL if it cannot be read.
+ */
+uint8_t *asset_convert_image(const char *path, asset_entry_t *entry) {
+  SDL_Surface *loaded = SDL_LoadBMP(path);
+  if (loaded == NULL) {
+    return NULL;
+  }
+  SDL_Surface *converted =
+      SDL_ConvertSurfaceFormat(loaded, ASSET_PIXEL_FORMAT, 0);
+  SDL_FreeSurface(loaded);
+  if (converted == NULL) {
+    return NULL;
+  }
+  entry->format = ASSET_PIXEL_FORMAT;
+  entry->width = converted->w;
+  entry->height = converted->h;
+  entry->pitch = converted->w * ASSET_BYTES_PER_PIXEL;
+  entry->size = (uint64_t)entry->pitch * converted->h;
+  uint8_t *pixels = mem_alloc(entry->size > 0 ? entry->size : 1);
+  assert(pixels);
+  SDL_LockSurface(converted);
+  for (int y = 0; y < converted->h; y++) {
+    memcpy(&pixels[y * entry->pitch],
+           (uint8_t *)converted->pixels + y * converted->pitch, entry->pitch);
+  }
+  SDL_UnlockSurface(converted);
+  SDL_FreeSurface(converted);
+  return pixels;
+}
+
+/** Wraps pixels in a surface without copying them */
+SDL_Surface *asset_wrap_pixels(void *pixels, int width, int height, int pitch,
+                               uint32_t format) {
+  return SDL_CreateRGBSurfaceWithFormatFrom(
+      pixels, width, height, 8 * ASSET_BYTES_PER_PIXEL, pitch, format);
+}
+
+/** Loads an image from the archive, or else decodes its file */
+SDL_Surface *asset_decode_image(const char *path) {
+  asset_entry_t *entry = asset_find(path, ASSET_IMAGE);
+  if (entry != NULL) {
+    return asset_wrap_pixels(&asset_map[entry->offset], entry->width,
+                             entry->height, entry->pitch, entry->format);
+  }
+  SDL_Surface *loaded = SDL_LoadBMP(path);
+  if (loaded == NULL) {
+    return NULL;
+  }
+  SDL_Surface *converted =
+      SDL_ConvertSurfaceFormat(loaded, ASSET_PIXEL_FORMAT, 0);
+  SDL_FreeSurface(loaded);
+  return converted;
+}
+
+/** Finds a font's bytes in the archive, or else reads its file */
+const uint8_t *asset_read_font(const char *path, size_t *size,
+                               bool *owns_bytes) {
+  asset_entry_t *entry = asset_find(path, ASSET_BLOB);
+  if (entry != NULL) {
+    *size = entry->size;
+    *owns_bytes = false;
+    return &asset_map[entry->offset];
+  }
+  *owns_bytes = true;
+  return asset_read_file(path, size);
+}
+
+/** Loads a preload's contents, which the caller has claimed */
+void asset_load_preload(asset_preload_t *preload) {
+  if (preload->kind == ASSET_IMAGE) {
+    preload->surface = asset_decode_image(preload->path);
+  } else {
+    preload->bytes =
+        asset_read_font(preload->path, &preload->size, &preload->owns_bytes);
+  }
+  SDL_LockMutex(asset_lock);
+  atomic_store(&preload->state, ASSET_LOADED);
+  SDL_CondBroadcast(asset_loaded);
+  SDL_UnlockMutex(asset_lock);
+}
+
+/** Claims a preload for the caller to load; fails if it has been claimed */
+bool asset_claim(asset_preload_t *preload) {
+  int expected = ASSET_QUEUED;
+  return atomic_compare_exchange_strong(&preload->state, &expected,
+                                        ASSET_LOADING);
+}
+
+int asset_worker_main(void *aux) {
+  while (true) {
+    size_t i = atomic_fetch_add(&asset_next_preload, 1);
+    if (i >= asset_preload_count) {
+      return 0;
+    }
+    if (asset_claim(&asset_preloads[i])) {
+      asset_load_preload(&asset_preloads[i]);
+    }
+  }
+}
+
+/** Adds a preload for a file in the directory, if it is an image or font */
+void asset_add_preload(const char *directory, const char *file_name) {
+  asset_kind_t kind;
+  if (asset_is_image(file_name)) {
+    kind = ASSET_IMAGE;
+  } else if (asset_has_suffix(file_name, ASSET_FONT_SUFFIX)) {
+    kind = ASSET_BLOB;
+  } else {
+    return;
+  }
+  size_t path_size = strlen(directory) + 1 + strlen(file_name) + 1;
+  char *path = mem_alloc(path_size);
+  assert(path);
+  snprintf(path, path_size, "%s/%s", directory, file_name);
+  asset_preload_t *preload = &asset_preloads[asset_preload_count++];
+  *preload = (asset_preload_t){.path = path, .kind = kind};
+  atomic_init(&preload->state, ASSET_QUEUED);
+}
+
+void asset_preload(const char *directory) {
+  assert(asset_preloads == NULL);
+  DIR *dir = opendir(directory);
+  if (dir == NULL) {
+    return;
+  }
+  size_t capacity = 0;
+  while (readdir(dir) != NULL) {
+    capacity++;
+  }
+  rewinddir(dir);
+  asset_preloads = mem_calloc(capacity > 0 ? capacity : 1,
+                              sizeof(asset_preload_t));
+  assert(asset_preloads);
+  struct dirent *file;
+  while ((file = readdir(dir)) != NULL && asset_preload_count < capacity) {
+    asset_add_preload(directory, file->d_name);
+  }
+  closedir(dir);
+
+  asset_lock = SDL_CreateMutex();
+  asset_loaded = SDL_CreateCond();
+  assert(asset_lock && asset_loaded);
+  atomic_init(&asset_next_preload, 0);
+  size_t workers = SDL_GetCPUCount();
+  if (workers > ASSET_MAX_WORKERS) {
+    workers = ASSET_MAX_WORKERS;
+  }
+  if (workers > asset_preload_count) {
+    workers = asset_preload_count;
+  }
+  for (size_t i = 0; i < workers; i++) {
+    SDL_Thread *worker = SDL_CreateThread(asset_worker_main, "assets", NULL);
+    if (worker != NULL) {
+      asset_workers[asset_worker_count++] = worker;
+    }
+  }
+}
+
+asset_preload_t *asset_find_preload(const char *path, asset_kind_t kind) {
+  for (size_t i = 0; i < asset_preload_count; i++) {
+    if (asset_preloads[i].kind == kind &&
+        strcmp(asset_preloads[i].path, path) == 0) {
+      return &asset_preloads[i];
+    }
+  }
+  return NULL;
+}
+
+/**
+ * Waits for a preload to finish. If no worker has started it yet,
+ * loads it right away instead of waiting for one to get to it.
+ */
+void asset_await(asset_preload_t *preload) {
+  if (asset_claim(preload)) {
+    asset_load_preload(preload);
+    return;
+  }
+  if (atomic_load(&preload->state) == ASSET_LOADED) {
+    return;
+  }
+  SDL_LockMutex(asset_lock);
+  while (atomic_load(&preload->state) != ASSET_LOADED) {
+    SDL_CondWait(asset_loaded, asset_lock);
+  }
+  SDL_UnlockMutex(asset_lock);
+}
+
+bool asset_is_ready(const char *path) {
+  asset_preload_t *preload = asset_find_preload(path, ASSET_IMAGE);
+  if (preload == NULL) {
+    preload = asset_find_preload(path, ASSET_BLOB);
+  }
+  if (preload == NULL) {
+    return true;
+  }
+  int state = atomic_load(&preload->state);
+  // A queued asset is only waited for if a worker will get to it
+  return state == ASSET_LOADED ||
+         (state == ASSET_QUEUED && asset_worker_count == 0);
+}
+
+SDL_Surface *asset_load_image(const char *path) {
+  asset_preload_t *preload = asset_find_preload(path, ASSET_IMAGE);
+  if (preload == NULL) {
+    return asset_decode_image(path);
+  }
+  asset_await(preload);
+  SDL_Surface *surface = preload->surface;
+  // A new surface per caller, so threads never share a reference count
+  return surface != NULL
+             ? asset_wrap_pixels(surface->pixels, surface->w, surface->h,
+                                 surface->pitch, surface->format->format)
+             : NULL;
+}
+
+TTF_Font *asset_open_font(const char *path, int size) {
+  asset_preload_t *preload = asset_find_preload(path, ASSET_BLOB);
+  const uint8_t *bytes;
+  size_t bytes_size;
+  bool owns_bytes = false;
+  if (preload != NULL) {
+    asset_await(preload);
+    bytes = preload->bytes;
+    bytes_size = preload->size;
+  } else if (asset_find(path, ASSET_BLOB) != NULL) {
+    bytes = asset_read_font(path, &bytes_size, &owns_bytes);
+  } else {
+    return TTF_OpenFont(path, size);
+  }
+  if (bytes == NULL) {
+    return NULL;
+  }
+  SDL_RWops *rw = SDL_RWFromConstMem(bytes, bytes_size);
+  // Closing the font closes rw, which leaves the bytes alone
+  return rw != NULL ? TTF_OpenFontRW(rw, 1, size) : NULL;
+}
+
+size_t asset_align(size_t offset) {
+  return (offset + ASSET_DATA_ALIGNMENT - 1) / ASSET_DATA_ALIGNMENT *
+         ASSET_DATA_ALIGNMENT;
+}
+
+bool asset_pack(const char *archive_path, const char *const *paths,
+                size_t count) {
+  asset_entry_t *entries = mem_calloc(count > 0 ? count : 1,
+                                      sizeof(asset_entry_t));
+  uint8_t **data = mem_calloc(count > 0 ? count : 1, sizeof(uint8_t *));
+  assert(entries && data);
+  bool ok = true;
+  size_t offset = sizeof(asset_header_t) + count * sizeof(asset_entry_t);
+  for (size_t i = 0; ok && i < count; i++) {
+    asset_entry_t *entry = &entries[i];
+    if (strlen(paths[i]) >= ASSET_NAME_SIZE) {
+      fprintf(stderr, "asset: name too long: %s\n", paths[i]);
+      ok = false;
+      break;
+    }
+    strcpy(entry->name, paths[i]);
+    if (asset_is_image(paths[i])) {
+      entry->kind = ASSET_IMAGE;
+      data[i] = asset_convert_image(paths[i], entry);
+    } else {
+      entry->kind = ASSET_BLOB;
+      size_t size = 0;
+      data[i] = asset_read_file(paths[i], &size);
+      entry->size = size;
+    }
+    if (data[i] == NULL) {
+      fprintf(stderr, "asset: cannot read %s\n", paths[i]);
+      ok = false;
+      break;
+    }
+    offset = asset_align(offset);
+    entry->offset = offset;
+    offset += entry->size;
+  }
+
+  FILE *file = ok ? fopen(archive_path, "wb") : NULL;
+  if (ok && file == NULL) {
+    fprintf(stderr, "asset: cannot write %s\n", archive_path);
+    ok = false;
+  }
+  if (ok) {
+    asset_header_t header = {.version = ASSET_VERSION, .count = count};
+    memcpy(header.magic, ASSET_MAGIC, sizeof(ASSET_MAGIC));
+    ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+         (count == 0 ||
+          fwrite(entries, sizeof(asset_entry_t), count, file) == count);
+    size_t written = sizeof(asset_header_t) + count * sizeof(asset_entry_t);
+    uint8_t padding[ASSET_DATA_ALIGNMENT];
+    memset(padding, 0, sizeof(padding));
+    for (size_t i = 0; ok && i < count; i++) {
+      size_t padding_size = entries[i].offset - written;
+      ok = fwrite(padding, 1, padding_size, file) == padding_size &&
+           fwrite(data[i], 1, entries[i].size, file) == entries[i].size;
+      written = entries[i].offset + entries[i].size;
+    }
+    ok = fclose(file) == 0 && ok;
+  }
+  for (size_t i = 0; i < count; i++) {
+    mem_free(data[i]);
+  }
+  mem_free(data);
+  mem_free(entries);
+  return ok;
+}
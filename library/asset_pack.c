@@ -0,0 +1,16 @@
+#include "asset.h"
+#include <stdio.h>
+
+/*
+ * Packs images and fonts into an archive for asset_open(), e.g.
+ *   bin/asset_pack out/assets.pack assets/alien.bmp assets/Sans.ttf ...
+ * 'make assets' packs every image and font in "assets".
+ */
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <archive> <file>...\n", argv[0]);
+    return 1;
+  }
+  const char *const *paths = (const char *const *)&argv[2];
+  return asset_pack(argv[1], paths, argc - 2) ? 0 : 1;
+}
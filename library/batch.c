@@ -0,0 +1,145 @@
+#include "asset.h"
+#include "mem.h"
+#include "profiler.h"
+#include "replay.h"
+#include "rng.h"
+#include "sdl_wrapper.h"
+#include "state.h"
+#include <SDL2/SDL.h>
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * Runs many independent headless games of a demo at once, for bot evaluation
+ * and load testing. Each worker thread has its own sdl_context_t with
+ * RENDER_BACKEND_NONE and takes games from a shared counter until all are run.
+ * Every game is driven by a random bot and gets its own seed, so a run is
+ * repeatable for a given BATCH_SEED regardless of the number of threads.
+ *
+ * BATCH_GAMES (default 256) sets the number of games, BATCH_TICKS
+ * (default 600) the ticks each game runs for, and BATCH_THREADS
+ * (default: one per CPU) the number of worker threads.
+ */
+
+const size_t DEFAULT_BATCH_GAMES = 256;
+const size_t DEFAULT_BATCH_TICKS = 600;
+const uint64_t DEFAULT_BATCH_SEED = 1;
+const char BATCH_ASSET_ARCHIVE[] = "out/assets.pack";
+const char BATCH_ASSET_DIRECTORY[] = "assets";
+const double BATCH_TICK_DT = 1.0 / 60;
+// The bot picks a new move every this many ticks
+const size_t TICKS_PER_MOVE = 15;
+// Keys the bot picks from; a new game is started or restarted with ' '
+const char BOT_KEYS[] = {LEFT_ARROW, RIGHT_ARROW, 'w', ' '};
+
+typedef struct batch {
+  size_t games;
+  size_t ticks;
+  uint64_t seed;
+  atomic_size_t next_game;
+} batch_t;
+
+/** Reads a positive count from the environment */
+size_t count_from_env(const char *name, size_t default_count) {
+  char *value = getenv(name);
+  if (value == NULL || strtoul(value, NULL, 10) == 0) {
+    return default_count;
+  }
+  return strtoul(value, NULL, 10);
+}
+
+/**
+ * Makes the bot's move for a tick. Releases the key pressed by the last move,
+ * then presses a random key, or nothing.
+ */
+void bot_move(rng_t *rng, char *held_key, state_t *state) {
+  if (*held_key != '\0') {
+    sdl_dispatch_key(*held_key, KEY_RELEASED, 0, state);
+    *held_key = '\0';
+  }
+  size_t choice = rng_below(rng, sizeof(BOT_KEYS) + 1);
+  if (choice < sizeof(BOT_KEYS)) {
+    *held_key = BOT_KEYS[choice];
+    sdl_dispatch_key(*held_key, KEY_PRESSED, 0, state);
+  }
+}
+
+/** Runs one game for the batch's number of ticks */
+void run_game(batch_t *batch, size_t game) {
+  replay_set_seed(batch->seed + game);
+  rng_t bot;
+  rng_seed(&bot, batch->seed + game);
+
+  state_t *state = emscripten_init();
+  char held_key = '\0';
+  for (size_t tick = 0; tick < batch->ticks; tick++) {
+    emscripten_main(state);
+    if (tick == 0) {
+      // The first tick installs the key handler; start the game
+      sdl_dispatch_key(' ', KEY_PRESSED, 0, state);
+      sdl_dispatch_key(' ', KEY_RELEASED, 0, state);
+    } else if (tick % TICKS_PER_MOVE == 0) {
+      bot_move(&bot, &held_key, state);
+    }
+  }
+  emscripten_free(state);
+}
+
+int worker_main(void *aux) {
+  batch_t *batch = aux;
+  sdl_context_t *context = sdl_context_init();
+  sdl_set_context(context);
+  sdl_set_backend(RENDER_BACKEND_NONE);
+  sdl_set_fixed_dt(BATCH_TICK_DT);
+  while (true) {
+    size_t game = atomic_fetch_add(&batch->next_game, 1);
+    if (game >= batch->games) {
+      break;
+    }
+    run_game(batch, game);
+  }
+  sdl_context_free(context);
+  return 0;
+}
+
+int main() {
+  batch_t batch = {
+      .games = count_from_env("BATCH_GAMES", DEFAULT_BATCH_GAMES),
+      .ticks = count_from_env("BATCH_TICKS", DEFAULT_BATCH_TICKS),
+      .seed = count_from_env("BATCH_SEED", DEFAULT_BATCH_SEED),
+  };
+  atomic_init(&batch.next_game, 0);
+  // Every game loads the same sprites; map and decode them once for all
+  asset_open(BATCH_ASSET_ARCHIVE);
+  asset_preload(BATCH_ASSET_DIRECTORY);
+  size_t num_threads = count_from_env("BATCH_THREADS", SDL_GetCPUCount());
+  SDL_Thread **threads = mem_alloc(num_threads * sizeof(SDL_Thread *));
+  assert(threads);
+
+  uint64_t start = profiler_now_ns();
+  size_t started = 0;
+  for (size_t i = 0; i < num_threads; i++) {
+    threads[started] = SDL_CreateThread(worker_main, "batch", &batch);
+    if (threads[started] != NULL) {
+      started++;
+    }
+  }
+  if (started == 0) {
+    // No threads available; run every game here instead
+    worker_main(&batch);
+  }
+  for (size_t i = 0; i < started; i++) {
+    SDL_WaitThread(threads[i], NULL);
+  }
+  double seconds = (profiler_now_ns() - start) / 1e9;
+  mem_free(threads);
+
+  size_t steps = batch.games * batch.ticks;
+  printf("games,ticks,threads,steps,seconds,steps_per_sec\n");
+  printf("%zu,%zu,%zu,%zu,%.3f,%.1f\n", batch.games, batch.ticks,
+         started > 0 ? started : 1, steps, seconds, steps / seconds);
+  return 0;
+}
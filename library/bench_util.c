@@ -0,0 +1,111 @@
+#include "bench_util.h"
+#include "mem.h"
+#include "profiler.h"
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+const size_t DEFAULT_REPETITIONS = 20;
+const size_t WARMUP_REPETITIONS = 3;
+// Repetitions shorter than this are dominated by clock overhead
+const uint64_t MIN_REPETITION_NS = 1000000;
+const size_t MAX_ITERATIONS = (size_t)1 << 30;
+
+volatile double bench_sink;
+
+list_t *bench_make_polygon(size_t num_vertices, vector_t center, double radius) {
+  list_t *shape = list_init(num_vertices, mem_free);
+  for (size_t i = 0; i < num_vertices; i++) {
+    vector_t *vertex = mem_alloc(sizeof(vector_t));
+    assert(vertex);
+    double angle = 2 * M_PI * i / num_vertices;
+    *vertex = vec_add(center, vec_rotate((vector_t){radius, 0}, angle));
+    list_add(shape, vertex);
+  }
+  return shape;
+}
+
+void bench_consume(double value) { bench_sink = value; }
+
+/** Times one repetition, in nanoseconds */
+uint64_t time_repetition(bench_func_t func, void *aux, size_t iterations) {
+  uint64_t start = profiler_now_ns();
+  func(aux, iterations);
+  return profiler_now_ns() - start;
+}
+
+/** Doubles the iteration count until a repetition is long enough to time */
+size_t calibrate(bench_func_t func, void *aux) {
+  size_t iterations = 1;
+  while (iterations < MAX_ITERATIONS &&
+         time_repetition(func, aux, iterations) < MIN_REPETITION_NS) {
+    iterations *= 2;
+  }
+  return iterations;
+}
+
+int compare_doubles(const void *a, const void *b) {
+  double x = *(double *)a, y = *(double *)b;
+  return x < y ? -1 : x > y ? 1 : 0;
+}
+
+bench_result_t bench_run(const char *name, size_t param, bench_func_t func,
+                         void *aux) {
+  size_t repetitions = DEFAULT_REPETITIONS;
+  char *reps = getenv("BENCH_REPS");
+  if (reps != NULL && atoi(reps) > 0) {
+    repetitions = atoi(reps);
+  }
+
+  size_t iterations = calibrate(func, aux);
+  for (size_t i = 0; i < WARMUP_REPETITIONS; i++) {
+    time_repetition(func, aux, iterations);
+  }
+  double *samples = mem_alloc(repetitions * sizeof(double));
+  assert(samples);
+  double sum = 0;
+  for (size_t i = 0; i < repetitions; i++) {
+    samples[i] = (double)time_repetition(func, aux, iterations) / iterations;
+    sum += samples[i];
+  }
+  qsort(samples, repetitions, sizeof(double), compare_doubles);
+
+  double mean = sum / repetitions;
+  double variance = 0;
+  for (size_t i = 0; i < repetitions; i++) {
+    variance += (samples[i] - mean) * (samples[i] - mean);
+  }
+  bench_result_t result = {
+      .name = name,
+      .param = param,
+      .repetitions = repetitions,
+      .iterations = iterations,
+      .min_ns = samples[0],
+      .median_ns = samples[repetitions / 2],
+      .mean_ns = mean,
+      .p90_ns = samples[(repetitions * 9) / 10],
+      .max_ns = samples[repetitions - 1],
+      .stddev_ns = sqrt(variance / repetitions),
+  };
+  mem_free(samples);
+  return result;
+}
+
+void bench_print_header(FILE *file) {
+  fprintf(file, "name,param,repetitions,iterations,min_ns,median_ns,mean_ns,"
+                "p90_ns,max_ns,stddev_ns\n");
+}
+
+void bench_print_result(FILE *file, bench_result_t *result) {
+  fprintf(file, "%s,%zu,%zu,%zu,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f\n", result->name,
+          result->param, result->repetitions, result->iterations,
+          result->min_ns, result->median_ns, result->mean_ns, result->p90_ns,
+          result->max_ns, result->stddev_ns);
+  fflush(file);
+}
+
+void bench(const char *name, size_t param, bench_func_t func, void *aux) {
+  bench_result_t result = bench_run(name, param, func, aux);
+  bench_print_result(stdout, &result);
+}
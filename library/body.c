@@ -1,9 +1,12 @@
+#include "body.h"
 #include "color.h"
+#include "mem.h"
 #include "list.h"
 #include "image.h"
 #include "polygon.h"
 #include "vector.h"
 #include <assert.h>
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -17,8 +20,13 @@ typedef struct body {
   vector_t impulse;
   rgb_color_t color;
   vector_t centroid;
+  double elasticity;
+  size_t layer;
+  // The shape's polygon_min_extent(), which only rotation changes
+  double extent;
   void *info;
   free_func_t info_freer;
+  copy_func_t info_copier;
   bool removed;
   image_t *image;
   vector_t image_size;
@@ -27,7 +35,7 @@ typedef struct body {
 
 body_t *body_init_with_info(list_t *shape, double mass, rgb_color_t color,
                             void *info, free_func_t info_freer, image_t *image) {
-  body_t *body = malloc(sizeof(body_t));
+  body_t *body = mem_alloc(sizeof(body_t));
   assert(body);
   body->shape = shape;
   body->mass = mass;
@@ -38,15 +46,19 @@ body_t *body_init_with_info(list_t *shape, double mass, rgb_color_t color,
   body->impulse = VEC_ZERO;
   body->color = color;
   body->centroid = polygon_centroid(body->shape);
+  body->elasticity = NAN;
+  body->layer = 0;
+  body->extent = polygon_min_extent(shape);
   body->info = info;
   body->info_freer = info_freer;
+  body->info_copier = NULL;
   body->removed = false;
   body->image = image;
   return body;
 }
 
 body_t *body_init(list_t *shape, double mass, rgb_color_t color) {
-  return body_init_with_info(shape, mass, color, NULL, free, NULL);
+  return body_init_with_info(shape, mass, color, NULL, mem_free, NULL);
 }
 
 image_t *body_get_image(body_t *body) { return body->image; }
@@ -60,7 +72,7 @@ void body_free(void *b) {
   if (body->image != NULL) {
     image_free(body->image);
   }
-  free(body);
+  mem_free(body);
 }
 
 list_t *body_get_shape(body_t *body) { return list_copy(body->shape); }
@@ -69,6 +81,8 @@ vector_t body_get_centroid(body_t *body) { return body->centroid; }
 
 vector_t body_get_velocity(body_t *body) { return body->velocity; }
 
+double body_get_angle(body_t *body) { return body->angle; }
+
 rgb_color_t body_get_color(body_t *body) { return body->color; }
 
 void *body_get_info(body_t *body) { return body->info; }
@@ -87,10 +101,26 @@ void body_set_velocity(body_t *body, vector_t v) { body->velocity = v; }
 void body_set_rotation(body_t *body, double angle) {
   polygon_rotate(body->shape, angle - body->angle, body->centroid);
   body->angle = angle;
+  body->extent = polygon_min_extent(body->shape);
 }
 
 double body_get_mass(body_t *body) { return body->mass; }
 
+double body_get_extent(body_t *body) { return body->extent; }
+
+double body_get_elasticity(body_t *body) { return body->elasticity; }
+
+void body_set_elasticity(body_t *body, double elasticity) {
+  body->elasticity = elasticity;
+}
+
+size_t body_get_layer(body_t *body) { return body->layer; }
+
+void body_set_layer(body_t *body, size_t layer) {
+  assert(layer < BODY_LAYERS);
+  body->layer = layer;
+}
+
 void body_add_force(body_t *body, vector_t force) {
   body->force = vec_add(body->force, force);
 }
@@ -100,13 +130,18 @@ void body_add_impulse(body_t *body, vector_t impulse) {
 }
 
 void body_tick(body_t *body, double dt) {
-  body->acceleration = vec_multiply(1.0 / body->mass, body->force);
-  vector_t dv = vec_multiply(dt, body->acceleration);
+  vector_t acceleration = vec_multiply(1.0 / body->mass, body->force);
+  vector_t dv = vec_multiply(dt, acceleration);
   vector_t new_velo = vec_add(body->velocity, dv);
   new_velo = vec_add(new_velo, vec_multiply(1.0 / body->mass, body->impulse));
   vector_t avg_velo = vec_multiply(0.5, vec_add(body->velocity, new_velo));
-  body->velocity = new_velo;
-  vector_t dx = vec_multiply(dt, avg_velo);
+  body_apply_step(body, vec_multiply(dt, avg_velo), new_velo, acceleration);
+}
+
+void body_apply_step(body_t *body, vector_t dx, vector_t velocity,
+                     vector_t acceleration) {
+  body->acceleration = acceleration;
+  body->velocity = velocity;
   polygon_translate(body->shape, dx);
   body->centroid = vec_add(body->centroid, dx);
   body->force = VEC_ZERO;
@@ -115,4 +150,42 @@ void body_tick(body_t *body, double dt) {
 
 void body_remove(body_t *body) { body->removed = true; }
 
-bool body_is_removed(body_t *body) { return body->removed; }
\ No newline at end of file
+bool body_is_removed(body_t *body) { return body->removed; }
+
+body_state_t body_get_state(body_t *body) {
+  return (body_state_t){
+      .mass = body->mass,
+      .angle = body->angle,
+      .velocity = body->velocity,
+      .acceleration = body->acceleration,
+      .force = body->force,
+      .impulse = body->impulse,
+      .color = body->color,
+      .centroid = body->centroid,
+      .elasticity = body->elasticity,
+      .layer = body->layer,
+      .removed = body->removed,
+  };
+}
+
+void body_set_state(body_t *body, body_state_t state) {
+  body->mass = state.mass;
+  body->angle = state.angle;
+  body->velocity = state.velocity;
+  body->acceleration = state.acceleration;
+  body->force = state.force;
+  body->impulse = state.impulse;
+  body->color = state.color;
+  body->centroid = state.centroid;
+  body->elasticity = state.elasticity;
+  body->layer = state.layer;
+  body->removed = state.removed;
+}
+
+free_func_t body_get_info_freer(body_t *body) { return body->info_freer; }
+
+void body_set_info_copier(body_t *body, copy_func_t info_copier) {
+  body->info_copier = info_copier;
+}
+
+copy_func_t body_get_info_copier(body_t *body) { return body->info_copier; }
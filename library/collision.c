@@ -1,4 +1,6 @@
 #include "collision.h"
+#include "mem.h"
+#include "polygon.h"
 #include "vector.h"
 #include <assert.h>
 #include <math.h>
@@ -6,21 +8,21 @@
 #include <stdlib.h>
 
 list_t *projection(list_t *shape, vector_t axis) {
-  list_t *endpoints = list_init(2, free);
-  list_t *projections = list_init(list_size(shape), free);
+  list_t *endpoints = list_init(2, mem_free);
+  list_t *projections = list_init(list_size(shape), mem_free);
   // find all projections
   for (size_t i = 0; i < list_size(shape); i++) {
     vector_t *vertex = list_get(shape, i);
-    double *dot = malloc(sizeof(double));
+    double *dot = mem_alloc(sizeof(double));
     assert(dot);
     *dot = vec_dot(*vertex, axis);
     list_add(projections, dot);
   }
   // identify min and max projections
-  double *min = malloc(sizeof(double));
+  double *min = mem_alloc(sizeof(double));
   assert(min);
   *min = *((double *)list_get(projections, 0));
-  double *max = malloc(sizeof(double));
+  double *max = mem_alloc(sizeof(double));
   assert(max);
   *max = *((double *)list_get(projections, 0));
   for (size_t i = 1; i < list_size(projections); i++) {
@@ -59,7 +61,7 @@ double proj_overlap(list_t *proj1, list_t *proj2) {
 }
 
 collision_info_t find_collision(list_t *shape1, list_t *shape2) {
-  collision_info_t info = {true, VEC_ZERO};
+  collision_info_t info = {true, VEC_ZERO, 0};
   double curr_min_overlap = 0;
   for (size_t i = 0; i < list_size(shape1); i++) {
     size_t next_i = i + 1;
@@ -72,10 +74,11 @@ collision_info_t find_collision(list_t *shape1, list_t *shape2) {
     vector_t perp_vec = vec_norm(vec_perpendicular(edge));
     list_t *proj1 = projection(shape1, perp_vec);
     list_t *proj2 = projection(shape2, perp_vec);
+    info.axes_tested++;
     if (not_overlap(proj1, proj2)) {
       list_free(proj1);
       list_free(proj2);
-      return (collision_info_t){false, VEC_ZERO};
+      return (collision_info_t){false, VEC_ZERO, info.axes_tested};
     } else {
       double overlap_amount = proj_overlap(proj1, proj2);
       if (curr_min_overlap == 0 || overlap_amount < curr_min_overlap) {
@@ -97,10 +100,11 @@ collision_info_t find_collision(list_t *shape1, list_t *shape2) {
     vector_t perp_vec = vec_norm(vec_perpendicular(edge));
     list_t *proj1 = projection(shape1, perp_vec);
     list_t *proj2 = projection(shape2, perp_vec);
+    info.axes_tested++;
     if (not_overlap(proj1, proj2)) {
       list_free(proj1);
       list_free(proj2);
-      return (collision_info_t){false, VEC_ZERO};
+      return (collision_info_t){false, VEC_ZERO, info.axes_tested};
     } else {
       double overlap_amount = proj_overlap(proj1, proj2);
       if (curr_min_overlap == 0 || overlap_amount < curr_min_overlap) {
@@ -113,3 +117,84 @@ collision_info_t find_collision(list_t *shape1, list_t *shape2) {
   }
   return info;
 }
+
+/** Projects a shape onto an axis without allocating, unlike projection() */
+void project_shape(list_t *shape, vector_t axis, double *min, double *max) {
+  *min = INFINITY;
+  *max = -INFINITY;
+  for (size_t i = 0; i < list_size(shape); i++) {
+    double dot = vec_dot(*(vector_t *)list_get(shape, i), axis);
+    *min = fmin(*min, dot);
+    *max = fmax(*max, dot);
+  }
+}
+
+/**
+ * Narrows the times at which shape2 overlaps shape1 on one axis, as shape2
+ * moves relative to shape1. Returns false if they never overlap on it.
+ */
+bool sweep_axis(list_t *shape1, list_t *shape2, vector_t relative_motion,
+                vector_t axis, double *enter, vector_t *enter_axis,
+                double *exit) {
+  double min1, max1, min2, max2;
+  project_shape(shape1, axis, &min1, &max1);
+  project_shape(shape2, axis, &min2, &max2);
+  double speed = vec_dot(relative_motion, axis);
+  if (speed == 0) {
+    return max2 >= min1 && min2 <= max1;
+  }
+  // The times at which shape2's interval starts and stops overlapping shape1's
+  double axis_enter = (speed > 0 ? min1 - max2 : max1 - min2) / speed;
+  double axis_exit = (speed > 0 ? max1 - min2 : min1 - max2) / speed;
+  if (axis_enter > *enter) {
+    *enter = axis_enter;
+    *enter_axis = axis;
+  }
+  *exit = fmin(*exit, axis_exit);
+  return *enter <= *exit;
+}
+
+/** Sweeps every edge normal of one shape; returns false once they miss */
+bool sweep_edges(list_t *edges_shape, list_t *shape1, list_t *shape2,
+                 vector_t relative_motion, double *enter, vector_t *enter_axis,
+                 double *exit) {
+  size_t num_vertices = list_size(edges_shape);
+  for (size_t i = 0; i < num_vertices; i++) {
+    vector_t *vertex1 = list_get(edges_shape, i);
+    vector_t *vertex2 = list_get(edges_shape, (i + 1) % num_vertices);
+    vector_t axis = vec_norm(vec_perpendicular(vec_subtract(*vertex1, *vertex2)));
+    if (!sweep_axis(shape1, shape2, relative_motion, axis, enter, enter_axis,
+                    exit)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+impact_info_t find_impact(list_t *shape1, vector_t motion1, list_t *shape2,
+                          vector_t motion2) {
+  impact_info_t info = {false, 0, VEC_ZERO};
+  // Work in shape1's frame, over the step's times from 0 to 1
+  vector_t relative_motion = vec_subtract(motion2, motion1);
+  double enter = -INFINITY, exit = INFINITY;
+  vector_t axis = VEC_ZERO;
+  if (!sweep_edges(shape1, shape1, shape2, relative_motion, &enter, &axis,
+                   &exit) ||
+      !sweep_edges(shape2, shape1, shape2, relative_motion, &enter, &axis,
+                   &exit) ||
+      enter > 1 || exit < 0) {
+    return info;
+  }
+  info.collided = true;
+  info.time = fmax(enter, 0);
+  // Point the normal from shape1 towards shape2, where they touch
+  vector_t offset = vec_add(
+      vec_subtract(polygon_centroid(shape2), polygon_centroid(shape1)),
+      vec_multiply(info.time, relative_motion));
+  if (enter == -INFINITY) {
+    // Overlapping without moving along any axis: push apart between centers
+    axis = vec_magnitude(offset) > 0 ? vec_norm(offset) : (vector_t){0, 1};
+  }
+  info.axis = vec_dot(offset, axis) < 0 ? vec_negate(axis) : axis;
+  return info;
+}
@@ -1,25 +1,98 @@
+#include "asset.h"
+#include "frame_pacer.h"
 #include "math.h"
+#include "mem.h"
+#include "perf.h"
+#include "profiler.h"
+#include "replay.h"
 #include "scene.h"
 #include "sdl_wrapper.h"
 #include "state.h"
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #ifdef __EMSCRIPTEN__
 #include <emscripten.h>
 #endif
 
-state_t *state;
+// Native frame pacing: frames per second and fixed simulation ticks per second
+const double TARGET_FPS = 60;
+const double TICK_RATE = 60;
+// The packed assets built by 'make assets'; ASSET_ARCHIVE=<file> overrides it
+const char DEFAULT_ASSET_ARCHIVE[] = "out/assets.pack";
+const char ASSET_DIRECTORY[] = "assets";
 
-void loop() {
+/**
+ * Everything the main loop keeps for the game it runs.
+ * The wrapper's own per-game state lives in the thread's sdl_context_t.
+ */
+typedef struct game {
+  state_t *state;
+  frame_pacer_t *pacer;
+  size_t ticks_run;
+  // MEM_STEADY_AFTER=<ticks> aborts on any allocation after that many ticks
+  size_t mem_steady_after;
+} game_t;
+
+void loop(void *arg) {
+  game_t *game = arg;
   // If needed, generate a pointer to our initial state
-  if (!state) {
-    state = emscripten_init();
+  if (!game->state) {
+    game->state = emscripten_init();
+    // RENDER_STATS_OVERLAY=1 shows each frame's draw calls and uploads
+    if (getenv("RENDER_STATS_OVERLAY") != NULL) {
+      sdl_set_stats_overlay(true);
+    }
+    char *steady_after = getenv("MEM_STEADY_AFTER");
+    if (steady_after != NULL) {
+      game->mem_steady_after = strtoul(steady_after, NULL, 10);
+    }
+#ifndef __EMSCRIPTEN__
+    // RENDER_THREAD=1 overlaps drawing a frame with simulating the next one,
+    // with RENDER_BACKEND=software or dummy
+    if (getenv("RENDER_THREAD") != NULL) {
+      sdl_start_render_thread();
+    }
+#endif
   }
 
-  emscripten_main(state);
+  if (game->ticks_run == game->mem_steady_after) {
+    mem_set_steady_state(true);
+  }
+  mem_tick_begin();
+  PERF_BEGIN(frame_zone, "frame");
+  emscripten_main(game->state);
+  PERF_END(frame_zone);
+  mem_tick_end();
+  game->ticks_run++;
 
-  if (sdl_is_done(state)) { // Once our demo exits...
-    emscripten_free(state); // Free any state variables we've been using
+  if (sdl_is_done(game->state)) { // Once our demo exits...
+    replay_stop(); // Finish the recording on the tick the session ended
+    sdl_stop_render_thread(); // Stop drawing frames that reference the state
+    emscripten_free(game->state); // Free any state variables we've been using
+    // MEM_REPORT=1 lists where the library allocated, busiest sites first
+    if (getenv("MEM_REPORT") != NULL) {
+      mem_report(stderr);
+    }
+#ifdef PROFILE
+    profiler_write_chrome_trace("out/profile.json");
+    profiler_write_csv_summary("out/profile.csv");
+#endif
+#ifdef PERF_COUNTERS
+    if (!perf_write_csv("out/perf.csv") || perf_phases() == 0) {
+      fprintf(stderr, "perf: no hardware counters recorded\n");
+    }
+#endif
+    if (game->pacer) {
+      frame_pacer_stats_t stats = frame_pacer_get_stats(game->pacer);
+      fprintf(stderr,
+              "frames: %zu rendered: %zu late: %zu missed: %zu "
+              "dropped ticks: %zu max frame: %.2f ms\n",
+              stats.frames, stats.rendered_frames, stats.late_frames,
+              stats.missed_frames, stats.dropped_ticks,
+              stats.max_frame_time * 1e3);
+      frame_pacer_free(game->pacer);
+    }
 #ifdef __EMSCRIPTEN__ // Clean up emscripten environment (if we're using it)
     emscripten_cancel_main_loop();
     emscripten_force_exit(0);
@@ -28,15 +101,60 @@ void loop() {
 #endif
     return;
   }
+  replay_next_tick();
 }
 
 int main() {
+  // Static, since emscripten unwinds main's stack once the main loop is set
+  static game_t game = {.mem_steady_after = SIZE_MAX};
+  // Without an archive, assets are loaded one file at a time
+  char *archive = getenv("ASSET_ARCHIVE");
+  asset_open(archive != NULL ? archive : DEFAULT_ASSET_ARCHIVE);
+  // Decode the rest in the background while the first frames run
+  asset_preload(ASSET_DIRECTORY);
 #ifdef __EMSCRIPTEN__
   // Set loop as the function emscripten calls to request a new frame
-  emscripten_set_main_loop_arg(loop, NULL, 0, 1);
+  emscripten_set_main_loop_arg(loop, &game, 0, 1);
 #else
+  // Natively, RENDER_BACKEND=software|dummy renders without a display
+  render_backend_t backend = sdl_backend_from_env();
+  pacing_mode_t pacing = frame_pacer_mode_from_env();
+  double tick_rate = TICK_RATE;
+  // REPLAY_PLAY=<file> replays a recorded session without a window,
+  // at the recorded tick length and as fast as possible
+  char *replay_path = getenv("REPLAY_PLAY");
+  if (replay_path != NULL) {
+    if (!replay_start_playback(replay_path)) {
+      fprintf(stderr, "replay: cannot read %s\n", replay_path);
+      exit(1);
+    }
+    if (backend == RENDER_BACKEND_WINDOW) {
+      backend = RENDER_BACKEND_DUMMY;
+    }
+    pacing = PACING_HEADLESS;
+    tick_rate = 1 / replay_dt();
+  }
+  sdl_set_backend(backend);
+  // Pace frames ourselves instead of trusting vsync; FRAME_PACING picks how
+  frame_pacer_t *pacer = frame_pacer_init(pacing, TARGET_FPS, tick_rate);
+  game.pacer = pacer;
+  sdl_set_fixed_dt(frame_pacer_tick_dt(pacer));
+  // REPLAY_RECORD=<file> records the session's key events for REPLAY_PLAY
+  char *record_path = getenv("REPLAY_RECORD");
+  if (record_path != NULL && replay_path == NULL &&
+      !replay_start_recording(record_path, replay_seed(),
+                              frame_pacer_tick_dt(pacer))) {
+    fprintf(stderr, "replay: cannot write %s\n", record_path);
+  }
   while (1) {
-    loop();
+    // The simulation always advances at TICK_RATE; only the last tick of a
+    // frame is drawn, and only if the pacer wants this frame rendered
+    size_t ticks = frame_pacer_begin_frame(pacer);
+    for (size_t i = 0; i < ticks; i++) {
+      sdl_set_render_enabled(i + 1 == ticks && frame_pacer_should_render(pacer));
+      loop(&game);
+    }
+    frame_pacer_end_frame(pacer);
   }
 #endif
 }
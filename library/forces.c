@@ -1,4 +1,5 @@
 #include "forces.h"
+#include "mem.h"
 #include "collision.h"
 #include "polygon.h"
 #include "scene.h"
@@ -6,6 +7,7 @@
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 const double MIN_GRAV_DISTANCE = 5.0;
 
@@ -17,21 +19,73 @@ typedef struct spring_auxillary {
   double spring_constant;
 } spring_auxillary_t;
 
+/**
+ * A spring network's edges in compressed sparse row (CSR) form: the edges of
+ * row i, the springs from body i to higher-numbered bodies, are
+ * row_start[i] up to row_start[i + 1], and each edge stores the other body.
+ * Everything, including the per-tick scratch arrays, follows the header in
+ * one allocation, so scene snapshots copy the whole network.
+ */
+typedef struct spring_network {
+  size_t num_bodies;
+  size_t num_edges;
+} spring_network_t;
+
+/** Pointers into the arrays after a spring_network_t header */
+typedef struct spring_network_arrays {
+  // Per edge
+  double *stiffness;
+  double *rest_length;
+  double *damping;
+  double *force_x;
+  double *force_y;
+  // Per body, gathered from and scattered to the bodies each tick
+  double *x;
+  double *y;
+  double *velocity_x;
+  double *velocity_y;
+  double *net_x;
+  double *net_y;
+  // CSR indices, after the doubles so every array stays aligned
+  size_t *row_start;
+  size_t *column;
+} spring_network_arrays_t;
+
 typedef struct drag_auxillary {
   double drag_constant;
 } drag_auxillary_t;
 
-typedef struct physics_collision_auxillary {
-  double elasticity;
-} physics_collision_auxillary_t;
-
 typedef struct horizontal_motion_auxillary {
   vector_t window;
   int64_t speed;
   size_t buffer;
 } horizontal_motion_auxillary_t;
 
-void auxillary_freer(void *auxillary) { free(auxillary); }
+void auxillary_freer(void *auxillary) { mem_free(auxillary); }
+
+/** Copies the first size bytes of an aux into new memory */
+void *auxillary_copy(void *auxillary, size_t size) {
+  void *copy = mem_alloc(size);
+  assert(copy);
+  memcpy(copy, auxillary, size);
+  return copy;
+}
+
+void *gravity_auxillary_copier(void *auxillary) {
+  return auxillary_copy(auxillary, sizeof(gravity_auxillary_t));
+}
+
+void *spring_auxillary_copier(void *auxillary) {
+  return auxillary_copy(auxillary, sizeof(spring_auxillary_t));
+}
+
+void *drag_auxillary_copier(void *auxillary) {
+  return auxillary_copy(auxillary, sizeof(drag_auxillary_t));
+}
+
+void *horizontal_motion_auxillary_copier(void *auxillary) {
+  return auxillary_copy(auxillary, sizeof(horizontal_motion_auxillary_t));
+}
 
 void newtonian_gravity_force_creator(void *auxillary, list_t *bodies) {
   gravity_auxillary_t *aux = (gravity_auxillary_t *)auxillary;
@@ -56,11 +110,12 @@ void newtonian_gravity_force_creator(void *auxillary, list_t *bodies) {
 }
 
 void create_newtonian_gravity(scene_t *scene, double G, list_t *bodies) {
-  gravity_auxillary_t *aux = malloc(sizeof(gravity_auxillary_t));
+  gravity_auxillary_t *aux = mem_alloc(sizeof(gravity_auxillary_t));
   assert(aux);
   aux->grav_constant = G;
-  scene_add_bodies_force_creator(scene, newtonian_gravity_force_creator, NULL,
-                                 aux, bodies, auxillary_freer);
+  scene_add_pure_force_creator(scene, "newtonian_gravity",
+                               newtonian_gravity_force_creator, aux, bodies,
+                               auxillary_freer, gravity_auxillary_copier);
 }
 
 void create_newtonian_gravity_old(scene_t *scene, double G, body_t *body1,
@@ -82,11 +137,12 @@ void downward_gravity_force_creator(void *auxillary, list_t *bodies) {
 void create_downward_gravity(scene_t *scene, double G, body_t *body) {
   list_t *bodies = list_init(1, (void *)body_free);
   list_add(bodies, body);
-  gravity_auxillary_t *aux = malloc(sizeof(gravity_auxillary_t));
+  gravity_auxillary_t *aux = mem_alloc(sizeof(gravity_auxillary_t));
   assert(aux);
   aux->grav_constant = G;
-  scene_add_bodies_force_creator(scene, downward_gravity_force_creator, NULL,
-                                 aux, bodies, auxillary_freer);
+  scene_add_pure_force_creator(scene, "downward_gravity",
+                               downward_gravity_force_creator, aux, bodies,
+                               auxillary_freer, gravity_auxillary_copier);
 }
 void spring_force_creator(void *auxillary, list_t *bodies) {
   spring_auxillary_t *aux = (spring_auxillary_t *)auxillary;
@@ -105,11 +161,11 @@ void spring_force_creator(void *auxillary, list_t *bodies) {
 }
 
 void create_spring(scene_t *scene, double k, list_t *bodies) {
-  spring_auxillary_t *aux = malloc(sizeof(spring_auxillary_t));
+  spring_auxillary_t *aux = mem_alloc(sizeof(spring_auxillary_t));
   assert(aux);
   aux->spring_constant = k;
-  scene_add_bodies_force_creator(scene, spring_force_creator, NULL, aux, bodies,
-                                 auxillary_freer);
+  scene_add_pure_force_creator(scene, "spring", spring_force_creator, aux,
+                               bodies, auxillary_freer, spring_auxillary_copier);
 }
 
 void create_spring_old(scene_t *scene, double k, body_t *body1, body_t *body2) {
@@ -119,10 +175,149 @@ void create_spring_old(scene_t *scene, double k, body_t *body1, body_t *body2) {
   create_spring(scene, k, bodies);
 }
 
+size_t spring_network_size(size_t num_bodies, size_t num_edges) {
+  const size_t edge_doubles = 5, body_doubles = 6;
+  return sizeof(spring_network_t) +
+         (edge_doubles * num_edges + body_doubles * num_bodies) *
+             sizeof(double) +
+         (num_bodies + 1 + num_edges) * sizeof(size_t);
+}
+
+spring_network_arrays_t spring_network_arrays(spring_network_t *network) {
+  size_t e = network->num_edges, n = network->num_bodies;
+  double *doubles = (double *)(network + 1);
+  size_t *indices = (size_t *)&doubles[5 * e + 6 * n];
+  return (spring_network_arrays_t){
+      .stiffness = doubles,
+      .rest_length = &doubles[e],
+      .damping = &doubles[2 * e],
+      .force_x = &doubles[3 * e],
+      .force_y = &doubles[4 * e],
+      .x = &doubles[5 * e],
+      .y = &doubles[5 * e + n],
+      .velocity_x = &doubles[5 * e + 2 * n],
+      .velocity_y = &doubles[5 * e + 3 * n],
+      .net_x = &doubles[5 * e + 4 * n],
+      .net_y = &doubles[5 * e + 5 * n],
+      .row_start = indices,
+      .column = &indices[n + 1],
+  };
+}
+
+void *spring_network_copier(void *auxillary) {
+  spring_network_t *network = auxillary;
+  return auxillary_copy(
+      network, spring_network_size(network->num_bodies, network->num_edges));
+}
+
+/**
+ * Computes the force on the first body of each edge in row i, from the
+ * gathered positions and velocities, reading contiguous arrays
+ */
+void spring_network_row_forces(spring_network_arrays_t *a, size_t i) {
+  double x = a->x[i], y = a->y[i];
+  double velocity_x = a->velocity_x[i], velocity_y = a->velocity_y[i];
+  double net_x = 0, net_y = 0;
+  for (size_t e = a->row_start[i]; e < a->row_start[i + 1]; e++) {
+    size_t j = a->column[e];
+    double dx = a->x[j] - x, dy = a->y[j] - y;
+    double length = sqrt(dx * dx + dy * dy);
+    // Coincident bodies have no spring direction, so no force
+    double inverse_length = length > 0 ? 1 / length : 0;
+    double stretch = length > 0 ? length - a->rest_length[e] : 0;
+    double closing = (a->velocity_x[j] - velocity_x) * dx +
+                     (a->velocity_y[j] - velocity_y) * dy;
+    double magnitude = (a->stiffness[e] * stretch +
+                        a->damping[e] * closing * inverse_length) *
+                       inverse_length;
+    a->force_x[e] = magnitude * dx;
+    a->force_y[e] = magnitude * dy;
+    net_x += magnitude * dx;
+    net_y += magnitude * dy;
+  }
+  a->net_x[i] += net_x;
+  a->net_y[i] += net_y;
+}
+
+void spring_network_force_creator(void *auxillary, list_t *bodies) {
+  spring_network_t *network = auxillary;
+  spring_network_arrays_t a = spring_network_arrays(network);
+  size_t n = network->num_bodies;
+  for (size_t i = 0; i < n; i++) {
+    body_t *body = list_get(bodies, i);
+    vector_t centroid = body_get_centroid(body);
+    vector_t velocity = body_get_velocity(body);
+    a.x[i] = centroid.x;
+    a.y[i] = centroid.y;
+    a.velocity_x[i] = velocity.x;
+    a.velocity_y[i] = velocity.y;
+    a.net_x[i] = 0;
+    a.net_y[i] = 0;
+  }
+  for (size_t i = 0; i < n; i++) {
+    spring_network_row_forces(&a, i);
+  }
+  // Each edge pulls its second body the opposite way
+  for (size_t e = 0; e < network->num_edges; e++) {
+    a.net_x[a.column[e]] -= a.force_x[e];
+    a.net_y[a.column[e]] -= a.force_y[e];
+  }
+  for (size_t i = 0; i < n; i++) {
+    body_add_force(list_get(bodies, i), (vector_t){a.net_x[i], a.net_y[i]});
+  }
+}
+
+/** The row an edge is stored in: its lower-numbered body */
+size_t spring_edge_row(spring_edge_t edge) {
+  return edge.body1 < edge.body2 ? edge.body1 : edge.body2;
+}
+
+void create_spring_network(scene_t *scene, list_t *bodies,
+                           const spring_edge_t *edges, size_t num_edges) {
+  size_t num_bodies = list_size(bodies);
+  spring_network_t *network =
+      mem_alloc(spring_network_size(num_bodies, num_edges));
+  assert(network);
+  network->num_bodies = num_bodies;
+  network->num_edges = num_edges;
+  spring_network_arrays_t a = spring_network_arrays(network);
+
+  // Counting sort of the edges by their lower body
+  for (size_t i = 0; i <= num_bodies; i++) {
+    a.row_start[i] = 0;
+  }
+  for (size_t e = 0; e < num_edges; e++) {
+    assert(edges[e].body1 < num_bodies && edges[e].body2 < num_bodies);
+    assert(edges[e].body1 != edges[e].body2);
+    a.row_start[spring_edge_row(edges[e]) + 1]++;
+  }
+  for (size_t i = 0; i < num_bodies; i++) {
+    a.row_start[i + 1] += a.row_start[i];
+  }
+  // Fill each row using its start as a cursor, which ends at the row's end
+  for (size_t e = 0; e < num_edges; e++) {
+    size_t row = spring_edge_row(edges[e]);
+    size_t slot = a.row_start[row]++;
+    a.column[slot] = edges[e].body1 + edges[e].body2 - row;
+    a.stiffness[slot] = edges[e].stiffness;
+    a.rest_length[slot] = edges[e].rest_length;
+    a.damping[slot] = edges[e].damping;
+  }
+  // Each row's end is the next row's start
+  for (size_t i = num_bodies; i > 0; i--) {
+    a.row_start[i] = a.row_start[i - 1];
+  }
+  a.row_start[0] = 0;
+
+  scene_add_pure_force_creator(scene, "spring_network",
+                               spring_network_force_creator, network, bodies,
+                               auxillary_freer, spring_network_copier);
+}
+
 void create_drag_old(scene_t *scene, double gamma, body_t *body) {
   list_t *bodies = list_init(1, (void *)body_free);
   list_add(bodies, body);
-  create_spring(scene, gamma, bodies);
+  create_drag(scene, gamma, bodies);
 }
 
 void drag_force_creator(void *auxillary, list_t *bodies) {
@@ -137,11 +332,11 @@ void drag_force_creator(void *auxillary, list_t *bodies) {
 }
 
 void create_drag(scene_t *scene, double gamma, list_t *bodies) {
-  drag_auxillary_t *aux = malloc(sizeof(drag_auxillary_t));
+  drag_auxillary_t *aux = mem_alloc(sizeof(drag_auxillary_t));
   assert(aux);
   aux->drag_constant = gamma;
-  scene_add_bodies_force_creator(scene, drag_force_creator, NULL, aux, bodies,
-                                 auxillary_freer);
+  scene_add_pure_force_creator(scene, "drag", drag_force_creator, aux, bodies,
+                               auxillary_freer, drag_auxillary_copier);
 }
 
 void horizontal_motion_force_creator(void *auxillary, list_t *bodies) {
@@ -162,15 +357,17 @@ void horizontal_motion_force_creator(void *auxillary, list_t *bodies) {
 
 void create_horizontal_motion(scene_t *scene, vector_t window, size_t speed,
                               size_t buffer, body_t *body) {
-  horizontal_motion_auxillary_t *aux = malloc(sizeof(horizontal_motion_auxillary_t));
+  horizontal_motion_auxillary_t *aux = mem_alloc(sizeof(horizontal_motion_auxillary_t));
   assert(aux);
   list_t *bodies = list_init(1, body_free);
   list_add(bodies, body);
   aux->window = window;
   aux->speed = speed;
   aux->buffer = buffer;
-  scene_add_bodies_force_creator(scene, horizontal_motion_force_creator, NULL,
-                                 aux, bodies, auxillary_freer);
+  scene_add_named_bodies_force_creator(scene, "horizontal_motion",
+                                       horizontal_motion_force_creator, NULL,
+                                       aux, bodies, auxillary_freer,
+                                       horizontal_motion_auxillary_copier);
 }
 
 void destructive_collision_force_creator(body_t *body1, body_t *body2,
@@ -182,68 +379,15 @@ void destructive_collision_force_creator(body_t *body1, body_t *body2,
     body_remove(body1);
     body_remove(body2);
   }
-  free(list_get_data(shape1));
-  free(list_get_data(shape2));
-  free(shape1);
-  free(shape2);
-}
-
-void physics_collision_force_creator(body_t *body1, body_t *body2,
-                                     vector_t axis, void *aux) {
-  physics_collision_auxillary_t *auxillary =
-      (physics_collision_auxillary_t *)aux;
-  list_t *shape1 = body_get_shape(body1);
-  list_t *shape2 = body_get_shape(body2);
-  collision_info_t collision_info = find_collision(shape1, shape2);
-  free(list_get_data(shape1));
-  free(list_get_data(shape2));
-  free(shape1);
-  free(shape2);
-  vector_t collision_axis = collision_info.axis;
-
-  double mass1 = body_get_mass(body1);
-  double mass2 = body_get_mass(body2);
-  if (mass1 == INFINITY) {
-    double reduced_mass = mass2;
-    double impulse_component = reduced_mass * (1 + auxillary->elasticity);
-    vector_t impulse_proj = vec_proj(body_get_velocity(body2), collision_axis);
-    vector_t impulse_collision_axis =
-        vec_multiply(-impulse_component, impulse_proj);
-    body_add_impulse(body2, impulse_collision_axis);
-  } else if (mass2 == INFINITY) {
-    double reduced_mass = mass1;
-    double impulse_component = reduced_mass * (1 + auxillary->elasticity);
-    vector_t impulse_proj = vec_proj(body_get_velocity(body1), collision_axis);
-    vector_t impulse_collision_axis =
-        vec_multiply(-impulse_component, impulse_proj);
-    body_add_impulse(body1, impulse_collision_axis);
-  } else {
-    double reduced_mass = (body_get_mass(body1) * body_get_mass(body2)) /
-                          (body_get_mass(body1) + body_get_mass(body2));
-    double impulse_component = reduced_mass * (1 + auxillary->elasticity);
-    vector_t impulse_body1_proj =
-        vec_proj(body_get_velocity(body1), collision_axis);
-    vector_t impulse_body2_proj =
-        vec_proj(body_get_velocity(body2), collision_axis);
-    vector_t body_impulse =
-        vec_multiply(impulse_component,
-                     vec_subtract(impulse_body2_proj, impulse_body1_proj));
-    body_add_impulse(body1, body_impulse);
-    body_add_impulse(body2, vec_negate(body_impulse));
-  }
+  mem_free(list_get_data(shape1));
+  mem_free(list_get_data(shape2));
+  mem_free(shape1);
+  mem_free(shape2);
 }
 
 void create_physics_collision(scene_t *scene, double elasticity, body_t *body1,
                               body_t *body2) {
-  list_t *bodies = list_init(2, body_free);
-  physics_collision_auxillary_t *aux =
-      malloc(sizeof(physics_collision_auxillary_t));
-  assert(aux);
-  aux->elasticity = elasticity;
-  list_add(bodies, body1);
-  list_add(bodies, body2);
-  scene_add_bodies_force_creator(scene, NULL, physics_collision_force_creator,
-                                 aux, bodies, auxillary_freer);
+  scene_add_contact(scene, body1, body2, elasticity);
 }
 
 void create_destructive_collision(scene_t *scene, body_t *body1,
@@ -251,16 +395,24 @@ void create_destructive_collision(scene_t *scene, body_t *body1,
   list_t *bodies = list_init(2, body_free);
   list_add(bodies, body1);
   list_add(bodies, body2);
-  scene_add_bodies_force_creator(scene, NULL,
-                                 destructive_collision_force_creator, NULL,
-                                 bodies, auxillary_freer);
+  scene_add_named_bodies_force_creator(scene, "destructive_collision", NULL,
+                                       destructive_collision_force_creator,
+                                       NULL, bodies, auxillary_freer, NULL);
 }
 
 void create_collision(scene_t *scene, body_t *body1, body_t *body2,
                       collision_handler_t handler, void *aux,
                       free_func_t freer) {
+  create_named_collision(scene, NULL, body1, body2, handler, aux, freer,
+                         NULL);
+}
+
+void create_named_collision(scene_t *scene, const char *name, body_t *body1,
+                            body_t *body2, collision_handler_t handler,
+                            void *aux, free_func_t freer, copy_func_t copier) {
   list_t *bodies = list_init(2, body_free);
   list_add(bodies, body1);
   list_add(bodies, body2);
-  scene_add_bodies_force_creator(scene, NULL, handler, aux, bodies, freer);
+  scene_add_named_bodies_force_creator(scene, name, NULL, handler, aux, bodies,
+                                       freer, copier);
 }
\ No newline at end of file
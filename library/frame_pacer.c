@@ -0,0 +1,189 @@
+#include "frame_pacer.h"
+#include "mem.h"
+#include <SDL2/SDL.h>
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+const char PACING_ENV_VAR[] = "FRAME_PACING";
+// A frame that falls further behind than this drops the extra ticks
+const size_t MAX_TICKS_PER_FRAME = 5;
+// The render interval is reconsidered once per this many frames
+const size_t PACING_WINDOW = 60;
+// Slow down rendering when more than this fraction of a window is late
+const double LATE_FRACTION_TO_SLOW = 0.1;
+const size_t MAX_RENDER_INTERVAL = 4;
+// SDL_Delay() is only accurate to about a millisecond, so spin for the rest
+const double SPIN_SECONDS = 2e-3;
+const double TICK_EPSILON = 1e-9;
+
+typedef struct frame_pacer {
+  pacing_mode_t mode;
+  double frame_period;
+  double tick_dt;
+  double accumulator;
+  bool started;
+  double frame_start;
+  double deadline;
+  bool render_this_frame;
+  size_t window_frames;
+  size_t window_late;
+  frame_pacer_stats_t stats;
+} frame_pacer_t;
+
+/** Reads the high-resolution clock, in seconds */
+double pacer_now(void) {
+  return (double)SDL_GetPerformanceCounter() / SDL_GetPerformanceFrequency();
+}
+
+frame_pacer_t *frame_pacer_init(pacing_mode_t mode, double target_fps,
+                                double tick_rate) {
+  assert(target_fps > 0);
+  assert(tick_rate > 0);
+  frame_pacer_t *pacer = mem_alloc(sizeof(frame_pacer_t));
+  assert(pacer);
+  pacer->mode = mode;
+  pacer->frame_period = 1.0 / target_fps;
+  pacer->tick_dt = 1.0 / tick_rate;
+  pacer->accumulator = 0;
+  pacer->started = false;
+  pacer->frame_start = 0;
+  pacer->deadline = 0;
+  pacer->render_this_frame = true;
+  pacer->window_frames = 0;
+  pacer->window_late = 0;
+  pacer->stats = (frame_pacer_stats_t){0};
+  pacer->stats.render_interval = 1;
+  return pacer;
+}
+
+void frame_pacer_free(frame_pacer_t *pacer) { mem_free(pacer); }
+
+pacing_mode_t frame_pacer_mode_from_env(void) {
+  char *name = getenv(PACING_ENV_VAR);
+  if (name == NULL) {
+    return PACING_TARGET;
+  }
+  if (strcmp(name, "uncapped") == 0) {
+    return PACING_UNCAPPED;
+  }
+  if (strcmp(name, "headless") == 0) {
+    return PACING_HEADLESS;
+  }
+  return PACING_TARGET;
+}
+
+size_t frame_pacer_begin_frame(frame_pacer_t *pacer) {
+  double now = pacer_now();
+  double elapsed = pacer->frame_period;
+  if (pacer->started && pacer->mode != PACING_HEADLESS) {
+    elapsed = now - pacer->frame_start;
+  }
+  if (!pacer->started) {
+    pacer->deadline = now + pacer->frame_period;
+    pacer->started = true;
+  }
+  pacer->frame_start = now;
+
+  // Hand out as many fixed ticks as fit in the time that has passed
+  pacer->accumulator += elapsed;
+  size_t ticks = (size_t)floor(pacer->accumulator / pacer->tick_dt + TICK_EPSILON);
+  pacer->accumulator -= ticks * pacer->tick_dt;
+  if (pacer->accumulator < 0) {
+    pacer->accumulator = 0;
+  }
+  if (ticks > MAX_TICKS_PER_FRAME) {
+    pacer->stats.dropped_ticks += ticks - MAX_TICKS_PER_FRAME;
+    ticks = MAX_TICKS_PER_FRAME;
+  }
+
+  pacer->render_this_frame =
+      pacer->stats.frames % pacer->stats.render_interval == 0;
+  pacer->stats.frames++;
+  pacer->stats.ticks += ticks;
+  if (pacer->render_this_frame) {
+    pacer->stats.rendered_frames++;
+  }
+  return ticks;
+}
+
+double frame_pacer_tick_dt(frame_pacer_t *pacer) { return pacer->tick_dt; }
+
+bool frame_pacer_should_render(frame_pacer_t *pacer) {
+  return pacer->render_this_frame;
+}
+
+/** Renders less often while frames run late, and recovers once they don't */
+void adapt_render_interval(frame_pacer_t *pacer, bool late) {
+  pacer->window_frames++;
+  if (late) {
+    pacer->window_late++;
+  }
+  if (pacer->window_frames < PACING_WINDOW) {
+    return;
+  }
+  size_t *interval = &pacer->stats.render_interval;
+  if (pacer->window_late > LATE_FRACTION_TO_SLOW * pacer->window_frames) {
+    if (*interval < MAX_RENDER_INTERVAL) {
+      (*interval)++;
+    }
+  } else if (pacer->window_late == 0 && *interval > 1) {
+    (*interval)--;
+  }
+  pacer->window_frames = 0;
+  pacer->window_late = 0;
+}
+
+/** Sleeps until the given time on the high-resolution clock */
+void sleep_until(double time) {
+  double remaining = time - pacer_now();
+  if (remaining > SPIN_SECONDS) {
+    SDL_Delay((uint32_t)((remaining - SPIN_SECONDS) * 1e3));
+  }
+  while (pacer_now() < time) {
+  }
+}
+
+void frame_pacer_end_frame(frame_pacer_t *pacer) {
+  double now = pacer_now();
+  double frame_time = now - pacer->frame_start;
+  if (frame_time > pacer->stats.max_frame_time) {
+    pacer->stats.max_frame_time = frame_time;
+  }
+
+  switch (pacer->mode) {
+  case PACING_TARGET: {
+    bool late = now > pacer->deadline;
+    if (late) {
+      pacer->stats.late_frames++;
+      pacer->stats.missed_frames +=
+          (size_t)floor((now - pacer->deadline) / pacer->frame_period);
+      // Start over from now rather than rushing to catch up
+      pacer->deadline = now + pacer->frame_period;
+    } else {
+      sleep_until(pacer->deadline);
+      pacer->deadline += pacer->frame_period;
+    }
+    adapt_render_interval(pacer, late);
+    break;
+  }
+  case PACING_UNCAPPED: {
+    bool late = frame_time > pacer->frame_period;
+    if (late) {
+      pacer->stats.late_frames++;
+      pacer->stats.missed_frames +=
+          (size_t)floor(frame_time / pacer->frame_period) - 1;
+    }
+    adapt_render_interval(pacer, late);
+    break;
+  }
+  case PACING_HEADLESS:
+    // Virtual time never runs late
+    break;
+  }
+}
+
+frame_pacer_stats_t frame_pacer_get_stats(frame_pacer_t *pacer) {
+  return pacer->stats;
+}
@@ -1,4 +1,5 @@
 #include "sdl_wrapper.h"
+#include "mem.h"
 #include <SDL2/SDL2_gfxPrimitives.h>
 #include "image.h"
 #include <assert.h>
@@ -11,6 +12,6 @@
 void image_free(void *image) {
     image_t *img = (image_t *)image;
     SDL_FreeSurface(img->image);
-    free(image);
+    mem_free(image);
 }
 
@@ -1,4 +1,5 @@
 #include "list.h"
+#include "mem.h"
 #include <assert.h>
 #include <stddef.h>
 #include <stdio.h>
@@ -14,11 +15,11 @@ typedef struct list {
 } list_t;
 
 list_t *list_init(size_t initial_size, free_func_t freer) {
-  list_t *init = malloc(sizeof(list_t));
+  list_t *init = mem_alloc(sizeof(list_t));
   assert(init);
   init->length = 0;
   init->capacity = initial_size;
-  init->data = malloc(sizeof(void *) * initial_size);
+  init->data = mem_alloc(sizeof(void *) * initial_size);
   assert(init->data);
   init->freer = freer;
   return init;
@@ -30,8 +31,8 @@ void list_free(list_t *list) {
       list->freer(list->data[i]);
     }
   }
-  free(list->data);
-  free(list);
+  mem_free(list->data);
+  mem_free(list);
 }
 
 size_t list_size(list_t *list) { return list->length; }
@@ -54,7 +55,7 @@ void list_ensure_capacity(list_t *list) {
   if (list_full(list)) {
     size_t new_capacity = list->length * LIST_GROWTH_FACTOR + 1;
     list->capacity = new_capacity;
-    list->data = realloc(list->data, new_capacity * sizeof(void *));
+    list->data = mem_realloc(list->data, new_capacity * sizeof(void *));
   }
 }
 
@@ -0,0 +1,171 @@
+#include "mem.h"
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Distinct call sites tracked; later sites are only counted in the totals
+#define MAX_SITES 1024
+
+typedef struct site_stats {
+  _Atomic(const char *) site;
+  _Atomic size_t allocations;
+  _Atomic size_t bytes;
+} site_stats_t;
+
+/** The counts of the tick in progress on one thread */
+typedef struct tick_stats {
+  bool in_tick;
+  mem_stats_t current;
+  mem_stats_t last;
+} tick_stats_t;
+
+void *system_malloc(size_t size, void *aux) { return malloc(size); }
+
+void *system_realloc(void *ptr, size_t size, void *aux) {
+  return realloc(ptr, size);
+}
+
+void system_free(void *ptr, void *aux) { free(ptr); }
+
+const mem_hooks_t SYSTEM_HOOKS = {system_malloc, system_realloc, system_free,
+                                  NULL};
+
+mem_hooks_t hooks = {system_malloc, system_realloc, system_free, NULL};
+site_stats_t sites[MAX_SITES];
+_Atomic size_t total_allocations = 0;
+_Atomic size_t total_bytes = 0;
+_Atomic size_t total_frees = 0;
+_Atomic bool steady_state = false;
+_Thread_local tick_stats_t tick = {0};
+
+void mem_set_hooks(mem_hooks_t new_hooks) { hooks = new_hooks; }
+
+void mem_reset_hooks(void) { hooks = SYSTEM_HOOKS; }
+
+/**
+ * Finds the stats of a call site, claiming a free slot for a new site.
+ * Sites are string literals, so they are compared by address.
+ */
+site_stats_t *get_site(const char *site) {
+  size_t start = ((uintptr_t)site >> 3) % MAX_SITES;
+  for (size_t i = 0; i < MAX_SITES; i++) {
+    site_stats_t *stats = &sites[(start + i) % MAX_SITES];
+    const char *current = atomic_load(&stats->site);
+    if (current == site) {
+      return stats;
+    }
+    if (current == NULL) {
+      const char *expected = NULL;
+      if (atomic_compare_exchange_strong(&stats->site, &expected, site) ||
+          expected == site) {
+        return stats;
+      }
+    }
+  }
+  return NULL;
+}
+
+/** Records an allocation in the totals, its site and the current tick */
+void record_allocation(size_t size, const char *site) {
+  if (tick.in_tick && atomic_load(&steady_state)) {
+    fprintf(stderr, "mem: %zu byte allocation at %s in a steady-state tick\n",
+            size, site);
+    abort();
+  }
+  atomic_fetch_add(&total_allocations, 1);
+  atomic_fetch_add(&total_bytes, size);
+  site_stats_t *stats = get_site(site);
+  if (stats != NULL) {
+    atomic_fetch_add(&stats->allocations, 1);
+    atomic_fetch_add(&stats->bytes, size);
+  }
+  if (tick.in_tick) {
+    tick.current.allocations++;
+    tick.current.bytes += size;
+  }
+}
+
+void *mem_alloc_at(size_t size, const char *site) {
+  record_allocation(size, site);
+  void *ptr = hooks.malloc(size, hooks.aux);
+  assert(ptr != NULL || size == 0);
+  return ptr;
+}
+
+void *mem_calloc_at(size_t count, size_t size, const char *site) {
+  record_allocation(count * size, site);
+  void *ptr = hooks.malloc(count * size, hooks.aux);
+  assert(ptr != NULL || count * size == 0);
+  if (ptr != NULL) {
+    memset(ptr, 0, count * size);
+  }
+  return ptr;
+}
+
+void *mem_realloc_at(void *ptr, size_t size, const char *site) {
+  record_allocation(size, site);
+  void *resized = hooks.realloc(ptr, size, hooks.aux);
+  assert(resized != NULL || size == 0);
+  return resized;
+}
+
+void mem_free(void *ptr) {
+  if (ptr == NULL) {
+    return;
+  }
+  atomic_fetch_add(&total_frees, 1);
+  if (tick.in_tick) {
+    tick.current.frees++;
+  }
+  hooks.free(ptr, hooks.aux);
+}
+
+void mem_tick_begin(void) {
+  tick.current = (mem_stats_t){0};
+  tick.in_tick = true;
+}
+
+void mem_tick_end(void) {
+  tick.last = tick.current;
+  tick.in_tick = false;
+}
+
+void mem_set_steady_state(bool enabled) { atomic_store(&steady_state, enabled); }
+
+mem_stats_t mem_get_tick_stats(void) { return tick.last; }
+
+mem_stats_t mem_get_total_stats(void) {
+  return (mem_stats_t){atomic_load(&total_allocations),
+                       atomic_load(&total_bytes), atomic_load(&total_frees)};
+}
+
+int compare_sites(const void *a, const void *b) {
+  size_t count_a = atomic_load(&(*(site_stats_t **)a)->allocations);
+  size_t count_b = atomic_load(&(*(site_stats_t **)b)->allocations);
+  return count_a < count_b ? 1 : count_a > count_b ? -1 : 0;
+}
+
+void mem_report(FILE *file) {
+  mem_stats_t totals = mem_get_total_stats();
+  mem_stats_t last_tick = mem_get_tick_stats();
+  fprintf(file, "allocations: %zu (%zu bytes), frees: %zu\n",
+          totals.allocations, totals.bytes, totals.frees);
+  fprintf(file, "last tick: %zu allocations (%zu bytes), %zu frees\n",
+          last_tick.allocations, last_tick.bytes, last_tick.frees);
+
+  site_stats_t *used[MAX_SITES];
+  size_t num_used = 0;
+  for (size_t i = 0; i < MAX_SITES; i++) {
+    if (atomic_load(&sites[i].site) != NULL) {
+      used[num_used++] = &sites[i];
+    }
+  }
+  qsort(used, num_used, sizeof(site_stats_t *), compare_sites);
+  for (size_t i = 0; i < num_used; i++) {
+    fprintf(file, "%10zu allocations %12zu bytes  %s\n",
+            atomic_load(&used[i]->allocations), atomic_load(&used[i]->bytes),
+            atomic_load(&used[i]->site));
+  }
+}
@@ -0,0 +1,204 @@
+#include "perf.h"
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Distinct zone names tracked; zones beyond this are not recorded
+#define MAX_PHASES 64
+
+typedef struct perf_phase {
+  _Atomic(const char *) name;
+  _Atomic size_t count;
+  _Atomic uint64_t total[PERF_NUM_EVENTS];
+  _Atomic uint64_t last[PERF_NUM_EVENTS];
+} perf_phase_t;
+
+/** Whether a thread has tried to open its counter group, and if it worked */
+typedef enum { GROUP_UNOPENED, GROUP_OPEN, GROUP_UNAVAILABLE } group_status_t;
+
+perf_phase_t phases[MAX_PHASES];
+_Thread_local group_status_t group_status = GROUP_UNOPENED;
+_Thread_local int group_fd = -1;
+
+#ifdef __linux__
+const uint64_t EVENT_CONFIGS[PERF_NUM_EVENTS] = {
+    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+
+/** The layout read() fills for a group with PERF_FORMAT_GROUP */
+typedef struct group_read {
+  uint64_t nr;
+  uint64_t time_enabled;
+  uint64_t time_running;
+  uint64_t values[PERF_NUM_EVENTS];
+} group_read_t;
+
+/** Opens one counter on the calling thread, in the group led by leader */
+int open_event(uint64_t config, int leader) {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = config;
+  attr.disabled = leader == -1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                     PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+}
+
+/** Opens the calling thread's counter group, all events or none */
+bool open_group(void) {
+  int fds[PERF_NUM_EVENTS];
+  for (size_t i = 0; i < PERF_NUM_EVENTS; i++) {
+    fds[i] = open_event(EVENT_CONFIGS[i], i == 0 ? -1 : fds[0]);
+    if (fds[i] < 0) {
+      for (size_t j = 0; j < i; j++) {
+        close(fds[j]);
+      }
+      return false;
+    }
+  }
+  group_fd = fds[0];
+  ioctl(group_fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+  ioctl(group_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  return true;
+}
+
+/** Reads the group, scaling up counts if the kernel multiplexed it */
+bool read_group(perf_counts_t *counts) {
+  group_read_t data;
+  if (read(group_fd, &data, sizeof(data)) != sizeof(data)) {
+    return false;
+  }
+  double scale = 1;
+  if (data.time_running > 0 && data.time_running < data.time_enabled) {
+    scale = (double)data.time_enabled / data.time_running;
+  }
+  for (size_t i = 0; i < PERF_NUM_EVENTS; i++) {
+    counts->counts[i] = (uint64_t)(data.values[i] * scale);
+  }
+  return true;
+}
+#else
+bool open_group(void) { return false; }
+
+bool read_group(perf_counts_t *counts) { return false; }
+#endif
+
+bool perf_available(void) {
+  if (group_status == GROUP_UNOPENED) {
+    group_status = open_group() ? GROUP_OPEN : GROUP_UNAVAILABLE;
+  }
+  return group_status == GROUP_OPEN;
+}
+
+/**
+ * Finds the phase with a name, claiming the next free slot for a new name.
+ * Slots are claimed in order, so the used ones are always a prefix.
+ */
+perf_phase_t *get_phase(const char *name) {
+  for (size_t i = 0; i < MAX_PHASES; i++) {
+    perf_phase_t *phase = &phases[i];
+    const char *current = atomic_load(&phase->name);
+    if (current == NULL) {
+      const char *expected = NULL;
+      if (atomic_compare_exchange_strong(&phase->name, &expected, name)) {
+        return phase;
+      }
+      current = expected;
+    }
+    if (current == name || strcmp(current, name) == 0) {
+      return phase;
+    }
+  }
+  return NULL;
+}
+
+perf_zone_t perf_zone_begin(const char *name) {
+  perf_zone_t zone = {name, {{0}}, false};
+  if (perf_available()) {
+    zone.valid = read_group(&zone.start);
+  }
+  return zone;
+}
+
+void perf_zone_end(perf_zone_t *zone) {
+  perf_counts_t end;
+  if (!zone->valid || !read_group(&end)) {
+    return;
+  }
+  perf_phase_t *phase = get_phase(zone->name);
+  if (phase == NULL) {
+    return;
+  }
+  atomic_fetch_add(&phase->count, 1);
+  for (size_t i = 0; i < PERF_NUM_EVENTS; i++) {
+    uint64_t delta = end.counts[i] - zone->start.counts[i];
+    atomic_fetch_add(&phase->total[i], delta);
+    atomic_store(&phase->last[i], delta);
+  }
+}
+
+size_t perf_phases(void) {
+  size_t count = 0;
+  while (count < MAX_PHASES && atomic_load(&phases[count].name) != NULL) {
+    count++;
+  }
+  return count;
+}
+
+perf_phase_stats_t perf_get_phase(size_t index) {
+  assert(index < perf_phases());
+  perf_phase_t *phase = &phases[index];
+  perf_phase_stats_t stats = {atomic_load(&phase->name),
+                              atomic_load(&phase->count), {{0}}};
+  for (size_t i = 0; i < PERF_NUM_EVENTS; i++) {
+    stats.total.counts[i] = atomic_load(&phase->total[i]);
+  }
+  return stats;
+}
+
+bool perf_get_last(const char *name, perf_counts_t *counts) {
+  for (size_t i = 0; i < perf_phases(); i++) {
+    perf_phase_t *phase = &phases[i];
+    const char *current = atomic_load(&phase->name);
+    if (current == name || strcmp(current, name) == 0) {
+      for (size_t j = 0; j < PERF_NUM_EVENTS; j++) {
+        counts->counts[j] = atomic_load(&phase->last[j]);
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+bool perf_write_csv(const char *path) {
+  FILE *file = fopen(path, "w");
+  if (file == NULL) {
+    return false;
+  }
+  fprintf(file, "phase,count,cycles,instructions,cache_misses,branch_misses,"
+                "ipc\n");
+  for (size_t i = 0; i < perf_phases(); i++) {
+    perf_phase_stats_t stats = perf_get_phase(i);
+    uint64_t *total = stats.total.counts;
+    double count = stats.count ? stats.count : 1;
+    double ipc = total[PERF_CYCLES]
+                     ? (double)total[PERF_INSTRUCTIONS] / total[PERF_CYCLES]
+                     : 0;
+    fprintf(file, "%s,%zu,%.0f,%.0f,%.0f,%.0f,%.3f\n", stats.name, stats.count,
+            total[PERF_CYCLES] / count, total[PERF_INSTRUCTIONS] / count,
+            total[PERF_CACHE_MISSES] / count, total[PERF_BRANCH_MISSES] / count,
+            ipc);
+  }
+  return fclose(file) == 0;
+}
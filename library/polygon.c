@@ -1,6 +1,7 @@
 #include "polygon.h"
 #include "list.h"
 #include "vector.h"
+#include <math.h>
 
 double polygon_area(list_t *polygon) {
   double area = 0;
@@ -45,3 +46,14 @@ void polygon_rotate(list_t *polygon, double angle, vector_t point) {
     *v = vec_add(*v, point);
   }
 }
+
+double polygon_min_extent(list_t *polygon) {
+  vector_t min = {INFINITY, INFINITY};
+  vector_t max = {-INFINITY, -INFINITY};
+  for (size_t i = 0; i < list_size(polygon); i++) {
+    vector_t *v = list_get(polygon, i);
+    min = (vector_t){fmin(min.x, v->x), fmin(min.y, v->y)};
+    max = (vector_t){fmax(max.x, v->x), fmax(max.y, v->y)};
+  }
+  return fmin(max.x - min.x, max.y - min.y);
+}
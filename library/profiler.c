@@ -0,0 +1,195 @@
+#include "profiler.h"
+#include "mem.h"
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Samples kept per thread; must be a power of two
+#define PROFILE_RING_SIZE (1 << 16)
+
+const double NS_PER_US = 1e3;
+const double NS_PER_MS = 1e6;
+
+typedef struct profile_sample {
+  const char *name;
+  uint64_t start_ns;
+  uint64_t end_ns;
+} profile_sample_t;
+
+/**
+ * One thread's samples. Only the owning thread writes samples and head;
+ * head is published with release ordering so a dump sees whole samples.
+ */
+typedef struct profile_buffer {
+  struct profile_buffer *next;
+  size_t thread_id;
+  _Atomic uint64_t head;
+  profile_sample_t samples[PROFILE_RING_SIZE];
+} profile_buffer_t;
+
+/**
+ * Every thread's buffer, pushed on first use and never removed,
+ * so a dump can still read the samples of threads that have exited.
+ */
+_Atomic(profile_buffer_t *) profile_buffers = NULL;
+_Atomic size_t next_thread_id = 0;
+_Thread_local profile_buffer_t *local_buffer = NULL;
+
+/** Summary of all samples sharing a zone name */
+typedef struct zone_summary {
+  const char *name;
+  size_t count;
+  uint64_t total_ns;
+  uint64_t max_ns;
+} zone_summary_t;
+
+uint64_t profiler_now_ns(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000u + now.tv_nsec;
+}
+
+/** Gets the calling thread's buffer, registering it on first use */
+profile_buffer_t *get_local_buffer(void) {
+  if (local_buffer == NULL) {
+    profile_buffer_t *buffer = mem_calloc(1, sizeof(profile_buffer_t));
+    assert(buffer);
+    buffer->thread_id = atomic_fetch_add(&next_thread_id, 1);
+    atomic_init(&buffer->head, 0);
+    profile_buffer_t *head = atomic_load(&profile_buffers);
+    do {
+      buffer->next = head;
+    } while (!atomic_compare_exchange_weak(&profile_buffers, &head, buffer));
+    local_buffer = buffer;
+  }
+  return local_buffer;
+}
+
+profile_zone_t profile_zone_begin(const char *name) {
+  return (profile_zone_t){name, profiler_now_ns()};
+}
+
+void profile_zone_end(profile_zone_t *zone) {
+  uint64_t end_ns = profiler_now_ns();
+  profile_buffer_t *buffer = get_local_buffer();
+  uint64_t head = atomic_load_explicit(&buffer->head, memory_order_relaxed);
+  buffer->samples[head & (PROFILE_RING_SIZE - 1)] =
+      (profile_sample_t){zone->name, zone->start_ns, end_ns};
+  atomic_store_explicit(&buffer->head, head + 1, memory_order_release);
+}
+
+/** Gets the index of the oldest sample still in a buffer */
+uint64_t oldest_sample(uint64_t head) {
+  return head > PROFILE_RING_SIZE ? head - PROFILE_RING_SIZE : 0;
+}
+
+/** Finds the earliest sample start, so trace timestamps begin near 0 */
+uint64_t earliest_start(void) {
+  uint64_t earliest = UINT64_MAX;
+  for (profile_buffer_t *buffer = atomic_load(&profile_buffers);
+       buffer != NULL; buffer = buffer->next) {
+    uint64_t head = atomic_load_explicit(&buffer->head, memory_order_acquire);
+    for (uint64_t i = oldest_sample(head); i < head; i++) {
+      profile_sample_t *sample = &buffer->samples[i & (PROFILE_RING_SIZE - 1)];
+      if (sample->start_ns < earliest) {
+        earliest = sample->start_ns;
+      }
+    }
+  }
+  return earliest == UINT64_MAX ? 0 : earliest;
+}
+
+bool profiler_write_chrome_trace(const char *path) {
+  FILE *file = fopen(path, "w");
+  if (file == NULL) {
+    return false;
+  }
+  uint64_t origin = earliest_start();
+  bool first = true;
+  fprintf(file, "{\"traceEvents\":[\n");
+  for (profile_buffer_t *buffer = atomic_load(&profile_buffers);
+       buffer != NULL; buffer = buffer->next) {
+    uint64_t head = atomic_load_explicit(&buffer->head, memory_order_acquire);
+    for (uint64_t i = oldest_sample(head); i < head; i++) {
+      profile_sample_t *sample = &buffer->samples[i & (PROFILE_RING_SIZE - 1)];
+      fprintf(file,
+              "%s{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+              "\"pid\":1,\"tid\":%zu}",
+              first ? "" : ",\n", sample->name,
+              (sample->start_ns - origin) / NS_PER_US,
+              (sample->end_ns - sample->start_ns) / NS_PER_US,
+              buffer->thread_id);
+      first = false;
+    }
+  }
+  fprintf(file, "\n]}\n");
+  return fclose(file) == 0;
+}
+
+/** Adds a sample to the summary of its zone, creating it if needed */
+void summarize_sample(zone_summary_t **summaries, size_t *count,
+                      size_t *capacity, profile_sample_t *sample) {
+  zone_summary_t *summary = NULL;
+  for (size_t i = 0; i < *count; i++) {
+    zone_summary_t *candidate = &(*summaries)[i];
+    if (candidate->name == sample->name ||
+        strcmp(candidate->name, sample->name) == 0) {
+      summary = candidate;
+      break;
+    }
+  }
+  if (summary == NULL) {
+    if (*count == *capacity) {
+      *capacity = *capacity * 2 + 1;
+      *summaries = mem_realloc(*summaries, *capacity * sizeof(zone_summary_t));
+      assert(*summaries);
+    }
+    summary = &(*summaries)[(*count)++];
+    *summary = (zone_summary_t){sample->name, 0, 0, 0};
+  }
+  uint64_t duration = sample->end_ns - sample->start_ns;
+  summary->count++;
+  summary->total_ns += duration;
+  if (duration > summary->max_ns) {
+    summary->max_ns = duration;
+  }
+}
+
+bool profiler_write_csv_summary(const char *path) {
+  FILE *file = fopen(path, "w");
+  if (file == NULL) {
+    return false;
+  }
+  zone_summary_t *summaries = NULL;
+  size_t count = 0;
+  size_t capacity = 0;
+  for (profile_buffer_t *buffer = atomic_load(&profile_buffers);
+       buffer != NULL; buffer = buffer->next) {
+    uint64_t head = atomic_load_explicit(&buffer->head, memory_order_acquire);
+    for (uint64_t i = oldest_sample(head); i < head; i++) {
+      summarize_sample(&summaries, &count, &capacity,
+                       &buffer->samples[i & (PROFILE_RING_SIZE - 1)]);
+    }
+  }
+
+  fprintf(file, "zone,count,total_ms,mean_us,max_us\n");
+  for (size_t i = 0; i < count; i++) {
+    zone_summary_t *summary = &summaries[i];
+    fprintf(file, "%s,%zu,%.3f,%.3f,%.3f\n", summary->name, summary->count,
+            summary->total_ns / NS_PER_MS,
+            summary->total_ns / NS_PER_US / summary->count,
+            summary->max_ns / NS_PER_US);
+  }
+  mem_free(summaries);
+  return fclose(file) == 0;
+}
+
+void profiler_reset(void) {
+  for (profile_buffer_t *buffer = atomic_load(&profile_buffers);
+       buffer != NULL; buffer = buffer->next) {
+    atomic_store(&buffer->head, 0);
+  }
+}
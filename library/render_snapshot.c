@@ -0,0 +1,196 @@
+#include "render_snapshot.h"
+#include "mem.h"
+#include "body.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+const size_t SNAPSHOT_GROWTH_FACTOR = 2;
+
+typedef struct render_snapshot {
+  render_item_t *items;
+  size_t num_items;
+  size_t items_capacity;
+  vector_t *vertices;
+  size_t num_vertices;
+  size_t vertices_capacity;
+  image_t *images;
+  size_t num_images;
+  size_t images_capacity;
+  text_t *texts;
+  size_t num_texts;
+  size_t texts_capacity;
+  char *strings;
+  size_t strings_capacity;
+} render_snapshot_t;
+
+/**
+ * Grows an array so it can hold at least the needed number of elements.
+ * Existing elements are preserved.
+ */
+void *snapshot_reserve(void *array, size_t *capacity, size_t needed,
+                       size_t element_size) {
+  if (needed <= *capacity) {
+    return array;
+  }
+  size_t new_capacity = *capacity * SNAPSHOT_GROWTH_FACTOR + 1;
+  if (new_capacity < needed) {
+    new_capacity = needed;
+  }
+  array = mem_realloc(array, new_capacity * element_size);
+  assert(array);
+  *capacity = new_capacity;
+  return array;
+}
+
+/** Takes a reference on a surface so it outlives the body or image using it */
+SDL_Surface *snapshot_retain(SDL_Surface *surface) {
+  if (surface != NULL) {
+    surface->refcount++;
+  }
+  return surface;
+}
+
+render_snapshot_t *render_snapshot_init(void) {
+  render_snapshot_t *snapshot = mem_calloc(1, sizeof(render_snapshot_t));
+  assert(snapshot);
+  return snapshot;
+}
+
+void render_snapshot_clear(render_snapshot_t *snapshot) {
+  for (size_t i = 0; i < snapshot->num_items; i++) {
+    // SDL_FreeSurface() only frees once the last reference is dropped
+    SDL_FreeSurface(snapshot->items[i].sprite);
+  }
+  for (size_t i = 0; i < snapshot->num_images; i++) {
+    SDL_FreeSurface(snapshot->images[i].image);
+  }
+  snapshot->num_items = 0;
+  snapshot->num_vertices = 0;
+  snapshot->num_images = 0;
+  snapshot->num_texts = 0;
+}
+
+void render_snapshot_free(render_snapshot_t *snapshot) {
+  render_snapshot_clear(snapshot);
+  mem_free(snapshot->items);
+  mem_free(snapshot->vertices);
+  mem_free(snapshot->images);
+  mem_free(snapshot->texts);
+  mem_free(snapshot->strings);
+  mem_free(snapshot);
+}
+
+void capture_images(render_snapshot_t *snapshot, list_t *images) {
+  size_t count = images == NULL ? 0 : list_size(images);
+  snapshot->images = snapshot_reserve(
+      snapshot->images, &snapshot->images_capacity, count, sizeof(image_t));
+  for (size_t i = 0; i < count; i++) {
+    image_t *image = list_get(images, i);
+    snapshot->images[i] = (image_t){snapshot_retain(image->image), image->rect};
+  }
+  snapshot->num_images = count;
+}
+
+void capture_texts(render_snapshot_t *snapshot, list_t *texts) {
+  size_t count = texts == NULL ? 0 : list_size(texts);
+  snapshot->texts = snapshot_reserve(snapshot->texts, &snapshot->texts_capacity,
+                                     count, sizeof(text_t));
+  // Size the string pool first so the copied strings never move
+  size_t total_length = 0;
+  for (size_t i = 0; i < count; i++) {
+    text_t *text = list_get(texts, i);
+    total_length += strlen(text->text) + 1;
+  }
+  snapshot->strings = snapshot_reserve(
+      snapshot->strings, &snapshot->strings_capacity, total_length, 1);
+
+  char *next_string = snapshot->strings;
+  for (size_t i = 0; i < count; i++) {
+    text_t *text = list_get(texts, i);
+    size_t length = strlen(text->text) + 1;
+    memcpy(next_string, text->text, length);
+    snapshot->texts[i] =
+        (text_t){next_string, text->font, text->color, text->message_rect};
+    next_string += length;
+  }
+  snapshot->num_texts = count;
+}
+
+void capture_bodies(render_snapshot_t *snapshot, scene_t *scene) {
+  size_t count = scene_bodies(scene);
+  snapshot->items = snapshot_reserve(snapshot->items, &snapshot->items_capacity,
+                                     count, sizeof(render_item_t));
+  for (size_t i = 0; i < count; i++) {
+    body_t *body = scene_get_body(scene, i);
+    image_t *image = body_get_image(body);
+    render_item_t *item = &snapshot->items[i];
+    item->centroid = body_get_centroid(body);
+    item->angle = body_get_angle(body);
+    item->color = body_get_color(body);
+    item->first_vertex = snapshot->num_vertices;
+    item->num_vertices = 0;
+    if (image != NULL) {
+      item->sprite = snapshot_retain(image->image);
+      item->sprite_size = (vector_t){image->rect.w, image->rect.h};
+      continue;
+    }
+
+    // Only bodies drawn as polygons need their vertices
+    item->sprite = NULL;
+    item->sprite_size = VEC_ZERO;
+    list_t *shape = body_get_shape(body);
+    size_t num_vertices = list_size(shape);
+    snapshot->vertices = snapshot_reserve(
+        snapshot->vertices, &snapshot->vertices_capacity,
+        snapshot->num_vertices + num_vertices, sizeof(vector_t));
+    for (size_t j = 0; j < num_vertices; j++) {
+      snapshot->vertices[snapshot->num_vertices + j] =
+          *(vector_t *)list_get(shape, j);
+    }
+    snapshot->num_vertices += num_vertices;
+    item->num_vertices = num_vertices;
+    list_free(shape);
+  }
+  snapshot->num_items = count;
+}
+
+void render_snapshot_capture(render_snapshot_t *snapshot, scene_t *scene,
+                             list_t *texts, list_t *images) {
+  render_snapshot_clear(snapshot);
+  capture_images(snapshot, images);
+  capture_texts(snapshot, texts);
+  capture_bodies(snapshot, scene);
+}
+
+size_t render_snapshot_items(render_snapshot_t *snapshot) {
+  return snapshot->num_items;
+}
+
+render_item_t *render_snapshot_get_item(render_snapshot_t *snapshot,
+                                        size_t index) {
+  assert(index < snapshot->num_items);
+  return &snapshot->items[index];
+}
+
+vector_t *render_snapshot_get_vertices(render_snapshot_t *snapshot) {
+  return snapshot->vertices;
+}
+
+size_t render_snapshot_images(render_snapshot_t *snapshot) {
+  return snapshot->num_images;
+}
+
+image_t *render_snapshot_get_image(render_snapshot_t *snapshot, size_t index) {
+  assert(index < snapshot->num_images);
+  return &snapshot->images[index];
+}
+
+size_t render_snapshot_texts(render_snapshot_t *snapshot) {
+  return snapshot->num_texts;
+}
+
+text_t *render_snapshot_get_text(render_snapshot_t *snapshot, size_t index) {
+  assert(index < snapshot->num_texts);
+  return &snapshot->texts[index];
+}
@@ -0,0 +1,215 @@
+#include "replay.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * File layout, all integers little-endian:
+ *   "DJRP", version (1 byte), seed (8 bytes), tick length (8-byte double),
+ *   the tick the session ended on (8 bytes, written by replay_stop()),
+ *   then one record per key event:
+ *   ticks since the previous event (varint), key (1 byte), type (1 byte),
+ *   held time in milliseconds (varint).
+ */
+const char REPLAY_MAGIC[4] = {'D', 'J', 'R', 'P'};
+const uint8_t REPLAY_VERSION = 1;
+// The last tick sits after the magic, version, seed and tick length
+const long LAST_TICK_OFFSET = 4 + 1 + 8 + 8;
+const double MS_PER_SECOND = 1000;
+
+typedef enum { REPLAY_OFF, REPLAY_RECORDING, REPLAY_PLAYING } replay_mode_t;
+
+typedef struct replay_event {
+  uint64_t tick;
+  char key;
+  key_event_type_t type;
+  double held_time;
+} replay_event_t;
+
+replay_mode_t replay_mode = REPLAY_OFF;
+FILE *replay_file = NULL;
+// Per thread, so that games run side by side can each have their own seed
+_Thread_local uint64_t replay_session_seed;
+_Thread_local bool replay_seed_chosen = false;
+double replay_tick_dt = 0;
+uint64_t replay_current_tick = 0;
+// Recording: the tick of the last event written
+uint64_t replay_last_event_tick = 0;
+// Playback: the tick the recording ended on, and the next event to deliver
+uint64_t replay_last_tick = 0;
+replay_event_t replay_next_event;
+bool replay_has_next_event = false;
+
+void replay_write_u64(uint64_t value) {
+  uint8_t bytes[8];
+  for (size_t i = 0; i < 8; i++) {
+    bytes[i] = (uint8_t)(value >> (8 * i));
+  }
+  fwrite(bytes, 1, sizeof(bytes), replay_file);
+}
+
+bool replay_read_u64(uint64_t *value) {
+  uint8_t bytes[8];
+  if (fread(bytes, 1, sizeof(bytes), replay_file) != sizeof(bytes)) {
+    return false;
+  }
+  *value = 0;
+  for (size_t i = 0; i < 8; i++) {
+    *value |= (uint64_t)bytes[i] << (8 * i);
+  }
+  return true;
+}
+
+/** Writes 7 bits per byte, with the high bit set on all but the last byte */
+void replay_write_varint(uint64_t value) {
+  while (value >= 0x80) {
+    fputc((int)(value & 0x7F) | 0x80, replay_file);
+    value >>= 7;
+  }
+  fputc((int)value, replay_file);
+}
+
+bool replay_read_varint(uint64_t *value) {
+  *value = 0;
+  for (size_t shift = 0; shift < 64; shift += 7) {
+    int byte = fgetc(replay_file);
+    if (byte == EOF) {
+      return false;
+    }
+    *value |= (uint64_t)(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/** Reads the next event record, if there is one */
+void replay_read_next_event(void) {
+  uint64_t delta, held_ms;
+  int key, type;
+  replay_has_next_event =
+      replay_read_varint(&delta) && (key = fgetc(replay_file)) != EOF &&
+      (type = fgetc(replay_file)) != EOF && replay_read_varint(&held_ms);
+  if (!replay_has_next_event) {
+    return;
+  }
+  replay_next_event = (replay_event_t){
+      .tick = replay_next_event.tick + delta,
+      .key = (char)key,
+      .type = type == KEY_PRESSED ? KEY_PRESSED : KEY_RELEASED,
+      .held_time = held_ms / MS_PER_SECOND,
+  };
+}
+
+bool replay_start_recording(const char *path, uint64_t new_seed, double dt) {
+  replay_stop();
+  replay_file = fopen(path, "wb");
+  if (replay_file == NULL) {
+    return false;
+  }
+  replay_session_seed = new_seed;
+  replay_seed_chosen = true;
+  replay_tick_dt = dt;
+  replay_current_tick = 0;
+  replay_last_event_tick = 0;
+
+  fwrite(REPLAY_MAGIC, 1, sizeof(REPLAY_MAGIC), replay_file);
+  fputc(REPLAY_VERSION, replay_file);
+  replay_write_u64(replay_session_seed);
+  uint64_t dt_bits;
+  memcpy(&dt_bits, &dt, sizeof(dt_bits));
+  replay_write_u64(dt_bits);
+  replay_write_u64(0); // filled in by replay_stop()
+  replay_mode = REPLAY_RECORDING;
+  return true;
+}
+
+bool replay_start_playback(const char *path) {
+  replay_stop();
+  replay_file = fopen(path, "rb");
+  if (replay_file == NULL) {
+    return false;
+  }
+  char magic[sizeof(REPLAY_MAGIC)];
+  uint64_t dt_bits;
+  if (fread(magic, 1, sizeof(magic), replay_file) != sizeof(magic) ||
+      memcmp(magic, REPLAY_MAGIC, sizeof(magic)) != 0 ||
+      fgetc(replay_file) != REPLAY_VERSION ||
+      !replay_read_u64(&replay_session_seed) || !replay_read_u64(&dt_bits) ||
+      !replay_read_u64(&replay_last_tick)) {
+    fclose(replay_file);
+    replay_file = NULL;
+    return false;
+  }
+  memcpy(&replay_tick_dt, &dt_bits, sizeof(replay_tick_dt));
+  replay_seed_chosen = true;
+  replay_current_tick = 0;
+  replay_next_event.tick = 0;
+  replay_read_next_event();
+  replay_mode = REPLAY_PLAYING;
+  return true;
+}
+
+void replay_stop(void) {
+  if (replay_mode == REPLAY_RECORDING) {
+    fseek(replay_file, LAST_TICK_OFFSET, SEEK_SET);
+    replay_write_u64(replay_current_tick);
+  }
+  if (replay_file != NULL) {
+    fclose(replay_file);
+    replay_file = NULL;
+  }
+  replay_mode = REPLAY_OFF;
+}
+
+bool replay_is_recording(void) { return replay_mode == REPLAY_RECORDING; }
+
+bool replay_is_playing(void) { return replay_mode == REPLAY_PLAYING; }
+
+uint64_t replay_seed(void) {
+  if (!replay_seed_chosen) {
+    replay_session_seed = (uint64_t)time(NULL);
+    replay_seed_chosen = true;
+  }
+  return replay_session_seed;
+}
+
+void replay_set_seed(uint64_t seed) {
+  replay_session_seed = seed;
+  replay_seed_chosen = true;
+}
+
+double replay_dt(void) {
+  return replay_mode == REPLAY_PLAYING ? replay_tick_dt : 0;
+}
+
+void replay_record_key(char key, key_event_type_t type, double held_time) {
+  if (replay_mode != REPLAY_RECORDING) {
+    return;
+  }
+  replay_write_varint(replay_current_tick - replay_last_event_tick);
+  fputc((unsigned char)key, replay_file);
+  fputc(type, replay_file);
+  replay_write_varint((uint64_t)llround(fmax(held_time, 0) * MS_PER_SECOND));
+  replay_last_event_tick = replay_current_tick;
+}
+
+bool replay_dispatch(key_handler_t handler, void *state) {
+  if (replay_mode != REPLAY_PLAYING) {
+    return false;
+  }
+  while (replay_has_next_event &&
+         replay_next_event.tick == replay_current_tick) {
+    replay_event_t event = replay_next_event;
+    if (handler != NULL) {
+      handler(event.key, event.type, event.held_time, state);
+    }
+    replay_read_next_event();
+  }
+  return !replay_has_next_event &&
+         replay_current_tick >= replay_last_tick;
+}
+
+void replay_next_tick(void) { replay_current_tick++; }
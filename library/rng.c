@@ -0,0 +1,77 @@
+#include "rng.h"
+#include <assert.h>
+
+// Coefficients of the xoshiro256 jump polynomial, which advances 2^128 draws
+const uint64_t RNG_JUMP[] = {0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+                             0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL};
+// Doubles have 53 bits of mantissa
+const double RNG_DOUBLE_UNIT = 1.0 / (1ULL << 53);
+
+uint64_t rng_rotate_left(uint64_t x, int k) {
+  return (x << k) | (x >> (64 - k));
+}
+
+/** Steps splitmix64, which spreads a seed's bits over the whole state */
+uint64_t rng_splitmix64(uint64_t *x) {
+  uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+void rng_seed(rng_t *rng, uint64_t seed) {
+  for (size_t i = 0; i < 4; i++) {
+    rng->state[i] = rng_splitmix64(&seed);
+  }
+}
+
+uint64_t rng_next(rng_t *rng) {
+  uint64_t *s = rng->state;
+  uint64_t result = rng_rotate_left(s[1] * 5, 7) * 9;
+  uint64_t t = s[1] << 17;
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = rng_rotate_left(s[3], 45);
+  return result;
+}
+
+size_t rng_below(rng_t *rng, size_t bound) {
+  assert(bound > 0);
+  // Reject draws from the incomplete last multiple of bound
+  uint64_t limit = UINT64_MAX - UINT64_MAX % bound;
+  uint64_t draw;
+  do {
+    draw = rng_next(rng);
+  } while (draw >= limit);
+  return draw % bound;
+}
+
+double rng_between(rng_t *rng, double min, double max) {
+  return min + (max - min) * ((rng_next(rng) >> 11) * RNG_DOUBLE_UNIT);
+}
+
+void rng_jump(rng_t *rng) {
+  uint64_t jumped[4] = {0, 0, 0, 0};
+  for (size_t i = 0; i < sizeof(RNG_JUMP) / sizeof(RNG_JUMP[0]); i++) {
+    for (size_t bit = 0; bit < 64; bit++) {
+      if (RNG_JUMP[i] & (1ULL << bit)) {
+        for (size_t j = 0; j < 4; j++) {
+          jumped[j] ^= rng->state[j];
+        }
+      }
+      rng_next(rng);
+    }
+  }
+  for (size_t j = 0; j < 4; j++) {
+    rng->state[j] = jumped[j];
+  }
+}
+
+rng_t rng_split(rng_t *rng) {
+  rng_t split = *rng;
+  rng_jump(rng);
+  return split;
+}
@@ -1,37 +1,182 @@
 #include "scene.h"
+#include "mem.h"
 #include "collision.h"
 #include "forces.h"
+#include "perf.h"
+#include "profiler.h"
+#include "spatial_hash.h"
 #include <assert.h>
+#include <math.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 const size_t INITIAL_BODIES = 50;
 const size_t INITIAL_FORCE_CREATORS = 3;
+const size_t INITIAL_CALLBACK_NAMES = 8;
+// Every scene draws the same random numbers until it is reseeded
+const uint64_t DEFAULT_SEED = 0;
+// Velocity passes over every contact per tick
+const size_t CONTACT_ITERATIONS = 8;
+// Contacts approaching slower than this don't bounce, so resting ones settle
+const double CONTACT_RESTING_SPEED = 10;
+// Collision pairs move at most this fraction of the thinner body per substep
+const double SUBSTEP_TRAVEL = 0.5;
 
 typedef struct bodies_force_container {
   force_creator_t forcer;
   force_creator_old_t forcer_old;
+  // Only adds forces that depend on its bodies' motion, so the multi-stage
+  // integrators may rerun it inside the tick
+  bool pure;
   collision_handler_t collision_handler;
   bool just_collided;
+  // Result of this tick's collision detection, consumed by handler dispatch
+  bool colliding;
+  vector_t collision_axis;
   void *aux;
   list_t *bodies;
   free_func_t freer;
+  // Copies aux for snapshots; needed if freer is set
+  copy_func_t copier;
   bool old;
+  // Shared with every container registered under the same name, or NULL
+  callback_stats_t *stats;
+  // Contacts are resolved by the contact solver instead of a handler
+  bool contact;
+  double elasticity;
+  // The impulse the solver applied last tick, to warm start the next one,
+  // and the normal it was applied along
+  double normal_impulse;
+  vector_t contact_normal;
+  // Radial fields pull bodies towards their one body, the source; their
+  // collision handler is called for bodies within the kill radius
+  bool radial;
+  radial_field_t field;
+  // Swept pairs call this instead of collision_handler, with the fraction of
+  // the tick at which the bodies first touch
+  impact_handler_t impact_handler;
+  double impact_time;
 } bodies_force_container_t;
 
+/** A body and an index, for finding bodies by address with bsearch() */
+typedef struct indexed_body {
+  body_t *body;
+  size_t index;
+} indexed_body_t;
+
+/** A touching contact, as the contact solver works on it */
+typedef struct solver_contact {
+  bodies_force_container_t *container;
+  // Indices into the solver's bodies
+  size_t body1;
+  size_t body2;
+  vector_t normal;
+  // The inverse of the contact's effective mass along the normal
+  double inverse_mass_sum;
+  // The normal velocity the solver aims for: 0, or a bounce
+  double target_speed;
+  // Accumulated over the passes; never negative, since contacts only push
+  double impulse;
+} solver_contact_t;
+
+/**
+ * The contact solver's arrays, kept between ticks like the integrator's.
+ * Only bodies in touching contacts are gathered.
+ */
+typedef struct contact_buffers {
+  size_t contact_capacity;
+  solver_contact_t *contacts;
+  size_t body_capacity;
+  // Sorted by address; index is unused
+  indexed_body_t *bodies;
+  double *inverse_mass;
+  vector_t *velocity;
+} contact_buffers_t;
+
+/** A body within a radial field's kill radius, for its handler */
+typedef struct radial_kill {
+  bodies_force_container_t *container;
+  body_t *body;
+  // From the body towards the field's center
+  vector_t axis;
+} radial_kill_t;
+
+/** The radial fields' index of the bodies they can pull, and its results */
+typedef struct radial_buffers {
+  // NULL until the scene has a radial field
+  spatial_hash_t *hash;
+  size_t capacity;
+  // The indexed bodies and their centroids
+  body_t **bodies;
+  vector_t *centroids;
+  size_t kill_capacity;
+  size_t num_kills;
+  radial_kill_t *kills;
+} radial_buffers_t;
+
+/**
+ * Per-body arrays the integrators work on, in scene order. They are kept
+ * between ticks, so integrating allocates nothing once a scene stops growing.
+ */
+typedef struct integration_buffers {
+  size_t capacity;
+  double *inverse_mass;
+  // At the start of the tick; impulses are kept apart as velocity kicks
+  vector_t *velocity;
+  vector_t *kick;
+  vector_t *acceleration;
+  // How far each body has been moved from its start-of-tick position
+  vector_t *offset;
+  // The point inside the tick where the force creators are rerun
+  vector_t *stage_offset;
+  vector_t *stage_velocity;
+  vector_t *stage_acceleration;
+  // The acceleration from every force but the pure ones, held over the tick
+  vector_t *fixed_acceleration;
+  // The step's results: displacement and new velocity
+  vector_t *dx;
+  vector_t *new_velocity;
+  // Each body's field, premultiplied: its layer's acceleration, unless the
+  // body is static, and its drag divided by its mass
+  vector_t *field_acceleration;
+  double *drag_rate;
+} integration_buffers_t;
+
 typedef struct scene {
   list_t *bodies;
   list_t *force_containers;
+  list_t *callback_stats;
+  collision_stats_t collision_stats;
+  rng_t rng;
+  integrator_t integrator;
+  size_t max_substeps;
+  integration_buffers_t integration;
+  contact_buffers_t contact_buffers;
+  scene_field_t fields[BODY_LAYERS];
+  radial_buffers_t radial;
 } scene_t;
 
 scene_t *scene_init() {
-  scene_t *scene = malloc(sizeof(scene_t));
+  scene_t *scene = mem_alloc(sizeof(scene_t));
   assert(scene);
   scene->bodies = list_init(INITIAL_BODIES, body_free);
   scene->force_containers =
       list_init(INITIAL_FORCE_CREATORS, force_container_free);
   assert(scene->force_containers);
+  scene->callback_stats = list_init(INITIAL_CALLBACK_NAMES, mem_free);
+  scene->collision_stats = (collision_stats_t){0};
+  rng_seed(&scene->rng, DEFAULT_SEED);
+  scene->integrator = INTEGRATOR_AVERAGED_EULER;
+  scene->max_substeps = 1;
+  scene->integration = (integration_buffers_t){0};
+  scene->contact_buffers = (contact_buffers_t){0};
+  for (size_t i = 0; i < BODY_LAYERS; i++) {
+    scene->fields[i] = (scene_field_t){VEC_ZERO, 0};
+  }
+  scene->radial = (radial_buffers_t){0};
   return scene;
 }
 
@@ -40,15 +185,28 @@ void force_container_free(void *force_container) {
   if (fc->freer != NULL) {
     fc->freer(fc->aux);
   }
-  free(list_get_data(fc->bodies));
-  free(fc->bodies);
-  free(fc);
+  mem_free(list_get_data(fc->bodies));
+  mem_free(fc->bodies);
+  mem_free(fc);
 }
 
 void scene_free(scene_t *scene) {
   list_free(scene->force_containers);
   list_free(scene->bodies);
-  free(scene);
+  list_free(scene->callback_stats);
+  // The arrays share the allocation starting at velocity
+  mem_free(scene->integration.velocity);
+  mem_free(scene->contact_buffers.contacts);
+  mem_free(scene->contact_buffers.bodies);
+  mem_free(scene->contact_buffers.inverse_mass);
+  mem_free(scene->contact_buffers.velocity);
+  if (scene->radial.hash != NULL) {
+    spatial_hash_free(scene->radial.hash);
+  }
+  mem_free(scene->radial.bodies);
+  mem_free(scene->radial.centroids);
+  mem_free(scene->radial.kills);
+  mem_free(scene);
 }
 
 size_t scene_bodies(scene_t *scene) { return list_size(scene->bodies); }
@@ -72,14 +230,27 @@ void scene_remove_body(scene_t *scene, size_t index) {
 void scene_add_force_creator(scene_t *scene, force_creator_old_t forcer,
                              void *aux, free_func_t freer) {
   bodies_force_container_t *force_container =
-      malloc(sizeof(bodies_force_container_t));
+      mem_alloc(sizeof(bodies_force_container_t));
   assert(force_container);
   force_container->forcer = NULL;
+  force_container->collision_handler = NULL;
+  force_container->just_collided = false;
+  force_container->colliding = false;
   force_container->aux = aux;
   force_container->bodies = scene_get_bodies(scene);
   force_container->freer = freer;
+  force_container->copier = NULL;
   force_container->old = true;
   force_container->forcer_old = forcer;
+  force_container->pure = false;
+  force_container->stats = NULL;
+  force_container->contact = false;
+  force_container->elasticity = 0;
+  force_container->normal_impulse = 0;
+  force_container->contact_normal = VEC_ZERO;
+  force_container->radial = false;
+  force_container->impact_handler = NULL;
+  force_container->impact_time = 0;
   list_add(scene->force_containers, force_container);
 }
 
@@ -87,53 +258,500 @@ void scene_add_bodies_force_creator(scene_t *scene, force_creator_t forcer,
                                     collision_handler_t collision_handler,
                                     void *aux, list_t *bodies,
                                     free_func_t freer) {
+  scene_add_named_bodies_force_creator(scene, NULL, forcer, collision_handler,
+                                       aux, bodies, freer, NULL);
+}
+
+/** Finds the statistics for a name, or NULL if it has none yet */
+callback_stats_t *find_callback_stats(scene_t *scene, const char *name) {
+  for (size_t i = 0; i < list_size(scene->callback_stats); i++) {
+    callback_stats_t *stats = list_get(scene->callback_stats, i);
+    if (stats->name == name || strcmp(stats->name, name) == 0) {
+      return stats;
+    }
+  }
+  return NULL;
+}
+
+/** Finds the statistics for a name, adding them if needed; NULL if unnamed */
+callback_stats_t *get_callback_stats(scene_t *scene, const char *name) {
+  if (name == NULL) {
+    return NULL;
+  }
+  callback_stats_t *stats = find_callback_stats(scene, name);
+  if (stats == NULL) {
+    stats = mem_alloc(sizeof(callback_stats_t));
+    assert(stats);
+    *stats = (callback_stats_t){.name = name};
+    list_add(scene->callback_stats, stats);
+  }
+  return stats;
+}
+
+void scene_add_named_bodies_force_creator(scene_t *scene, const char *name,
+                                          force_creator_t forcer,
+                                          collision_handler_t collision_handler,
+                                          void *aux, list_t *bodies,
+                                          free_func_t freer,
+                                          copy_func_t copier) {
+  callback_stats_t *stats = get_callback_stats(scene, name);
   bodies_force_container_t *force_container =
-      malloc(sizeof(bodies_force_container_t));
+      mem_alloc(sizeof(bodies_force_container_t));
   assert(force_container);
   force_container->forcer = forcer;
   force_container->collision_handler = collision_handler;
   force_container->just_collided = false;
+  force_container->colliding = false;
   force_container->aux = aux;
   force_container->bodies = bodies;
   force_container->freer = freer;
+  force_container->copier = copier;
   force_container->old = false;
   force_container->forcer_old = NULL;
+  force_container->pure = false;
+  force_container->stats = stats;
+  force_container->contact = false;
+  force_container->elasticity = 0;
+  force_container->normal_impulse = 0;
+  force_container->contact_normal = VEC_ZERO;
+  force_container->radial = false;
+  force_container->impact_handler = NULL;
+  force_container->impact_time = 0;
   list_add(scene->force_containers, force_container);
 }
 
-void scene_tick(scene_t *scene, double dt) {
+void scene_add_pure_force_creator(scene_t *scene, const char *name,
+                                  force_creator_t forcer, void *aux,
+                                  list_t *bodies, free_func_t freer,
+                                  copy_func_t copier) {
+  scene_add_named_bodies_force_creator(scene, name, forcer, NULL, aux, bodies,
+                                       freer, copier);
+  bodies_force_container_t *force_container =
+      list_get(scene->force_containers,
+               list_size(scene->force_containers) - 1);
+  force_container->pure = true;
+}
+
+void scene_add_contact(scene_t *scene, body_t *body1, body_t *body2,
+                       double elasticity) {
+  list_t *bodies = list_init(2, body_free);
+  list_add(bodies, body1);
+  list_add(bodies, body2);
+  scene_add_bodies_force_creator(scene, NULL, NULL, NULL, bodies, NULL);
+  bodies_force_container_t *force_container =
+      list_get(scene->force_containers, list_size(scene->force_containers) - 1);
+  force_container->contact = true;
+  force_container->elasticity = elasticity;
+}
+
+void scene_add_radial_field(scene_t *scene, body_t *source,
+                            radial_field_t field, collision_handler_t handler,
+                            void *aux, free_func_t freer, copy_func_t copier) {
+  list_t *bodies = list_init(1, body_free);
+  list_add(bodies, source);
+  scene_add_named_bodies_force_creator(scene, "radial_field", NULL, handler,
+                                       aux, bodies, freer, copier);
+  bodies_force_container_t *force_container =
+      list_get(scene->force_containers, list_size(scene->force_containers) - 1);
+  force_container->radial = true;
+  force_container->field = field;
+  if (scene->radial.hash == NULL) {
+    scene->radial.hash = spatial_hash_init();
+  }
+}
+
+void scene_add_swept_collision(scene_t *scene, const char *name,
+                               body_t *body1, body_t *body2,
+                               impact_handler_t handler, void *aux,
+                               free_func_t freer, copy_func_t copier) {
+  list_t *bodies = list_init(2, body_free);
+  list_add(bodies, body1);
+  list_add(bodies, body2);
+  scene_add_named_bodies_force_creator(scene, name, NULL, NULL, aux, bodies,
+                                       freer, copier);
+  bodies_force_container_t *force_container =
+      list_get(scene->force_containers, list_size(scene->force_containers) - 1);
+  force_container->impact_handler = handler;
+}
+
+size_t scene_callback_stats_count(scene_t *scene) {
+  return list_size(scene->callback_stats);
+}
+
+callback_stats_t scene_get_callback_stats(scene_t *scene, size_t index) {
+  return *(callback_stats_t *)list_get(scene->callback_stats, index);
+}
+
+bool scene_find_callback_stats(scene_t *scene, const char *name,
+                               callback_stats_t *stats) {
+  callback_stats_t *found = find_callback_stats(scene, name);
+  if (found != NULL) {
+    *stats = *found;
+  }
+  return found != NULL;
+}
+
+void scene_reset_callback_stats(scene_t *scene) {
+  for (size_t i = 0; i < list_size(scene->callback_stats); i++) {
+    callback_stats_t *stats = list_get(scene->callback_stats, i);
+    *stats = (callback_stats_t){.name = stats->name};
+  }
+}
+
+int compare_total_time(const void *a, const void *b) {
+  uint64_t total_a = (*(callback_stats_t **)a)->total_ns;
+  uint64_t total_b = (*(callback_stats_t **)b)->total_ns;
+  return total_a < total_b ? 1 : total_a > total_b ? -1 : 0;
+}
+
+void scene_write_callback_stats(scene_t *scene, FILE *file) {
+  size_t count = list_size(scene->callback_stats);
+  callback_stats_t **sorted = mem_alloc(count * sizeof(callback_stats_t *));
+  for (size_t i = 0; i < count; i++) {
+    sorted[i] = list_get(scene->callback_stats, i);
+  }
+  qsort(sorted, count, sizeof(callback_stats_t *), compare_total_time);
+  fprintf(file, "%-28s %10s %12s %10s %10s %14s\n", "callback", "calls",
+          "total_ms", "mean_us", "max_us", "bodies_touched");
+  for (size_t i = 0; i < count; i++) {
+    callback_stats_t *stats = sorted[i];
+    double mean_us =
+        stats->invocations ? stats->total_ns / 1e3 / stats->invocations : 0;
+    fprintf(file, "%-28s %10zu %12.3f %10.3f %10.3f %14zu\n", stats->name,
+            stats->invocations, stats->total_ns / 1e6, mean_us,
+            stats->max_ns / 1e3, stats->bodies_touched);
+  }
+  mem_free(sorted);
+}
+
+/** Adds one call that started at start_ns to a container's statistics */
+void record_callback(bodies_force_container_t *bfc, uint64_t start_ns,
+                     size_t bodies_touched) {
+  uint64_t elapsed = profiler_now_ns() - start_ns;
+  callback_stats_t *stats = bfc->stats;
+  stats->invocations++;
+  stats->total_ns += elapsed;
+  if (elapsed > stats->max_ns) {
+    stats->max_ns = elapsed;
+  }
+  stats->bodies_touched += bodies_touched;
+}
+
+void apply_force_creators(scene_t *scene) {
+  PROFILE_ZONE("force_creators");
   for (size_t i = 0; i < list_size(scene->force_containers); i++) {
     bodies_force_container_t *bfc = list_get(scene->force_containers, i);
     if (bfc->forcer != NULL) {
+      uint64_t start = bfc->stats != NULL ? profiler_now_ns() : 0;
       bfc->forcer(bfc->aux, bfc->bodies);
+      if (bfc->stats != NULL) {
+        record_callback(bfc, start, list_size(bfc->bodies));
+      }
     }
     if (bfc->forcer_old != NULL) {
       bfc->forcer_old(bfc->aux);
     }
+  }
+}
+
+collision_stats_t scene_get_collision_stats(scene_t *scene) {
+  return scene->collision_stats;
+}
 
-    if (bfc->collision_handler != NULL) {
+rng_t *scene_get_rng(scene_t *scene) { return &scene->rng; }
+
+/** Whether a container is a pair of bodies whose collisions are detected */
+bool is_collision_pair(bodies_force_container_t *bfc) {
+  return (bfc->collision_handler != NULL || bfc->contact ||
+          bfc->impact_handler != NULL) &&
+         !bfc->radial;
+}
+
+/** Whether a collision pair can skip the narrow phase; see pairs_culled */
+bool can_cull_pair(bodies_force_container_t *bfc) {
+  body_t *body1 = list_get(bfc->bodies, 0);
+  body_t *body2 = list_get(bfc->bodies, 1);
+  if (body_is_removed(body1) || body_is_removed(body2)) {
+    return true;
+  }
+  return bfc->contact && body_get_mass(body1) == INFINITY &&
+         body_get_mass(body2) == INFINITY;
+}
+
+void scene_set_field(scene_t *scene, size_t layer, scene_field_t field) {
+  assert(layer < BODY_LAYERS);
+  scene->fields[layer] = field;
+}
+
+scene_field_t scene_get_field(scene_t *scene, size_t layer) {
+  assert(layer < BODY_LAYERS);
+  return scene->fields[layer];
+}
+
+/** The acceleration a body's field gives it at a velocity */
+vector_t field_acceleration(scene_field_t field, double inverse_mass,
+                            vector_t velocity) {
+  if (inverse_mass == 0) {
+    return VEC_ZERO;
+  }
+  return vec_subtract(field.acceleration,
+                      vec_multiply(field.drag * inverse_mass, velocity));
+}
+
+/**
+ * A body's velocity at the end of the tick, as its forces, field and
+ * impulses so far predict it
+ */
+vector_t predicted_velocity(scene_t *scene, body_state_t state, double dt) {
+  double inverse_mass = 1.0 / state.mass;
+  vector_t acceleration = vec_add(
+      vec_multiply(inverse_mass, state.force),
+      field_acceleration(scene->fields[state.layer], inverse_mass,
+                         state.velocity));
+  return vec_add(state.velocity,
+                 vec_add(vec_multiply(dt, acceleration),
+                         vec_multiply(inverse_mass, state.impulse)));
+}
+
+/** Finds when a swept pair first touches during the coming tick, if it does */
+impact_info_t find_pair_impact(scene_t *scene, body_t *body1, body_t *body2,
+                               double dt) {
+  vector_t motion1 =
+      vec_multiply(dt, predicted_velocity(scene, body_get_state(body1), dt));
+  vector_t motion2 =
+      vec_multiply(dt, predicted_velocity(scene, body_get_state(body2), dt));
+  list_t *shape1 = body_get_shape(body1);
+  list_t *shape2 = body_get_shape(body2);
+  impact_info_t info = find_impact(shape1, motion1, shape2, motion2);
+  mem_free(list_get_data(shape1));
+  mem_free(list_get_data(shape2));
+  mem_free(shape1);
+  mem_free(shape2);
+  return info;
+}
+
+void detect_collisions(scene_t *scene, double dt) {
+  PROFILE_ZONE("collision_detection");
+  PERF_ZONE("find_collision");
+  collision_stats_t *stats = &scene->collision_stats;
+  for (size_t i = 0; i < list_size(scene->force_containers); i++) {
+    bodies_force_container_t *bfc = list_get(scene->force_containers, i);
+    if (!is_collision_pair(bfc)) {
+      continue;
+    }
+    stats->pairs_registered++;
+    if (can_cull_pair(bfc)) {
+      stats->pairs_culled++;
+      bfc->colliding = false;
+      continue;
+    }
+    if (bfc->impact_handler != NULL) {
+      impact_info_t impact = find_pair_impact(scene, list_get(bfc->bodies, 0),
+                                              list_get(bfc->bodies, 1), dt);
+      stats->pairs_tested++;
+      stats->overlaps += impact.collided;
+      bfc->colliding = impact.collided;
+      bfc->collision_axis = impact.axis;
+      bfc->impact_time = impact.time;
+      continue;
+    }
+    list_t *shape1 = body_get_shape(list_get(bfc->bodies, 0));
+    list_t *shape2 = body_get_shape(list_get(bfc->bodies, 1));
+    collision_info_t info = find_collision(shape1, shape2);
+    stats->pairs_tested++;
+    stats->axes_tested += info.axes_tested;
+    if (info.collided) {
+      stats->overlaps++;
+    } else if (info.axes_tested > 0) {
+      size_t bucket = info.axes_tested - 1;
+      if (bucket >= COLLISION_STATS_MAX_AXES) {
+        bucket = COLLISION_STATS_MAX_AXES - 1;
+      }
+      stats->early_outs[bucket]++;
+    }
+    bfc->colliding = info.collided;
+    bfc->collision_axis = info.axis;
+    mem_free(list_get_data(shape1));
+    mem_free(list_get_data(shape2));
+    mem_free(shape1);
+    mem_free(shape2);
+  }
+}
+
+void dispatch_collision_handlers(scene_t *scene) {
+  PROFILE_ZONE("collision_handlers");
+  for (size_t i = 0; i < list_size(scene->force_containers); i++) {
+    bodies_force_container_t *bfc = list_get(scene->force_containers, i);
+    if ((bfc->collision_handler == NULL && bfc->impact_handler == NULL) ||
+        bfc->radial) {
+      continue;
+    }
+    if (!bfc->colliding) {
+      bfc->just_collided = false;
+    } else if (bfc->just_collided) {
+      scene->collision_stats.just_collided_suppressions++;
+    } else {
       body_t *body1 = list_get(bfc->bodies, 0);
       body_t *body2 = list_get(bfc->bodies, 1);
-      list_t *shape1 = body_get_shape(body1);
-      list_t *shape2 = body_get_shape(body2);
-      collision_info_t info = find_collision(shape1, shape2);
-      if (!info.collided) {
-        if (bfc->just_collided) {
-          bfc->just_collided = false;
-        }
+      uint64_t start = bfc->stats != NULL ? profiler_now_ns() : 0;
+      if (bfc->impact_handler != NULL) {
+        bfc->impact_handler(body1, body2, bfc->collision_axis,
+                            bfc->impact_time, bfc->aux);
       } else {
-        if (!(bfc->just_collided)) {
-          bfc->collision_handler(body1, body2, info.axis, bfc->aux);
-          bfc->just_collided = true;
-        }
+        bfc->collision_handler(body1, body2, bfc->collision_axis, bfc->aux);
+      }
+      if (bfc->stats != NULL) {
+        record_callback(bfc, start, 2);
       }
-      free(list_get_data(shape1));
-      free(list_get_data(shape2));
-      free(shape1);
-      free(shape2);
+      bfc->just_collided = true;
+      scene->collision_stats.handler_invocations++;
+    }
+    // Containers added by a handler are detected from the next tick on
+    bfc->colliding = false;
+  }
+}
+
+/** Doubles a capacity until it holds count elements */
+size_t grow_capacity(size_t capacity, size_t count) {
+  if (capacity == 0) {
+    capacity = INITIAL_BODIES;
+  }
+  while (capacity < count) {
+    capacity *= 2;
+  }
+  return capacity;
+}
+
+/** A radial field's query of the spatial hash, passed to its visitor */
+typedef struct radial_query {
+  scene_t *scene;
+  bodies_force_container_t *container;
+  vector_t center;
+  bool record_kills;
+} radial_query_t;
+
+/** Pulls one body found near a radial field's center */
+void pull_towards_field(size_t index, void *aux) {
+  radial_query_t *query = aux;
+  radial_buffers_t *buffers = &query->scene->radial;
+  radial_field_t *field = &query->container->field;
+  body_t *body = buffers->bodies[index];
+  if (body == list_get(query->container->bodies, 0) ||
+      !(field->layers & (1u << body_get_layer(body)))) {
+    return;
+  }
+  vector_t span = vec_subtract(query->center, buffers->centroids[index]);
+  double distance = vec_magnitude(span);
+  if (distance == 0) {
+    return;
+  }
+  vector_t axis = vec_multiply(1 / distance, span);
+  double pull = field->strength *
+                pow(1 - distance / field->radius, field->falloff);
+  body_add_force(body, vec_multiply(body_get_mass(body) * pull, axis));
+  if (query->record_kills && distance < field->kill_radius &&
+      query->container->collision_handler != NULL) {
+    if (buffers->num_kills == buffers->kill_capacity) {
+      buffers->kill_capacity =
+          grow_capacity(buffers->kill_capacity, buffers->num_kills + 1);
+      buffers->kills = mem_realloc(
+          buffers->kills, buffers->kill_capacity * sizeof(radial_kill_t));
+      assert(buffers->kills);
+    }
+    buffers->kills[buffers->num_kills++] =
+        (radial_kill_t){query->container, body, axis};
+  }
+}
+
+/**
+ * Indexes every body any radial field can pull, then has each field pull
+ * the ones within its radius. Bodies inside kill radii are recorded for
+ * dispatch_radial_kills() if record_kills is set.
+ */
+void apply_radial_fields(scene_t *scene, bool record_kills) {
+  radial_buffers_t *buffers = &scene->radial;
+  if (record_kills) {
+    buffers->num_kills = 0;
+  }
+  if (buffers->hash == NULL) {
+    return;
+  }
+  PROFILE_ZONE("radial_fields");
+  unsigned layers = 0;
+  double cell_size = 0;
+  for (size_t i = 0; i < list_size(scene->force_containers); i++) {
+    bodies_force_container_t *bfc = list_get(scene->force_containers, i);
+    if (bfc->radial) {
+      layers |= bfc->field.layers;
+      cell_size = fmax(cell_size, bfc->field.radius);
+    }
+  }
+  if (layers == 0 || cell_size <= 0) {
+    return;
+  }
+
+  size_t n = scene_bodies(scene);
+  if (n > buffers->capacity) {
+    buffers->capacity = grow_capacity(buffers->capacity, n);
+    buffers->bodies =
+        mem_realloc(buffers->bodies, buffers->capacity * sizeof(body_t *));
+    buffers->centroids =
+        mem_realloc(buffers->centroids, buffers->capacity * sizeof(vector_t));
+    assert(buffers->bodies && buffers->centroids);
+  }
+  size_t count = 0;
+  for (size_t i = 0; i < n; i++) {
+    body_t *body = list_get(scene->bodies, i);
+    if ((layers & (1u << body_get_layer(body))) &&
+        body_get_mass(body) != INFINITY) {
+      buffers->bodies[count] = body;
+      buffers->centroids[count] = body_get_centroid(body);
+      count++;
     }
   }
+  spatial_hash_build(buffers->hash, buffers->centroids, count, cell_size);
 
+  for (size_t i = 0; i < list_size(scene->force_containers); i++) {
+    bodies_force_container_t *bfc = list_get(scene->force_containers, i);
+    if (!bfc->radial) {
+      continue;
+    }
+    radial_query_t query = {
+        .scene = scene,
+        .container = bfc,
+        .center = body_get_centroid(list_get(bfc->bodies, 0)),
+        .record_kills = record_kills,
+    };
+    spatial_hash_query(buffers->hash, query.center, bfc->field.radius,
+                       pull_towards_field, &query);
+  }
+}
+
+/** Calls the handlers of the radial fields with bodies in their kill radius */
+void dispatch_radial_kills(scene_t *scene) {
+  radial_buffers_t *buffers = &scene->radial;
+  for (size_t i = 0; i < buffers->num_kills; i++) {
+    radial_kill_t *kill = &buffers->kills[i];
+    bodies_force_container_t *bfc = kill->container;
+    // An earlier handler this step may have removed either body, like
+    // can_cull_pair() skips pairs with a removed body
+    if (body_is_removed(kill->body) ||
+        body_is_removed(list_get(bfc->bodies, 0))) {
+      continue;
+    }
+    uint64_t start = bfc->stats != NULL ? profiler_now_ns() : 0;
+    bfc->collision_handler(kill->body, list_get(bfc->bodies, 0), kill->axis,
+                           bfc->aux);
+    if (bfc->stats != NULL) {
+      record_callback(bfc, start, 2);
+    }
+    scene->collision_stats.handler_invocations++;
+  }
+  buffers->num_kills = 0;
+}
+
+void remove_dead_bodies(scene_t *scene) {
+  PROFILE_ZONE("removal_sweep");
   for (int64_t i = 0; i < list_size(scene->force_containers); i++) {
     bodies_force_container_t *bfc = list_get(scene->force_containers, i);
     bool body_was_removed = false;
@@ -153,11 +771,821 @@ void scene_tick(scene_t *scene, double dt) {
   for (int64_t i = 0; i < scene_bodies(scene); i++) {
     body_t *body = list_get(scene->bodies, i);
     if (body_is_removed(body)) {
-      list_remove(scene->bodies, list_get_index(scene->bodies, body));
+      list_remove(scene->bodies, i);
       body_free(body);
       i--;
-    } else {
-      body_tick(body, dt);
     }
   }
 }
+
+void scene_set_integrator(scene_t *scene, integrator_t integrator) {
+  scene->integrator = integrator;
+}
+
+integrator_t scene_get_integrator(scene_t *scene) { return scene->integrator; }
+
+/** Grows the integration arrays to hold at least n bodies */
+void reserve_integration_buffers(integration_buffers_t *buffers, size_t n) {
+  if (n <= buffers->capacity) {
+    return;
+  }
+  size_t capacity = grow_capacity(buffers->capacity, n);
+  const size_t num_vector_arrays = 11, num_double_arrays = 2;
+  // Vectors first, so every array stays aligned
+  vector_t *vectors = mem_realloc(
+      buffers->capacity > 0 ? buffers->velocity : NULL,
+      capacity * (num_vector_arrays * sizeof(vector_t) +
+                  num_double_arrays * sizeof(double)));
+  assert(vectors);
+  *buffers = (integration_buffers_t){
+      .capacity = capacity,
+      .velocity = vectors,
+      .kick = &vectors[capacity],
+      .acceleration = &vectors[2 * capacity],
+      .offset = &vectors[3 * capacity],
+      .stage_offset = &vectors[4 * capacity],
+      .stage_velocity = &vectors[5 * capacity],
+      .stage_acceleration = &vectors[6 * capacity],
+      .fixed_acceleration = &vectors[7 * capacity],
+      .dx = &vectors[8 * capacity],
+      .new_velocity = &vectors[9 * capacity],
+      .field_acceleration = &vectors[10 * capacity],
+      .inverse_mass = (double *)&vectors[num_vector_arrays * capacity],
+      .drag_rate = (double *)&vectors[num_vector_arrays * capacity] + capacity,
+  };
+}
+
+/**
+ * Adds every body's field to its acceleration at a velocity, in one loop
+ * with no branches or lookups
+ */
+void apply_fields(integration_buffers_t *buffers, vector_t *velocity,
+                  vector_t *acceleration, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    acceleration[i] = vec_subtract(
+        vec_add(acceleration[i], buffers->field_acceleration[i]),
+        vec_multiply(buffers->drag_rate[i], velocity[i]));
+  }
+}
+
+/** Copies every body's motion, accumulated forces and field into the arrays */
+void gather_bodies(scene_t *scene, integration_buffers_t *buffers, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    body_state_t state = body_get_state(list_get(scene->bodies, i));
+    double inverse_mass = 1.0 / state.mass;
+    scene_field_t field = scene->fields[state.layer];
+    buffers->inverse_mass[i] = inverse_mass;
+    buffers->velocity[i] = state.velocity;
+    buffers->kick[i] = vec_multiply(inverse_mass, state.impulse);
+    buffers->acceleration[i] = vec_multiply(inverse_mass, state.force);
+    buffers->offset[i] = VEC_ZERO;
+    buffers->field_acceleration[i] =
+        inverse_mass == 0 ? VEC_ZERO : field.acceleration;
+    buffers->drag_rate[i] = field.drag * inverse_mass;
+  }
+  apply_fields(buffers, buffers->velocity, buffers->acceleration, n);
+}
+
+/** Moves every body by its step and resets its forces */
+void scatter_bodies(scene_t *scene, integration_buffers_t *buffers, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    body_apply_step(list_get(scene->bodies, i),
+                    vec_subtract(buffers->dx[i], buffers->offset[i]),
+                    buffers->new_velocity[i], buffers->acceleration[i]);
+  }
+}
+
+/**
+ * Runs the pure force creators and the radial fields, the forces the
+ * multi-stage integrators rerun inside the tick. These calls are not
+ * recorded in the callback statistics, which count each tick's calls once.
+ */
+void apply_pure_forces(scene_t *scene) {
+  for (size_t i = 0; i < list_size(scene->force_containers); i++) {
+    bodies_force_container_t *bfc = list_get(scene->force_containers, i);
+    if (bfc->pure) {
+      bfc->forcer(bfc->aux, bfc->bodies);
+    }
+  }
+  apply_radial_fields(scene, false);
+}
+
+/**
+ * Sets aside the part of every body's acceleration that the stages hold
+ * fixed: everything but the pure forces, which are rerun at the start of the
+ * tick to tell them apart
+ */
+void gather_fixed_accelerations(scene_t *scene,
+                                integration_buffers_t *buffers, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    body_apply_step(list_get(scene->bodies, i), VEC_ZERO, buffers->velocity[i],
+                    buffers->acceleration[i]);
+  }
+  apply_pure_forces(scene);
+  for (size_t i = 0; i < n; i++) {
+    body_state_t state = body_get_state(list_get(scene->bodies, i));
+    vector_t pure = vec_multiply(buffers->inverse_mass[i], state.force);
+    // The fields are applied again at each stage's velocity
+    vector_t field =
+        vec_subtract(buffers->field_acceleration[i],
+                     vec_multiply(buffers->drag_rate[i], buffers->velocity[i]));
+    buffers->fixed_acceleration[i] =
+        vec_subtract(vec_subtract(buffers->acceleration[i], pure), field);
+  }
+}
+
+/**
+ * Moves every body to its stage offset and velocity, reruns the pure forces
+ * there, and writes the resulting accelerations
+ */
+void evaluate_stage(scene_t *scene, integration_buffers_t *buffers, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    body_apply_step(list_get(scene->bodies, i),
+                    vec_subtract(buffers->stage_offset[i], buffers->offset[i]),
+                    buffers->stage_velocity[i], buffers->acceleration[i]);
+    buffers->offset[i] = buffers->stage_offset[i];
+  }
+  apply_pure_forces(scene);
+  for (size_t i = 0; i < n; i++) {
+    body_state_t state = body_get_state(list_get(scene->bodies, i));
+    buffers->stage_acceleration[i] =
+        vec_add(vec_multiply(buffers->inverse_mass[i], state.force),
+                buffers->fixed_acceleration[i]);
+  }
+  apply_fields(buffers, buffers->stage_velocity, buffers->stage_acceleration,
+               n);
+}
+
+/** Adds each body's impulse to its velocity */
+void apply_kicks(integration_buffers_t *buffers, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    buffers->velocity[i] = vec_add(buffers->velocity[i], buffers->kick[i]);
+  }
+}
+
+/** The same step as body_tick(), for every body */
+void averaged_euler_step(integration_buffers_t *buffers, size_t n, double dt) {
+  for (size_t i = 0; i < n; i++) {
+    vector_t velocity = buffers->velocity[i];
+    vector_t new_velocity =
+        vec_add(vec_add(velocity, vec_multiply(dt, buffers->acceleration[i])),
+                buffers->kick[i]);
+    buffers->new_velocity[i] = new_velocity;
+    buffers->dx[i] =
+        vec_multiply(dt, vec_multiply(0.5, vec_add(velocity, new_velocity)));
+  }
+}
+
+void semi_implicit_euler_step(integration_buffers_t *buffers, size_t n,
+                              double dt) {
+  apply_kicks(buffers, n);
+  for (size_t i = 0; i < n; i++) {
+    vector_t new_velocity =
+        vec_add(buffers->velocity[i], vec_multiply(dt, buffers->acceleration[i]));
+    buffers->new_velocity[i] = new_velocity;
+    buffers->dx[i] = vec_multiply(dt, new_velocity);
+  }
+}
+
+void velocity_verlet_step(scene_t *scene, integration_buffers_t *buffers,
+                          size_t n, double dt) {
+  gather_fixed_accelerations(scene, buffers, n);
+  apply_kicks(buffers, n);
+  for (size_t i = 0; i < n; i++) {
+    vector_t velocity = buffers->velocity[i];
+    vector_t acceleration = buffers->acceleration[i];
+    buffers->stage_offset[i] = vec_add(vec_multiply(dt, velocity),
+                                       vec_multiply(0.5 * dt * dt, acceleration));
+    // Velocity-dependent forces, e.g. drag, see a first-order prediction
+    buffers->stage_velocity[i] = vec_add(velocity, vec_multiply(dt, acceleration));
+  }
+  evaluate_stage(scene, buffers, n);
+  for (size_t i = 0; i < n; i++) {
+    vector_t mean_acceleration = vec_multiply(
+        0.5, vec_add(buffers->acceleration[i], buffers->stage_acceleration[i]));
+    buffers->dx[i] = buffers->stage_offset[i];
+    buffers->new_velocity[i] =
+        vec_add(buffers->velocity[i], vec_multiply(dt, mean_acceleration));
+  }
+}
+
+/**
+ * Sets up the next RK4 stage, a time h into the tick along the last
+ * stage's velocity and acceleration
+ */
+void rk4_stage(integration_buffers_t *buffers, size_t n, double h) {
+  for (size_t i = 0; i < n; i++) {
+    buffers->stage_offset[i] = vec_multiply(h, buffers->stage_velocity[i]);
+    buffers->stage_velocity[i] =
+        vec_add(buffers->velocity[i],
+                vec_multiply(h, buffers->stage_acceleration[i]));
+  }
+}
+
+/** Adds the last stage's velocity and acceleration to the weighted sums */
+void rk4_accumulate(integration_buffers_t *buffers, size_t n, double weight) {
+  for (size_t i = 0; i < n; i++) {
+    buffers->dx[i] =
+        vec_add(buffers->dx[i], vec_multiply(weight, buffers->stage_velocity[i]));
+    buffers->new_velocity[i] =
+        vec_add(buffers->new_velocity[i],
+                vec_multiply(weight, buffers->stage_acceleration[i]));
+  }
+}
+
+void rk4_step(scene_t *scene, integration_buffers_t *buffers, size_t n,
+              double dt) {
+  gather_fixed_accelerations(scene, buffers, n);
+  apply_kicks(buffers, n);
+  // dx and new_velocity sum the stages' velocities and accelerations
+  for (size_t i = 0; i < n; i++) {
+    buffers->stage_velocity[i] = buffers->velocity[i];
+    buffers->stage_acceleration[i] = buffers->acceleration[i];
+    buffers->dx[i] = buffers->velocity[i];
+    buffers->new_velocity[i] = buffers->acceleration[i];
+  }
+  rk4_stage(buffers, n, dt / 2);
+  evaluate_stage(scene, buffers, n);
+  rk4_accumulate(buffers, n, 2);
+  rk4_stage(buffers, n, dt / 2);
+  evaluate_stage(scene, buffers, n);
+  rk4_accumulate(buffers, n, 2);
+  rk4_stage(buffers, n, dt);
+  evaluate_stage(scene, buffers, n);
+  rk4_accumulate(buffers, n, 1);
+  for (size_t i = 0; i < n; i++) {
+    buffers->dx[i] = vec_multiply(dt / 6, buffers->dx[i]);
+    buffers->new_velocity[i] = vec_add(
+        buffers->velocity[i], vec_multiply(dt / 6, buffers->new_velocity[i]));
+  }
+}
+
+int compare_indexed_bodies(const void *a, const void *b) {
+  uintptr_t body_a = (uintptr_t)((indexed_body_t *)a)->body;
+  uintptr_t body_b = (uintptr_t)((indexed_body_t *)b)->body;
+  return body_a < body_b ? -1 : body_a > body_b ? 1 : 0;
+}
+
+/** Grows the solver's per-body arrays to hold at least count bodies */
+void reserve_solver_bodies(contact_buffers_t *buffers, size_t count) {
+  if (count <= buffers->body_capacity) {
+    return;
+  }
+  size_t capacity = grow_capacity(buffers->body_capacity, count);
+  buffers->bodies =
+      mem_realloc(buffers->bodies, capacity * sizeof(indexed_body_t));
+  buffers->inverse_mass =
+      mem_realloc(buffers->inverse_mass, capacity * sizeof(double));
+  buffers->velocity = mem_realloc(buffers->velocity, capacity * sizeof(vector_t));
+  assert(buffers->bodies && buffers->inverse_mass && buffers->velocity);
+  buffers->body_capacity = capacity;
+}
+
+/** Finds a gathered body's index among the solver's bodies */
+size_t find_solver_body(contact_buffers_t *buffers, size_t num_bodies,
+                        body_t *body) {
+  indexed_body_t key = {.body = body};
+  indexed_body_t *found = bsearch(&key, buffers->bodies, num_bodies,
+                                  sizeof(indexed_body_t),
+                                  compare_indexed_bodies);
+  assert(found != NULL);
+  return found - buffers->bodies;
+}
+
+/**
+ * Gathers every touching contact and the bodies they touch, with each body's
+ * velocity at the end of the tick as forces, fields and impulses so far
+ * predict it.
+ * Returns the number of contacts; the number of bodies is written out.
+ */
+size_t gather_contacts(scene_t *scene, double dt, size_t *num_bodies) {
+  contact_buffers_t *buffers = &scene->contact_buffers;
+  size_t num_contacts = 0;
+  for (size_t i = 0; i < list_size(scene->force_containers); i++) {
+    bodies_force_container_t *bfc = list_get(scene->force_containers, i);
+    if (!bfc->contact) {
+      continue;
+    }
+    if (!bfc->colliding) {
+      bfc->normal_impulse = 0;
+      continue;
+    }
+    if (num_contacts == buffers->contact_capacity) {
+      buffers->contact_capacity =
+          grow_capacity(buffers->contact_capacity, num_contacts + 1);
+      buffers->contacts =
+          mem_realloc(buffers->contacts,
+                      buffers->contact_capacity * sizeof(solver_contact_t));
+      assert(buffers->contacts);
+    }
+    buffers->contacts[num_contacts++] = (solver_contact_t){.container = bfc};
+  }
+  *num_bodies = 0;
+  // Most ticks have nothing touching, and no arrays to sort
+  if (num_contacts == 0) {
+    return 0;
+  }
+
+  // Each body once, sorted so contacts can find theirs
+  reserve_solver_bodies(buffers, 2 * num_contacts);
+  for (size_t i = 0; i < num_contacts; i++) {
+    list_t *bodies = buffers->contacts[i].container->bodies;
+    buffers->bodies[2 * i] = (indexed_body_t){.body = list_get(bodies, 0)};
+    buffers->bodies[2 * i + 1] = (indexed_body_t){.body = list_get(bodies, 1)};
+  }
+  qsort(buffers->bodies, 2 * num_contacts, sizeof(indexed_body_t),
+        compare_indexed_bodies);
+  size_t unique = 0;
+  for (size_t i = 0; i < 2 * num_contacts; i++) {
+    if (unique == 0 ||
+        buffers->bodies[unique - 1].body != buffers->bodies[i].body) {
+      buffers->bodies[unique++] = buffers->bodies[i];
+    }
+  }
+  for (size_t i = 0; i < unique; i++) {
+    body_state_t state = body_get_state(buffers->bodies[i].body);
+    buffers->inverse_mass[i] = 1.0 / state.mass;
+    buffers->velocity[i] = predicted_velocity(scene, state, dt);
+  }
+  *num_bodies = unique;
+  return num_contacts;
+}
+
+/** The bounce of a contact: the larger of its bodies' materials' */
+double contact_elasticity(bodies_force_container_t *bfc) {
+  double elasticity1 = body_get_elasticity(list_get(bfc->bodies, 0));
+  double elasticity2 = body_get_elasticity(list_get(bfc->bodies, 1));
+  if (isnan(elasticity1) && isnan(elasticity2)) {
+    return bfc->elasticity;
+  }
+  // fmax() ignores a NAN argument
+  return fmax(elasticity1, elasticity2);
+}
+
+/** Applies an impulse along a contact's normal to the solver's velocities */
+void apply_contact_impulse(contact_buffers_t *buffers,
+                           solver_contact_t *contact, double impulse) {
+  vector_t j = vec_multiply(impulse, contact->normal);
+  size_t body1 = contact->body1, body2 = contact->body2;
+  buffers->velocity[body1] = vec_subtract(
+      buffers->velocity[body1], vec_multiply(buffers->inverse_mass[body1], j));
+  buffers->velocity[body2] = vec_add(
+      buffers->velocity[body2], vec_multiply(buffers->inverse_mass[body2], j));
+}
+
+/** How fast a contact's bodies move apart along its normal */
+double contact_normal_speed(contact_buffers_t *buffers,
+                            solver_contact_t *contact) {
+  return vec_dot(vec_subtract(buffers->velocity[contact->body2],
+                              buffers->velocity[contact->body1]),
+                 contact->normal);
+}
+
+/**
+ * Solves every touching contact together with sequential impulses:
+ * each pass pushes every approaching contact apart, and the accumulated
+ * impulses are applied to the bodies at the end, for the integrator.
+ */
+void solve_contacts(scene_t *scene, double dt) {
+  PROFILE_ZONE("contact_solver");
+  contact_buffers_t *buffers = &scene->contact_buffers;
+  size_t num_bodies;
+  size_t num_contacts = gather_contacts(scene, dt, &num_bodies);
+  if (num_contacts == 0) {
+    return;
+  }
+  scene->collision_stats.contacts_solved += num_contacts;
+  for (size_t i = 0; i < num_contacts; i++) {
+    solver_contact_t *contact = &buffers->contacts[i];
+    bodies_force_container_t *bfc = contact->container;
+    contact->body1 = find_solver_body(buffers, num_bodies,
+                                      list_get(bfc->bodies, 0));
+    contact->body2 = find_solver_body(buffers, num_bodies,
+                                      list_get(bfc->bodies, 1));
+    // find_collision()'s axis may point either way; the solver's points from
+    // body 1 to body 2, as find_impact()'s does
+    vector_t offset =
+        vec_subtract(body_get_centroid(list_get(bfc->bodies, 1)),
+                     body_get_centroid(list_get(bfc->bodies, 0)));
+    contact->normal = vec_dot(offset, bfc->collision_axis) < 0
+                          ? vec_negate(bfc->collision_axis)
+                          : bfc->collision_axis;
+    // An impulse along last tick's normal would pull the bodies together
+    // along a flipped one
+    if (vec_dot(contact->normal, bfc->contact_normal) < 0) {
+      bfc->normal_impulse = 0;
+    }
+    bfc->contact_normal = contact->normal;
+    contact->inverse_mass_sum = buffers->inverse_mass[contact->body1] +
+                                buffers->inverse_mass[contact->body2];
+    double speed = contact_normal_speed(buffers, contact);
+    contact->target_speed =
+        speed < -CONTACT_RESTING_SPEED ? -contact_elasticity(bfc) * speed : 0;
+    // Warm start: last tick's impulse is usually close to this tick's
+    contact->impulse = contact->inverse_mass_sum > 0 ? bfc->normal_impulse : 0;
+    apply_contact_impulse(buffers, contact, contact->impulse);
+    bfc->colliding = false;
+  }
+
+  for (size_t pass = 0; pass < CONTACT_ITERATIONS; pass++) {
+    for (size_t i = 0; i < num_contacts; i++) {
+      solver_contact_t *contact = &buffers->contacts[i];
+      if (contact->inverse_mass_sum == 0) {
+        continue;
+      }
+      double speed = contact_normal_speed(buffers, contact);
+      double impulse =
+          contact->impulse +
+          (contact->target_speed - speed) / contact->inverse_mass_sum;
+      if (impulse < 0) {
+        impulse = 0;
+      }
+      apply_contact_impulse(buffers, contact, impulse - contact->impulse);
+      contact->impulse = impulse;
+    }
+  }
+
+  for (size_t i = 0; i < num_contacts; i++) {
+    solver_contact_t *contact = &buffers->contacts[i];
+    bodies_force_container_t *bfc = contact->container;
+    vector_t j = vec_multiply(contact->impulse, contact->normal);
+    body_add_impulse(list_get(bfc->bodies, 0), vec_negate(j));
+    body_add_impulse(list_get(bfc->bodies, 1), j);
+    bfc->normal_impulse = contact->impulse;
+  }
+}
+
+void integrate_bodies(scene_t *scene, double dt) {
+  PROFILE_ZONE("integration");
+  size_t n = scene_bodies(scene);
+  integration_buffers_t *buffers = &scene->integration;
+  reserve_integration_buffers(buffers, n);
+  gather_bodies(scene, buffers, n);
+  switch (scene->integrator) {
+  case INTEGRATOR_AVERAGED_EULER:
+    averaged_euler_step(buffers, n, dt);
+    break;
+  case INTEGRATOR_SEMI_IMPLICIT_EULER:
+    semi_implicit_euler_step(buffers, n, dt);
+    break;
+  case INTEGRATOR_VELOCITY_VERLET:
+    velocity_verlet_step(scene, buffers, n, dt);
+    break;
+  case INTEGRATOR_RK4:
+    rk4_step(scene, buffers, n, dt);
+    break;
+  }
+  scatter_bodies(scene, buffers, n);
+}
+
+void scene_set_max_substeps(scene_t *scene, size_t max_substeps) {
+  assert(max_substeps >= 1);
+  scene->max_substeps = max_substeps;
+}
+
+size_t scene_get_max_substeps(scene_t *scene) { return scene->max_substeps; }
+
+/**
+ * Picks the fewest substeps, up to the scene's limit, in which no collision
+ * pair moves relative to each other by more than SUBSTEP_TRAVEL of the
+ * thinner body's extent
+ */
+size_t choose_substeps(scene_t *scene, double dt) {
+  if (scene->max_substeps == 1) {
+    return 1;
+  }
+  double needed = 1;
+  for (size_t i = 0; i < list_size(scene->force_containers); i++) {
+    bodies_force_container_t *bfc = list_get(scene->force_containers, i);
+    // Swept pairs find impacts partway through a tick without substeps
+    if (!is_collision_pair(bfc) || bfc->impact_handler != NULL) {
+      continue;
+    }
+    body_t *body1 = list_get(bfc->bodies, 0);
+    body_t *body2 = list_get(bfc->bodies, 1);
+    double travel = dt * vec_magnitude(vec_subtract(body_get_velocity(body1),
+                                                    body_get_velocity(body2)));
+    double thinnest = fmin(body_get_extent(body1), body_get_extent(body2));
+    if (thinnest > 0) {
+      needed = fmax(needed, travel / (SUBSTEP_TRAVEL * thinnest));
+    }
+  }
+  if (needed >= scene->max_substeps) {
+    return scene->max_substeps;
+  }
+  return (size_t)ceil(needed);
+}
+
+/** Runs a whole tick of the scene's pipeline, for one substep */
+void scene_step(scene_t *scene, double dt) {
+  apply_force_creators(scene);
+  apply_radial_fields(scene, true);
+  detect_collisions(scene, dt);
+  dispatch_collision_handlers(scene);
+  dispatch_radial_kills(scene);
+  remove_dead_bodies(scene);
+  solve_contacts(scene, dt);
+  integrate_bodies(scene, dt);
+}
+
+void scene_tick(scene_t *scene, double dt) {
+  PROFILE_ZONE("scene_tick");
+  PERF_ZONE("scene_tick");
+  scene->collision_stats = (collision_stats_t){0};
+  size_t substeps = choose_substeps(scene, dt);
+  scene->collision_stats.substeps = substeps;
+  for (size_t i = 0; i < substeps; i++) {
+    scene_step(scene, dt / substeps);
+  }
+}
+
+/** A saved info or aux: shared if borrowed, otherwise the snapshot's copy */
+typedef struct saved_value {
+  void *value;
+  free_func_t freer;
+  copy_func_t copier;
+} saved_value_t;
+
+typedef struct saved_body {
+  body_state_t state;
+  size_t first_vertex;
+  size_t num_vertices;
+  saved_value_t info;
+  image_t image;
+  bool has_image;
+} saved_body_t;
+
+typedef struct saved_container {
+  force_creator_t forcer;
+  force_creator_old_t forcer_old;
+  bool pure;
+  collision_handler_t collision_handler;
+  bool just_collided;
+  bool old;
+  bool contact;
+  double elasticity;
+  double normal_impulse;
+  vector_t contact_normal;
+  bool radial;
+  radial_field_t field;
+  impact_handler_t impact_handler;
+  saved_value_t aux;
+  const char *name;
+  size_t first_body;
+  size_t num_bodies;
+} saved_container_t;
+
+/**
+ * The arrays follow the header in the same allocation, in this order,
+ * each aligned like malloc()'s memory.
+ */
+typedef struct scene_snapshot {
+  size_t size;
+  rng_t rng;
+  size_t num_bodies;
+  size_t num_containers;
+  saved_body_t *bodies;
+  saved_container_t *containers;
+  vector_t *vertices;
+  // For each container's bodies, their indices in bodies
+  size_t *body_indices;
+} scene_snapshot_t;
+
+
+size_t align_snapshot_size(size_t size) {
+  size_t alignment = _Alignof(max_align_t);
+  return (size + alignment - 1) / alignment * alignment;
+}
+
+/** Whether a value is owned, so the snapshot keeps its own copy */
+bool saved_value_owned(saved_value_t *saved) {
+  return saved->value != NULL && saved->freer != NULL;
+}
+
+saved_value_t save_value(void *value, free_func_t freer, copy_func_t copier) {
+  saved_value_t saved = {.value = value, .freer = freer, .copier = copier};
+  if (saved_value_owned(&saved)) {
+    // Only the owner knows what an owned value holds, e.g. pointers
+    assert(copier != NULL);
+    saved.value = copier(value);
+  }
+  return saved;
+}
+
+void *restore_value(saved_value_t *saved) {
+  return saved_value_owned(saved) ? saved->copier(saved->value)
+                                  : saved->value;
+}
+
+void release_value(saved_value_t *saved) {
+  if (saved_value_owned(saved)) {
+    saved->freer(saved->value);
+  }
+}
+
+scene_snapshot_t *scene_snapshot(scene_t *scene) {
+  size_t num_bodies = scene_bodies(scene);
+  size_t num_containers = list_size(scene->force_containers);
+
+  // First pass: size every array
+  size_t num_vertices = 0, num_body_indices = 0;
+  for (size_t i = 0; i < num_bodies; i++) {
+    list_t *shape = body_get_shape(list_get(scene->bodies, i));
+    num_vertices += list_size(shape);
+    mem_free(list_get_data(shape));
+    mem_free(shape);
+  }
+  for (size_t i = 0; i < num_containers; i++) {
+    bodies_force_container_t *bfc = list_get(scene->force_containers, i);
+    num_body_indices += list_size(bfc->bodies);
+  }
+  size_t bodies_offset = align_snapshot_size(sizeof(scene_snapshot_t));
+  size_t containers_offset =
+      bodies_offset + align_snapshot_size(num_bodies * sizeof(saved_body_t));
+  size_t vertices_offset =
+      containers_offset +
+      align_snapshot_size(num_containers * sizeof(saved_container_t));
+  size_t indices_offset =
+      vertices_offset + align_snapshot_size(num_vertices * sizeof(vector_t));
+  size_t size =
+      indices_offset + align_snapshot_size(num_body_indices * sizeof(size_t));
+
+  unsigned char *block = mem_alloc(size);
+  assert(block);
+  scene_snapshot_t *snapshot = (scene_snapshot_t *)block;
+  *snapshot = (scene_snapshot_t){
+      .size = size,
+      .rng = scene->rng,
+      .num_bodies = num_bodies,
+      .num_containers = num_containers,
+      .bodies = (saved_body_t *)&block[bodies_offset],
+      .containers = (saved_container_t *)&block[containers_offset],
+      .vertices = (vector_t *)&block[vertices_offset],
+      .body_indices = (size_t *)&block[indices_offset],
+  };
+
+  // Second pass: fill them in
+  indexed_body_t *by_address = mem_alloc(num_bodies * sizeof(indexed_body_t));
+  assert(num_bodies == 0 || by_address);
+  size_t vertices_used = 0;
+  for (size_t i = 0; i < num_bodies; i++) {
+    body_t *body = list_get(scene->bodies, i);
+    by_address[i] = (indexed_body_t){body, i};
+    saved_body_t *saved = &snapshot->bodies[i];
+    list_t *shape = body_get_shape(body);
+    *saved = (saved_body_t){
+        .state = body_get_state(body),
+        .first_vertex = vertices_used,
+        .num_vertices = list_size(shape),
+        .info = save_value(body_get_info(body), body_get_info_freer(body),
+                           body_get_info_copier(body)),
+    };
+    for (size_t j = 0; j < saved->num_vertices; j++) {
+      snapshot->vertices[vertices_used++] = *(vector_t *)list_get(shape, j);
+    }
+    mem_free(list_get_data(shape));
+    mem_free(shape);
+    image_t *image = body_get_image(body);
+    if (image != NULL) {
+      saved->image = *image;
+      saved->has_image = true;
+      if (image->image != NULL) {
+        image->image->refcount++;
+      }
+    }
+  }
+  qsort(by_address, num_bodies, sizeof(indexed_body_t),
+        compare_indexed_bodies);
+
+  size_t indices_used = 0;
+  for (size_t i = 0; i < num_containers; i++) {
+    bodies_force_container_t *bfc = list_get(scene->force_containers, i);
+    saved_container_t *saved = &snapshot->containers[i];
+    *saved = (saved_container_t){
+        .forcer = bfc->forcer,
+        .forcer_old = bfc->forcer_old,
+        .pure = bfc->pure,
+        .collision_handler = bfc->collision_handler,
+        .just_collided = bfc->just_collided,
+        .old = bfc->old,
+        .contact = bfc->contact,
+        .elasticity = bfc->elasticity,
+        .normal_impulse = bfc->normal_impulse,
+        .contact_normal = bfc->contact_normal,
+        .radial = bfc->radial,
+        .field = bfc->field,
+        .impact_handler = bfc->impact_handler,
+        .aux = save_value(bfc->aux, bfc->freer, bfc->copier),
+        .name = bfc->stats != NULL ? bfc->stats->name : NULL,
+        .first_body = indices_used,
+        .num_bodies = list_size(bfc->bodies),
+    };
+    for (size_t j = 0; j < saved->num_bodies; j++) {
+      indexed_body_t key = {.body = list_get(bfc->bodies, j)};
+      indexed_body_t *found =
+          bsearch(&key, by_address, num_bodies, sizeof(indexed_body_t),
+                  compare_indexed_bodies);
+      // Force creators may only act on bodies in the scene
+      assert(found != NULL);
+      snapshot->body_indices[indices_used++] = found->index;
+    }
+  }
+  mem_free(by_address);
+  return snapshot;
+}
+
+void scene_restore(scene_t *scene, scene_snapshot_t *snapshot) {
+  list_free(scene->force_containers);
+  list_free(scene->bodies);
+  scene->bodies = list_init(snapshot->num_bodies > INITIAL_BODIES
+                                ? snapshot->num_bodies
+                                : INITIAL_BODIES,
+                            body_free);
+  scene->force_containers =
+      list_init(snapshot->num_containers > INITIAL_FORCE_CREATORS
+                    ? snapshot->num_containers
+                    : INITIAL_FORCE_CREATORS,
+                force_container_free);
+
+  for (size_t i = 0; i < snapshot->num_bodies; i++) {
+    saved_body_t *saved = &snapshot->bodies[i];
+    list_t *shape = list_init(saved->num_vertices, mem_free);
+    for (size_t j = 0; j < saved->num_vertices; j++) {
+      vector_t *vertex = mem_alloc(sizeof(vector_t));
+      assert(vertex);
+      *vertex = snapshot->vertices[saved->first_vertex + j];
+      list_add(shape, vertex);
+    }
+    image_t *image = NULL;
+    if (saved->has_image) {
+      image = mem_alloc(sizeof(image_t));
+      assert(image);
+      *image = saved->image;
+      if (image->image != NULL) {
+        image->image->refcount++;
+      }
+    }
+    body_t *body = body_init_with_info(
+        shape, saved->state.mass, saved->state.color,
+        restore_value(&saved->info), saved->info.freer, image);
+    body_set_info_copier(body, saved->info.copier);
+    body_set_state(body, saved->state);
+    list_add(scene->bodies, body);
+  }
+
+  for (size_t i = 0; i < snapshot->num_containers; i++) {
+    saved_container_t *saved = &snapshot->containers[i];
+    list_t *bodies = list_init(saved->num_bodies, body_free);
+    for (size_t j = 0; j < saved->num_bodies; j++) {
+      size_t index = snapshot->body_indices[saved->first_body + j];
+      list_add(bodies, list_get(scene->bodies, index));
+    }
+    bodies_force_container_t *bfc =
+        mem_alloc(sizeof(bodies_force_container_t));
+    assert(bfc);
+    *bfc = (bodies_force_container_t){
+        .forcer = saved->forcer,
+        .forcer_old = saved->forcer_old,
+        .pure = saved->pure,
+        .collision_handler = saved->collision_handler,
+        .just_collided = saved->just_collided,
+        .colliding = false,
+        .aux = restore_value(&saved->aux),
+        .bodies = bodies,
+        .freer = saved->aux.freer,
+        .copier = saved->aux.copier,
+        .old = saved->old,
+        .stats = get_callback_stats(scene, saved->name),
+        .contact = saved->contact,
+        .elasticity = saved->elasticity,
+        .normal_impulse = saved->normal_impulse,
+        .contact_normal = saved->contact_normal,
+        .radial = saved->radial,
+        .field = saved->field,
+        .impact_handler = saved->impact_handler,
+    };
+    list_add(scene->force_containers, bfc);
+    if (bfc->radial && scene->radial.hash == NULL) {
+      scene->radial.hash = spatial_hash_init();
+    }
+  }
+  scene->rng = snapshot->rng;
+}
+
+size_t scene_snapshot_size(scene_snapshot_t *snapshot) {
+  return snapshot->size;
+}
+
+void scene_snapshot_free(scene_snapshot_t *snapshot) {
+  for (size_t i = 0; i < snapshot->num_bodies; i++) {
+    saved_body_t *saved = &snapshot->bodies[i];
+    release_value(&saved->info);
+    if (saved->has_image && saved->image.image != NULL) {
+      SDL_FreeSurface(saved->image.image);
+    }
+  }
+  for (size_t i = 0; i < snapshot->num_containers; i++) {
+    release_value(&snapshot->containers[i].aux);
+  }
+  mem_free(snapshot);
+}
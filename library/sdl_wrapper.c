@@ -1,16 +1,28 @@
 #include "sdl_wrapper.h"
+#include "asset.h"
+#include "mem.h"
+#include "perf.h"
+#include "profiler.h"
+#include "render_snapshot.h"
+#include "replay.h"
 #include <SDL2/SDL2_gfxPrimitives.h>
 #include <assert.h>
 #include <math.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
 #include <dirent.h>
 #include <limits.h>
+#include <string.h>
 
 const char WINDOW_TITLE[] = "CS 3";
 const int SDL_WINDOW_WIDTH = 1000;
 const int SDL_WINDOW_HEIGHT = 500;
 const double MS_PER_S = 1e3;
+const char BACKEND_ENV_VAR[] = "RENDER_BACKEND";
+const char OVERLAY_FONT[] = "assets/Sans.ttf";
+const int OVERLAY_FONT_SIZE = 12;
+const SDL_Color OVERLAY_COLOR = {255, 0, 0};
 
 // Text constants
 // SDL_Color RED = {255, 0, 0};
@@ -21,45 +33,107 @@ size_t TEXT_W1 = 50;
 size_t TEXT_H1 = 25;
 
 /**
- * The coordinate at the center of the screen.
+ * Everything kept per game instance. See sdl_context_t.
  */
-vector_t center;
+typedef struct sdl_context {
+  /** The backend sdl_init() will create */
+  render_backend_t render_backend;
+  /** The coordinate at the center of the screen */
+  vector_t center;
+  /** The coordinate difference from the center to the top right corner */
+  vector_t max_diff;
+  /** The SDL window where the scene is rendered, or NULL if offscreen */
+  SDL_Window *window;
+  /** The renderer used to draw the scene, or NULL for RENDER_BACKEND_NONE */
+  SDL_Renderer *renderer;
+  /** The offscreen surface drawn into by RENDER_BACKEND_SOFTWARE, or NULL */
+  SDL_Surface *framebuffer;
+  /**
+   * Wall-clock seconds spent drawing the last frame; guarded by render_lock
+   * while the render thread runs
+   */
+  double last_render_time;
+  /** The keypress handler, or NULL if none has been configured */
+  key_handler_t key_handler;
+  /**
+   * SDL's timestamp when a key was last pressed or released.
+   * Used to mesasure how long a key has been held.
+   */
+  uint32_t key_start_timestamp;
+  /** The value of clock() when time_since_last_tick() was last called */
+  clock_t last_clock;
+  /** If positive, the value time_since_last_tick() returns instead */
+  double fixed_dt;
+  /** Whether sdl_render_scene() should draw; cleared for skipped frames */
+  bool render_enabled;
+  /**
+   * The work done so far drawing the current frame, and by the last whole
+   * frame. last_render_stats is guarded by render_lock while the render thread
+   * runs.
+   */
+  render_stats_t frame_stats;
+  render_stats_t last_render_stats;
+  /**
+   * Whether to draw the stats overlay, guarded by render_lock while the
+   * render thread runs, and the font it is drawn with, which only the thread
+   * drawing frames opens and closes
+   */
+  bool stats_overlay;
+  TTF_Font *overlay_font;
+} sdl_context_t;
+
+/**
+ * The context used by threads that never call sdl_set_context(),
+ * i.e. the single game of a normal run.
+ */
+sdl_context_t default_context = {.render_backend = RENDER_BACKEND_WINDOW,
+                                 .render_enabled = true};
 /**
- * The coordinate difference from the center to the top right corner.
+ * The context the calling thread draws into and takes input from.
  */
-vector_t max_diff;
+_Thread_local sdl_context_t *context = &default_context;
+
 /**
- * The SDL window where the scene is rendered.
+ * The thread drawing published snapshots, or NULL when rendering inline.
+ * Only one context at a time can use a render thread.
  */
-SDL_Window *window;
+SDL_Thread *render_thread = NULL;
 /**
- * The renderer used to draw the scene.
+ * Guards the snapshot hand-off between the simulation and render threads.
  */
-SDL_Renderer *renderer;
+SDL_mutex *render_lock;
+SDL_cond *render_cond;
 /**
- * The keypress handler, or NULL if none has been configured.
+ * Triple buffer of snapshots. The simulation thread only touches back_snapshot
+ * and the render thread only touches front_snapshot; they are exchanged with
+ * ready_snapshot under render_lock, so neither thread ever waits for the other
+ * to finish a frame.
  */
-key_handler_t key_handler = NULL;
+render_snapshot_t *back_snapshot;
+render_snapshot_t *ready_snapshot;
+render_snapshot_t *front_snapshot;
 /**
- * SDL's timestamp when a key was last pressed or released.
- * Used to mesasure how long a key has been held.
+ * Whether ready_snapshot holds a frame the render thread has not drawn yet.
  */
-uint32_t key_start_timestamp;
+bool snapshot_pending = false;
 /**
- * The value of clock() when time_since_last_tick() was last called.
- * Initially 0.
+ * Cleared to ask the render thread to exit.
  */
-clock_t last_clock = 0;
+bool render_thread_running = false;
 
 /** Computes the center of the window in pixel coordinates */
 vector_t get_window_center(void) {
-  int *width = malloc(sizeof(*width)), *height = malloc(sizeof(*height));
+  int *width = mem_alloc(sizeof(*width)), *height = mem_alloc(sizeof(*height));
   assert(width != NULL);
   assert(height != NULL);
-  SDL_GetWindowSize(window, width, height);
+  if (context->window != NULL) {
+    SDL_GetWindowSize(context->window, width, height);
+  } else {
+    SDL_GetRendererOutputSize(context->renderer, width, height);
+  }
   vector_t dimensions = {.x = *width, .y = *height};
-  free(width);
-  free(height);
+  mem_free(width);
+  mem_free(height);
   return vec_multiply(0.5, dimensions);
 }
 
@@ -70,8 +144,8 @@ vector_t get_window_center(void) {
  */
 double get_scene_scale(vector_t window_center) {
   // Scale scene so it fits entirely in the window
-  double x_scale = window_center.x / max_diff.x,
-         y_scale = window_center.y / max_diff.y;
+  double x_scale = window_center.x / context->max_diff.x,
+         y_scale = window_center.y / context->max_diff.y;
   return x_scale < y_scale ? x_scale : y_scale;
 }
 
@@ -79,7 +153,7 @@ double get_scene_scale(vector_t window_center) {
 vector_t get_window_position(vector_t scene_pos, vector_t window_center) {
   // Scale scene coordinates by the scaling factor
   // and map the center of the scene to the center of the window
-  vector_t scene_center_offset = vec_subtract(scene_pos, center);
+  vector_t scene_center_offset = vec_subtract(scene_pos, context->center);
   double scale = get_scene_scale(window_center);
   vector_t pixel_center_offset = vec_multiply(scale, scene_center_offset);
   vector_t pixel = {.x = round(window_center.x + pixel_center_offset.x),
@@ -109,34 +183,128 @@ char get_keycode(SDL_Keycode key) {
   }
 }
 
+sdl_context_t *sdl_context_init(void) {
+  sdl_context_t *new_context = mem_alloc(sizeof(sdl_context_t));
+  assert(new_context != NULL);
+  *new_context = (sdl_context_t){.render_backend = RENDER_BACKEND_WINDOW,
+                                 .render_enabled = true};
+  return new_context;
+}
+
+void sdl_context_free(sdl_context_t *old_context) {
+  assert(old_context != &default_context);
+  if (old_context->overlay_font != NULL) {
+    TTF_CloseFont(old_context->overlay_font);
+  }
+  if (old_context->renderer != NULL) {
+    SDL_DestroyRenderer(old_context->renderer);
+  }
+  if (old_context->framebuffer != NULL) {
+    SDL_FreeSurface(old_context->framebuffer);
+  }
+  if (old_context->window != NULL) {
+    SDL_DestroyWindow(old_context->window);
+  }
+  if (context == old_context) {
+    context = &default_context;
+  }
+  mem_free(old_context);
+}
+
+void sdl_set_context(sdl_context_t *new_context) {
+  context = new_context != NULL ? new_context : &default_context;
+}
+
+sdl_context_t *sdl_get_context(void) { return context; }
+
+void sdl_set_backend(render_backend_t backend) {
+  context->render_backend = backend;
+}
+
+render_backend_t sdl_backend_from_env(void) {
+  char *name = getenv(BACKEND_ENV_VAR);
+  if (name == NULL) {
+    return RENDER_BACKEND_WINDOW;
+  }
+  if (strcmp(name, "software") == 0) {
+    return RENDER_BACKEND_SOFTWARE;
+  }
+  if (strcmp(name, "dummy") == 0) {
+    return RENDER_BACKEND_DUMMY;
+  }
+  if (strcmp(name, "none") == 0) {
+    return RENDER_BACKEND_NONE;
+  }
+  return RENDER_BACKEND_WINDOW;
+}
+
 void sdl_init(vector_t min, vector_t max) {
   // Check parameters
   assert(min.x < max.x);
   assert(min.y < max.y);
 
-  center = vec_multiply(0.5, vec_add(min, max));
-  max_diff = vec_subtract(max, center);
-  SDL_Init(SDL_INIT_EVERYTHING);
-  window = SDL_CreateWindow(WINDOW_TITLE, SDL_WINDOWPOS_CENTERED,
-                            SDL_WINDOWPOS_CENTERED, SDL_WINDOW_WIDTH, SDL_WINDOW_HEIGHT,
-                            SDL_WINDOW_RESIZABLE);
-  renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_PRESENTVSYNC);
+  context->center = vec_multiply(0.5, vec_add(min, max));
+  context->max_diff = vec_subtract(max, context->center);
+  switch (context->render_backend) {
+  case RENDER_BACKEND_WINDOW:
+    SDL_Init(SDL_INIT_EVERYTHING);
+    context->window = SDL_CreateWindow(WINDOW_TITLE, SDL_WINDOWPOS_CENTERED,
+                              SDL_WINDOWPOS_CENTERED, SDL_WINDOW_WIDTH, SDL_WINDOW_HEIGHT,
+                              SDL_WINDOW_RESIZABLE);
+    context->renderer = SDL_CreateRenderer(context->window, -1,
+                                           SDL_RENDERER_PRESENTVSYNC);
+    break;
+  case RENDER_BACKEND_SOFTWARE:
+    // No video subsystem: the software renderer only needs a target surface
+    SDL_Init(SDL_INIT_TIMER | SDL_INIT_EVENTS);
+    context->window = NULL;
+    context->framebuffer = SDL_CreateRGBSurfaceWithFormat(
+        0, SDL_WINDOW_WIDTH, SDL_WINDOW_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+    assert(context->framebuffer != NULL);
+    context->renderer = SDL_CreateSoftwareRenderer(context->framebuffer);
+    break;
+  case RENDER_BACKEND_DUMMY:
+    SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+    SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER | SDL_INIT_EVENTS);
+    context->window = SDL_CreateWindow(WINDOW_TITLE, SDL_WINDOWPOS_CENTERED,
+                              SDL_WINDOWPOS_CENTERED, SDL_WINDOW_WIDTH, SDL_WINDOW_HEIGHT,
+                              SDL_WINDOW_HIDDEN);
+    context->renderer = SDL_CreateRenderer(context->window, -1,
+                                           SDL_RENDERER_SOFTWARE);
+    break;
+  case RENDER_BACKEND_NONE:
+    // Touches no SDL state at all, so many instances can run in parallel
+    context->window = NULL;
+    context->renderer = NULL;
+    return;
+  }
+  assert(context->renderer != NULL);
   TTF_Init();
 }
 
+void sdl_dispatch_key(char key, key_event_type_t type, double held_time,
+                      void *state) {
+  if (context->key_handler == NULL) {
+    return;
+  }
+  replay_record_key(key, type, held_time);
+  context->key_handler(key, type, held_time, state);
+}
+
 bool sdl_is_done(state_t *state) {
-  SDL_Event *event = malloc(sizeof(*event));
+  SDL_Event *event = mem_alloc(sizeof(*event));
   assert(event != NULL);
   while (SDL_PollEvent(event)) {
     switch (event->type) {
     case SDL_QUIT:
-      free(event);
+      mem_free(event);
       return true;
     case SDL_KEYDOWN:
     case SDL_KEYUP:
       // Skip the keypress if no handler is configured
-      // or an unrecognized key was pressed
-      if (key_handler == NULL)
+      // or an unrecognized key was pressed,
+      // or if a replay is supplying the key events instead
+      if (context->key_handler == NULL || replay_is_playing())
         break;
       char key = get_keycode(event->key.keysym.sym);
       if (key == '\0')
@@ -144,22 +312,23 @@ bool sdl_is_done(state_t *state) {
 
       uint32_t timestamp = event->key.timestamp;
       if (!event->key.repeat) {
-        key_start_timestamp = timestamp;
+        context->key_start_timestamp = timestamp;
       }
       key_event_type_t type =
           event->type == SDL_KEYDOWN ? KEY_PRESSED : KEY_RELEASED;
-      double held_time = (timestamp - key_start_timestamp) / MS_PER_S;
-      key_handler(key, type, held_time, state);
+      double held_time = (timestamp - context->key_start_timestamp) / MS_PER_S;
+      sdl_dispatch_key(key, type, held_time, state);
       break;
     }
   }
-  free(event);
-  return false;
+  mem_free(event);
+  return replay_dispatch(context->key_handler, state);
 }
 
 void sdl_clear(void) {
-  SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-  SDL_RenderClear(renderer);
+  SDL_SetRenderDrawColor(context->renderer, 255, 255, 255, 255);
+  SDL_RenderClear(context->renderer);
+  context->frame_stats.draw_calls++;
 }
 
 void sdl_draw_polygon(list_t *points, rgb_color_t color) {
@@ -173,8 +342,8 @@ void sdl_draw_polygon(list_t *points, rgb_color_t color) {
   vector_t window_center = get_window_center();
 
   // Convert each vertex to a point on screen
-  int16_t *x_points = malloc(sizeof(*x_points) * n),
-          *y_points = malloc(sizeof(*y_points) * n);
+  int16_t *x_points = mem_alloc(sizeof(*x_points) * n),
+          *y_points = mem_alloc(sizeof(*y_points) * n);
   assert(x_points != NULL);
   assert(y_points != NULL);
 
@@ -186,28 +355,30 @@ void sdl_draw_polygon(list_t *points, rgb_color_t color) {
   }
 
   // Draw polygon with the given color
-  filledPolygonRGBA(renderer, x_points, y_points, n, color.r * 255,
+  filledPolygonRGBA(context->renderer, x_points, y_points, n, color.r * 255,
                     color.g * 255, color.b * 255, 255);
-  free(x_points);
-  free(y_points);
+  context->frame_stats.draw_calls++;
+  context->frame_stats.vertices_submitted += n;
+  mem_free(x_points);
+  mem_free(y_points);
 }
 
 void sdl_show(void) {
   // Draw boundary lines
   vector_t window_center = get_window_center();
-  vector_t max = vec_add(center, max_diff),
-           min = vec_subtract(center, max_diff);
+  vector_t max = vec_add(context->center, context->max_diff),
+           min = vec_subtract(context->center, context->max_diff);
   vector_t max_pixel = get_window_position(max, window_center),
            min_pixel = get_window_position(min, window_center);
-  SDL_Rect *boundary = malloc(sizeof(*boundary));
+  SDL_Rect *boundary = mem_alloc(sizeof(*boundary));
   boundary->x = min_pixel.x;
   boundary->y = max_pixel.y;
   boundary->w = max_pixel.x - min_pixel.x;
   boundary->h = min_pixel.y - max_pixel.y;
-  SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-  SDL_RenderDrawRect(renderer, boundary);
-  free(boundary);
-  SDL_RenderPresent(renderer);
+  SDL_SetRenderDrawColor(context->renderer, 0, 0, 0, 255);
+  SDL_RenderDrawRect(context->renderer, boundary);
+  mem_free(boundary);
+  SDL_RenderPresent(context->renderer);
 }
 
 vector_t convert_to_sdl_coords(vector_t coords){
@@ -218,55 +389,412 @@ vector_t scale_to_sdl_coords(vector_t size){
   return (vector_t){334 * size.x / 800, size.y * 5 / 12};
 }
 
+/**
+ * Draws a surface stretched over a rectangle of the window.
+ * Skips a missing surface, e.g. an image that is still loading.
+ */
+void draw_surface(SDL_Surface *surface, SDL_Rect *rect) {
+  if (surface == NULL) {
+    return;
+  }
+  SDL_Texture *texture =
+      SDL_CreateTextureFromSurface(context->renderer, surface);
+  SDL_RenderCopy(context->renderer, texture, NULL, rect);
+  SDL_DestroyTexture(texture);
+  context->frame_stats.texture_creates++;
+  context->frame_stats.upload_bytes += (size_t)surface->pitch * surface->h;
+  context->frame_stats.draw_calls++;
+  context->frame_stats.texture_destroys++;
+}
+
+void draw_text(text_t *text) {
+  if (text->font == NULL) {
+    return;
+  }
+  SDL_Surface *surface_message = TTF_RenderText_Solid(text->font, text->text, text->color);
+  context->frame_stats.text_rasterizations++;
+  draw_surface(surface_message, &(text->message_rect));
+  SDL_FreeSurface(surface_message);
+}
+
+/** Draws a body's sprite centered on its centroid */
+void draw_sprite(SDL_Surface *sprite, vector_t centroid, vector_t sprite_size) {
+  vector_t pos = convert_to_sdl_coords(centroid);
+  vector_t size = scale_to_sdl_coords(sprite_size);
+  SDL_Rect rect = (SDL_Rect){pos.x - size.x / 2, pos.y - size.y / 2, size.x, size.y};
+  draw_surface(sprite, &rect);
+}
+
+/** Like sdl_draw_polygon(), but for a plain array of vertices */
+void draw_polygon_vertices(vector_t *vertices, size_t n, rgb_color_t color) {
+  assert(n >= 3);
+  vector_t window_center = get_window_center();
+  int16_t *x_points = mem_alloc(sizeof(*x_points) * n),
+          *y_points = mem_alloc(sizeof(*y_points) * n);
+  assert(x_points != NULL);
+  assert(y_points != NULL);
+  for (size_t i = 0; i < n; i++) {
+    vector_t pixel = get_window_position(vertices[i], window_center);
+    x_points[i] = pixel.x;
+    y_points[i] = pixel.y;
+  }
+  filledPolygonRGBA(context->renderer, x_points, y_points, n, color.r * 255,
+                    color.g * 255, color.b * 255, 255);
+  context->frame_stats.draw_calls++;
+  context->frame_stats.vertices_submitted += n;
+  mem_free(x_points);
+  mem_free(y_points);
+}
+
+/** Draws the last frame's render stats in the top left corner */
+void draw_stats_overlay(void) {
+  if (context->overlay_font == NULL) {
+    context->overlay_font = asset_open_font(OVERLAY_FONT, OVERLAY_FONT_SIZE);
+    if (context->overlay_font == NULL) {
+      return;
+    }
+  }
+  char line[128];
+  snprintf(line, sizeof(line),
+           "draws %zu  verts %zu  tex %zu/%zu  upload %zu KB  text %zu",
+           context->last_render_stats.draw_calls,
+           context->last_render_stats.vertices_submitted,
+           context->last_render_stats.texture_creates,
+           context->last_render_stats.texture_destroys,
+           context->last_render_stats.upload_bytes / 1024,
+           context->last_render_stats.text_rasterizations);
+  SDL_Surface *surface =
+      TTF_RenderText_Solid(context->overlay_font, line, OVERLAY_COLOR);
+  if (surface == NULL) {
+    return;
+  }
+  SDL_Rect rect = {0, 0, surface->w, surface->h};
+  draw_surface(surface, &rect);
+  SDL_FreeSurface(surface);
+}
+
+/** Closes the overlay's font, if it is open */
+void close_overlay_font(void) {
+  if (context->overlay_font != NULL) {
+    TTF_CloseFont(context->overlay_font);
+    context->overlay_font = NULL;
+  }
+}
+
+/**
+ * Publishes the time and stats of the frame just drawn, then draws the
+ * overlay, whose own work is left out of the stats. Once the overlay is
+ * disabled, closes its font here, on the thread that draws with it.
+ */
+void finish_frame_stats(double render_time) {
+  bool overlay;
+  if (render_thread != NULL) {
+    SDL_LockMutex(render_lock);
+    context->last_render_time = render_time;
+    context->last_render_stats = context->frame_stats;
+    overlay = context->stats_overlay;
+    SDL_UnlockMutex(render_lock);
+  } else {
+    context->last_render_time = render_time;
+    context->last_render_stats = context->frame_stats;
+    overlay = context->stats_overlay;
+  }
+  if (overlay) {
+    draw_stats_overlay();
+  } else {
+    close_overlay_font();
+  }
+}
+
+render_stats_t sdl_get_render_stats(void) {
+  if (render_thread == NULL) {
+    return context->last_render_stats;
+  }
+  SDL_LockMutex(render_lock);
+  render_stats_t stats = context->last_render_stats;
+  SDL_UnlockMutex(render_lock);
+  return stats;
+}
+
+void sdl_set_stats_overlay(bool enabled) {
+  if (render_thread == NULL) {
+    context->stats_overlay = enabled;
+    if (!enabled) {
+      close_overlay_font();
+    }
+    return;
+  }
+  // The render thread may be drawing with the font, so it closes it itself
+  SDL_LockMutex(render_lock);
+  context->stats_overlay = enabled;
+  SDL_UnlockMutex(render_lock);
+}
+
+void sdl_render_snapshot(render_snapshot_t *snapshot) {
+  PROFILE_ZONE("render_snapshot");
+  PERF_ZONE("render");
+  uint64_t start = SDL_GetPerformanceCounter();
+  context->frame_stats = (render_stats_t){0};
+  sdl_clear();
+
+  // draw image not associated with bodies
+  PROFILE_BEGIN(images_zone, "render_images");
+  for (size_t i = 0; i < render_snapshot_images(snapshot); i++) {
+    image_t *image = render_snapshot_get_image(snapshot, i);
+    draw_surface(image->image, &(image->rect));
+  }
+  PROFILE_END(images_zone);
+
+  // draw texts
+  PROFILE_BEGIN(texts_zone, "render_texts");
+  for (size_t i = 0; i < render_snapshot_texts(snapshot); i++) {
+    draw_text(render_snapshot_get_text(snapshot, i));
+  }
+  PROFILE_END(texts_zone);
+
+  // draw bodies, back to front like sdl_render_scene()
+  PROFILE_BEGIN(bodies_zone, "render_bodies");
+  vector_t *vertices = render_snapshot_get_vertices(snapshot);
+  for (size_t i = render_snapshot_items(snapshot); i > 0; i--) {
+    render_item_t *item = render_snapshot_get_item(snapshot, i - 1);
+    if (item->sprite == NULL) {
+      draw_polygon_vertices(&vertices[item->first_vertex], item->num_vertices,
+                            item->color);
+    } else {
+      draw_sprite(item->sprite, item->centroid, item->sprite_size);
+    }
+  }
+  PROFILE_END(bodies_zone);
+  finish_frame_stats((double)(SDL_GetPerformanceCounter() - start) /
+                     SDL_GetPerformanceFrequency());
+}
+
+/** Publishes a snapshot of the frame for the render thread to draw */
+void publish_snapshot(scene_t *scene, list_t *texts, list_t *images) {
+  PROFILE_ZONE("publish_snapshot");
+  render_snapshot_capture(back_snapshot, scene, texts, images);
+  SDL_LockMutex(render_lock);
+  render_snapshot_t *published = back_snapshot;
+  back_snapshot = ready_snapshot;
+  ready_snapshot = published;
+  snapshot_pending = true;
+  SDL_CondSignal(render_cond);
+  SDL_UnlockMutex(render_lock);
+}
+
+int render_thread_main(void *aux) {
+  // Draw with the renderer of the context that started the thread
+  sdl_set_context(aux);
+  while (true) {
+    SDL_LockMutex(render_lock);
+    while (!snapshot_pending && render_thread_running) {
+      SDL_CondWait(render_cond, render_lock);
+    }
+    if (!render_thread_running) {
+      SDL_UnlockMutex(render_lock);
+      return 0;
+    }
+    render_snapshot_t *latest = ready_snapshot;
+    ready_snapshot = front_snapshot;
+    front_snapshot = latest;
+    snapshot_pending = false;
+    SDL_UnlockMutex(render_lock);
+
+    sdl_render_snapshot(front_snapshot);
+    SDL_RenderPresent(context->renderer);
+  }
+}
+
+bool sdl_start_render_thread(void) {
+  if (render_thread != NULL) {
+    return true;
+  }
+  // A window's renderer may only be used on the thread that created it on
+  // some platforms; software renderers are not tied to a thread
+  if (context->render_backend != RENDER_BACKEND_SOFTWARE &&
+      context->render_backend != RENDER_BACKEND_DUMMY) {
+    return false;
+  }
+  render_lock = SDL_CreateMutex();
+  render_cond = SDL_CreateCond();
+  back_snapshot = render_snapshot_init();
+  ready_snapshot = render_snapshot_init();
+  front_snapshot = render_snapshot_init();
+  snapshot_pending = false;
+  render_thread_running = true;
+  render_thread = SDL_CreateThread(render_thread_main, "render", context);
+  if (render_thread == NULL) {
+    // e.g. emscripten builds without pthreads; keep rendering inline
+    render_thread_running = false;
+    sdl_stop_render_thread();
+    return false;
+  }
+  return true;
+}
+
+void sdl_stop_render_thread(void) {
+  if (render_thread != NULL) {
+    SDL_LockMutex(render_lock);
+    render_thread_running = false;
+    SDL_CondSignal(render_cond);
+    SDL_UnlockMutex(render_lock);
+    SDL_WaitThread(render_thread, NULL);
+    render_thread = NULL;
+    // The overlay may have been disabled after the thread's last frame
+    if (!context->stats_overlay) {
+      close_overlay_font();
+    }
+  }
+  if (render_lock != NULL) {
+    render_snapshot_free(back_snapshot);
+    render_snapshot_free(ready_snapshot);
+    render_snapshot_free(front_snapshot);
+    SDL_DestroyCond(render_cond);
+    SDL_DestroyMutex(render_lock);
+    render_lock = NULL;
+  }
+}
+
 void sdl_render_scene(scene_t *scene, list_t *texts, list_t *images) {
+  if (!context->render_enabled || context->renderer == NULL) {
+    return;
+  }
+  if (render_thread != NULL) {
+    publish_snapshot(scene, texts, images);
+    return;
+  }
+
+  PROFILE_ZONE("render_scene");
+  PERF_ZONE("render");
+  uint64_t start = SDL_GetPerformanceCounter();
+  context->frame_stats = (render_stats_t){0};
   sdl_clear();
   
   // draw image not associated with bodies
+  PROFILE_BEGIN(images_zone, "render_images");
   for(size_t i = 0; i < list_size(images); i++){
-    image_t image = *(image_t *)list_get(images, i);
-    SDL_Surface *surface = image.image;
-    SDL_Texture *texture = SDL_CreateTextureFromSurface(renderer, surface);
-    SDL_RenderCopy(renderer, texture, NULL, &(image.rect));
-    SDL_DestroyTexture(texture);
+    image_t *image = list_get(images, i);
+    draw_surface(image->image, &(image->rect));
   }
+  PROFILE_END(images_zone);
 
   // draw texts
+  PROFILE_BEGIN(texts_zone, "render_texts");
   for (size_t i = 0; i < list_size(texts); i++) {
-    text_t *text = (text_t *)list_get(texts, i);
-    SDL_Surface *surface_message = TTF_RenderText_Solid(text->font, text->text, text->color); 
-    SDL_Texture *message = SDL_CreateTextureFromSurface(renderer, surface_message);
-    SDL_RenderCopy(renderer, message, NULL, &(text->message_rect));
-    SDL_FreeSurface(surface_message);
-    SDL_DestroyTexture(message);
+    draw_text(list_get(texts, i));
   }  
+  PROFILE_END(texts_zone);
 
   // draw bodies
+  PROFILE_BEGIN(bodies_zone, "render_bodies");
   size_t body_count = scene_bodies(scene);
   for (size_t i = body_count; i > 0; i--) {
     body_t *body = scene_get_body(scene, i - 1);
-    list_t *shape = body_get_shape(body);
     image_t *image = body_get_image(body);
     if (image == NULL){
+      list_t *shape = body_get_shape(body);
       sdl_draw_polygon(shape, body_get_color(body));
+      list_free(shape);
     } else {
-      SDL_Texture *texture = SDL_CreateTextureFromSurface(renderer, image->image);
-      vector_t pos = convert_to_sdl_coords(body_get_centroid(body));
-      vector_t size = scale_to_sdl_coords((vector_t){image->rect.w, image->rect.h});  
-      SDL_Rect rect = (SDL_Rect){pos.x - size.x / 2, pos.y - size.y / 2, size.x, size.y};
-      SDL_RenderCopy(renderer, texture, NULL, &(rect));
-      SDL_DestroyTexture(texture);
+      draw_sprite(image->image, body_get_centroid(body),
+                  (vector_t){image->rect.w, image->rect.h});
+    }
+  }
+  PROFILE_END(bodies_zone);
+  finish_frame_stats((double)(SDL_GetPerformanceCounter() - start) /
+                     SDL_GetPerformanceFrequency());
+}
+
+double sdl_get_render_time(void) {
+  if (render_thread == NULL) {
+    return context->last_render_time;
+  }
+  SDL_LockMutex(render_lock);
+  double render_time = context->last_render_time;
+  SDL_UnlockMutex(render_lock);
+  return render_time;
+}
+
+SDL_Surface *sdl_read_frame(void) {
+  int width, height;
+  if (SDL_GetRendererOutputSize(context->renderer, &width, &height) != 0) {
+    return NULL;
+  }
+  SDL_Surface *frame = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32,
+                                                      SDL_PIXELFORMAT_ARGB8888);
+  if (frame == NULL) {
+    return NULL;
+  }
+  if (SDL_RenderReadPixels(context->renderer, NULL, SDL_PIXELFORMAT_ARGB8888,
+                           frame->pixels, frame->pitch) != 0) {
+    SDL_FreeSurface(frame);
+    return NULL;
+  }
+  return frame;
+}
+
+bool sdl_save_frame(const char *path) {
+  SDL_Surface *frame = sdl_read_frame();
+  if (frame == NULL) {
+    return false;
+  }
+  bool saved = SDL_SaveBMP(frame, path) == 0;
+  SDL_FreeSurface(frame);
+  return saved;
+}
+
+size_t sdl_compare_frame(const char *golden_path, uint8_t tolerance) {
+  SDL_Surface *loaded = SDL_LoadBMP(golden_path);
+  if (loaded == NULL) {
+    return SIZE_MAX;
+  }
+  SDL_Surface *golden =
+      SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_ARGB8888, 0);
+  SDL_FreeSurface(loaded);
+  SDL_Surface *frame = sdl_read_frame();
+  if (golden == NULL || frame == NULL || golden->w != frame->w ||
+      golden->h != frame->h) {
+    SDL_FreeSurface(golden);
+    SDL_FreeSurface(frame);
+    return SIZE_MAX;
+  }
+
+  size_t differing = 0;
+  for (int y = 0; y < frame->h; y++) {
+    uint8_t *frame_row = (uint8_t *)frame->pixels + y * frame->pitch;
+    uint8_t *golden_row = (uint8_t *)golden->pixels + y * golden->pitch;
+    for (int x = 0; x < frame->w; x++) {
+      // Compare the color channels, ignoring alpha
+      for (int c = 0; c < 3; c++) {
+        int diff = frame_row[4 * x + c] - golden_row[4 * x + c];
+        if (abs(diff) > tolerance) {
+          differing++;
+          break;
+        }
+      }
     }
-    list_free(shape);
   }
+  SDL_FreeSurface(golden);
+  SDL_FreeSurface(frame);
+  return differing;
 }
 
-void sdl_on_key(key_handler_t handler) { key_handler = handler; }
+void sdl_on_key(key_handler_t handler) { context->key_handler = handler; }
+
+void sdl_set_fixed_dt(double dt) { context->fixed_dt = dt; }
+
+void sdl_set_render_enabled(bool enabled) {
+  context->render_enabled = enabled;
+}
 
 double time_since_last_tick(void) {
+  if (context->fixed_dt > 0) {
+    return context->fixed_dt;
+  }
   clock_t now = clock();
-  double difference = last_clock
-                          ? (double)(now - last_clock) / CLOCKS_PER_SEC
+  double difference = context->last_clock
+                          ? (double)(now - context->last_clock) / CLOCKS_PER_SEC
                           : 0.0; // return 0 the first time this is called
-  last_clock = now;
+  context->last_clock = now;
   return difference;
 }
@@ -0,0 +1,157 @@
+#include "spatial_hash.h"
+#include "mem.h"
+#include <assert.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Multipliers that spread neighbouring cells over the buckets
+const uint64_t SPATIAL_HASH_X_PRIME = 0x9e3779b97f4a7c15ULL;
+const uint64_t SPATIAL_HASH_Y_PRIME = 0xc2b2ae3d27d4eb4fULL;
+
+/** A point and the cell it is in */
+typedef struct spatial_entry {
+  int64_t cell_x;
+  int64_t cell_y;
+  vector_t point;
+  size_t index;
+} spatial_entry_t;
+
+typedef struct spatial_hash {
+  double cell_size;
+  size_t count;
+  size_t capacity;
+  // The entries, grouped by bucket
+  spatial_entry_t *entries;
+  // The unsorted entries, while building
+  spatial_entry_t *scratch;
+  // A power of 2; bucket b's entries are bucket_start[b] to bucket_start[b + 1]
+  size_t num_buckets;
+  size_t *bucket_start;
+} spatial_hash_t;
+
+spatial_hash_t *spatial_hash_init(void) {
+  spatial_hash_t *hash = mem_alloc(sizeof(spatial_hash_t));
+  assert(hash);
+  *hash = (spatial_hash_t){.cell_size = 1};
+  return hash;
+}
+
+void spatial_hash_free(spatial_hash_t *hash) {
+  mem_free(hash->entries);
+  mem_free(hash->scratch);
+  mem_free(hash->bucket_start);
+  mem_free(hash);
+}
+
+int64_t spatial_hash_cell(double coordinate, double cell_size) {
+  return (int64_t)floor(coordinate / cell_size);
+}
+
+size_t spatial_hash_bucket(spatial_hash_t *hash, int64_t cell_x,
+                           int64_t cell_y) {
+  uint64_t mixed = (uint64_t)cell_x * SPATIAL_HASH_X_PRIME ^
+                   (uint64_t)cell_y * SPATIAL_HASH_Y_PRIME;
+  mixed ^= mixed >> 32;
+  return mixed & (hash->num_buckets - 1);
+}
+
+/** Grows the arrays to hold count points, with about a bucket per point */
+void spatial_hash_reserve(spatial_hash_t *hash, size_t count) {
+  if (count <= hash->capacity && hash->num_buckets > 0) {
+    return;
+  }
+  size_t capacity = hash->capacity > 0 ? hash->capacity : 16;
+  while (capacity < count) {
+    capacity *= 2;
+  }
+  hash->entries =
+      mem_realloc(hash->entries, capacity * sizeof(spatial_entry_t));
+  hash->scratch =
+      mem_realloc(hash->scratch, capacity * sizeof(spatial_entry_t));
+  hash->bucket_start =
+      mem_realloc(hash->bucket_start, (capacity + 1) * sizeof(size_t));
+  assert(hash->entries && hash->scratch && hash->bucket_start);
+  hash->capacity = capacity;
+  hash->num_buckets = capacity;
+}
+
+void spatial_hash_build(spatial_hash_t *hash, const vector_t *points,
+                        size_t count, double cell_size) {
+  assert(cell_size > 0);
+  spatial_hash_reserve(hash, count);
+  hash->cell_size = cell_size;
+  hash->count = count;
+  size_t *start = hash->bucket_start;
+  for (size_t b = 0; b <= hash->num_buckets; b++) {
+    start[b] = 0;
+  }
+  for (size_t i = 0; i < count; i++) {
+    spatial_entry_t entry = {
+        .cell_x = spatial_hash_cell(points[i].x, cell_size),
+        .cell_y = spatial_hash_cell(points[i].y, cell_size),
+        .point = points[i],
+        .index = i,
+    };
+    hash->scratch[i] = entry;
+    start[spatial_hash_bucket(hash, entry.cell_x, entry.cell_y) + 1]++;
+  }
+  for (size_t b = 0; b < hash->num_buckets; b++) {
+    start[b + 1] += start[b];
+  }
+  // Counting sort, using each bucket's start as a cursor
+  for (size_t i = 0; i < count; i++) {
+    spatial_entry_t *entry = &hash->scratch[i];
+    hash->entries[start[spatial_hash_bucket(hash, entry->cell_x,
+                                            entry->cell_y)]++] = *entry;
+  }
+  // Each cursor ended at the next bucket's start
+  for (size_t b = hash->num_buckets; b > 0; b--) {
+    start[b] = start[b - 1];
+  }
+  start[0] = 0;
+}
+
+/** Visits the entry if it is within the radius; returns whether it was */
+bool spatial_hash_visit(spatial_entry_t *entry, vector_t center,
+                        double radius, spatial_hash_visitor_t visitor,
+                        void *aux) {
+  vector_t offset = vec_subtract(entry->point, center);
+  if (vec_dot(offset, offset) > radius * radius) {
+    return false;
+  }
+  visitor(entry->index, aux);
+  return true;
+}
+
+size_t spatial_hash_query(spatial_hash_t *hash, vector_t center, double radius,
+                          spatial_hash_visitor_t visitor, void *aux) {
+  size_t visited = 0;
+  int64_t min_x = spatial_hash_cell(center.x - radius, hash->cell_size);
+  int64_t max_x = spatial_hash_cell(center.x + radius, hash->cell_size);
+  int64_t min_y = spatial_hash_cell(center.y - radius, hash->cell_size);
+  int64_t max_y = spatial_hash_cell(center.y + radius, hash->cell_size);
+  double cells = (double)(max_x - min_x + 1) * (max_y - min_y + 1);
+  // A query covering more cells than there are points just checks them all
+  if (cells > hash->count) {
+    for (size_t i = 0; i < hash->count; i++) {
+      visited += spatial_hash_visit(&hash->entries[i], center, radius, visitor,
+                                    aux);
+    }
+    return visited;
+  }
+  for (int64_t x = min_x; x <= max_x; x++) {
+    for (int64_t y = min_y; y <= max_y; y++) {
+      size_t bucket = spatial_hash_bucket(hash, x, y);
+      for (size_t i = hash->bucket_start[bucket];
+           i < hash->bucket_start[bucket + 1]; i++) {
+        spatial_entry_t *entry = &hash->entries[i];
+        // Other cells share the bucket; they are visited with their own cell
+        if (entry->cell_x == x && entry->cell_y == y) {
+          visited += spatial_hash_visit(entry, center, radius, visitor, aux);
+        }
+      }
+    }
+  }
+  return visited;
+}
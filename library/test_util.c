@@ -1,4 +1,5 @@
 #include "test_util.h"
+#include "mem.h"
 #include <assert.h>
 #include <math.h>
 #include <signal.h>
@@ -35,6 +36,21 @@ bool vec_isclose(vector_t v1, vector_t v2) {
   return isclose(v1.x, v2.x) && isclose(v1.y, v2.y);
 }
 
+list_t *make_box(vector_t center, double half_width, double half_height) {
+  list_t *shape = list_init(4, mem_free);
+  vector_t corners[] = {{-half_width, -half_height},
+                        {half_width, -half_height},
+                        {half_width, half_height},
+                        {-half_width, half_height}};
+  for (size_t i = 0; i < 4; i++) {
+    vector_t *vertex = mem_alloc(sizeof(vector_t));
+    assert(vertex);
+    *vertex = vec_add(center, corners[i]);
+    list_add(shape, vertex);
+  }
+  return shape;
+}
+
 void read_testname(char *filename, char *testname, size_t testname_size) {
   FILE *f = fopen(filename, "r");
   if (f == NULL) {
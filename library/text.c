@@ -1,7 +1,8 @@
 #include "text.h"
+#include "mem.h"
 
 void text_free(void *text) {
     text_t *txt = (text_t *)text;
-    free(txt->text);
-    free(text);
+    mem_free(txt->text);
+    mem_free(text);
 }
\ No newline at end of file
@@ -0,0 +1,98 @@
+#include "collision.h"
+#include "test_util.h"
+#include <assert.h>
+#include <math.h>
+
+void test_find_impact_landing() {
+  // A box whose bottom starts 9 above a floor and falls 10
+  list_t *box = make_box((vector_t){0, 10}, 1, 1);
+  list_t *floor = make_box((vector_t){0, -10}, 100, 10);
+  impact_info_t impact =
+      find_impact(box, (vector_t){0, -10}, floor, VEC_ZERO);
+  assert(impact.collided);
+  assert(isclose(impact.time, 0.9));
+  assert(vec_isclose(impact.axis, (vector_t){0, -1}));
+  list_free(box);
+  list_free(floor);
+}
+
+void test_find_impact_normal_orientation() {
+  list_t *left = make_box(VEC_ZERO, 1, 1);
+  list_t *right = make_box((vector_t){10, 0}, 1, 1);
+  // The normal points from the first shape towards the second either way
+  impact_info_t impact =
+      find_impact(left, (vector_t){4, 0}, right, (vector_t){-4, 0});
+  assert(impact.collided);
+  assert(isclose(impact.time, 1));
+  assert(vec_isclose(impact.axis, (vector_t){1, 0}));
+  impact = find_impact(right, (vector_t){-4, 0}, left, (vector_t){4, 0});
+  assert(impact.collided);
+  assert(isclose(impact.time, 1));
+  assert(vec_isclose(impact.axis, (vector_t){-1, 0}));
+  // Only the relative motion matters, not which shape moves
+  impact = find_impact(right, VEC_ZERO, left, (vector_t){16, 0});
+  assert(impact.collided);
+  assert(isclose(impact.time, 0.5));
+  assert(vec_isclose(impact.axis, (vector_t){-1, 0}));
+  list_free(left);
+  list_free(right);
+}
+
+void test_find_impact_overlapping() {
+  list_t *box1 = make_box(VEC_ZERO, 2, 2);
+  list_t *box2 = make_box((vector_t){3, 0}, 2, 2);
+  impact_info_t impact = find_impact(box1, VEC_ZERO, box2, VEC_ZERO);
+  assert(impact.collided);
+  assert(impact.time == 0);
+  assert(vec_isclose(impact.axis, (vector_t){1, 0}));
+  list_free(box1);
+  list_free(box2);
+}
+
+void test_find_impact_tunneling() {
+  // A bullet that starts and ends the step on opposite sides of a thin wall
+  list_t *bullet = make_box((vector_t){-10, 0}, 1, 1);
+  list_t *wall = make_box(VEC_ZERO, 0.5, 10);
+  impact_info_t impact =
+      find_impact(bullet, (vector_t){20, 0}, wall, VEC_ZERO);
+  assert(impact.collided);
+  assert(isclose(impact.time, 0.425));
+  assert(vec_isclose(impact.axis, (vector_t){1, 0}));
+  // Where the step ends, they don't overlap
+  list_t *moved = make_box((vector_t){10, 0}, 1, 1);
+  assert(!find_collision(moved, wall).collided);
+  list_free(bullet);
+  list_free(wall);
+  list_free(moved);
+}
+
+void test_find_impact_miss() {
+  list_t *box1 = make_box(VEC_ZERO, 1, 1);
+  list_t *box2 = make_box((vector_t){10, 5}, 1, 1);
+  // Passes below the other box
+  assert(!find_impact(box1, (vector_t){20, 0}, box2, VEC_ZERO).collided);
+  // Moving apart
+  assert(!find_impact(box1, (vector_t){-5, 0}, box2, VEC_ZERO).collided);
+  // Stops short
+  assert(!find_impact(box1, (vector_t){7.9, 5}, box2, VEC_ZERO).collided);
+  list_free(box1);
+  list_free(box2);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_find_impact_landing)
+  DO_TEST(test_find_impact_normal_orientation)
+  DO_TEST(test_find_impact_overlapping)
+  DO_TEST(test_find_impact_tunneling)
+  DO_TEST(test_find_impact_miss)
+
+  puts("collision_test PASS");
+}
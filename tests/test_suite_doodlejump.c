@@ -0,0 +1,96 @@
+#include "env.h"
+#include "sdl_wrapper.h"
+#include "test_util.h"
+#include <assert.h>
+#include <math.h>
+
+const size_t SUBSTEP_TEST_STEPS = 1000;
+// How far sideways the player may be from a platform before steering to it
+const float STEER_SLACK = 15;
+
+/**
+ * Steers towards the nearest platform above while rising and below while
+ * falling, so games climb far enough to meet monsters. The player's
+ * collisions with monsters are not swept, so falling onto one splits ticks
+ * into substeps.
+ */
+env_action_t climb(float *observation) {
+  float velocity_y = observation[3];
+  float *target = NULL;
+  float best = INFINITY;
+  for (size_t i = 0; i < ENV_NEAREST; i++) {
+    float *platform = &observation[4 + 3 * i];
+    bool reachable = velocity_y > 0 ? platform[1] > 60 && platform[1] < 600
+                                    : platform[1] < -20;
+    float distance = fabsf(platform[1]) + 0.3f * fabsf(platform[0]);
+    if (platform[2] != 0 && reachable && distance < best) {
+      best = distance;
+      target = platform;
+    }
+  }
+  if (target == NULL) {
+    return ENV_ACTION_NONE;
+  }
+  if (target[0] > STEER_SLACK) {
+    return ENV_ACTION_RIGHT;
+  }
+  if (target[0] < -STEER_SLACK) {
+    return ENV_ACTION_LEFT;
+  }
+  return ENV_ACTION_NONE;
+}
+
+/**
+ * Plays the same games split into at most 1 and at most 4 substeps per
+ * tick. The force creators, handlers and removal sweep run every substep,
+ * so applying any of them twice would change the games.
+ */
+void check_substeps_match(uint64_t seed) {
+  state_t *envs[2];
+  float observations[2][ENV_OBSERVATION_SIZE];
+  for (size_t i = 0; i < 2; i++) {
+    envs[i] = env_init(seed);
+    env_set_max_substeps(envs[i], i == 0 ? 1 : 4);
+    env_reset(envs[i], observations[i]);
+  }
+  size_t games = 0;
+  for (size_t step = 0; step < SUBSTEP_TEST_STEPS; step++) {
+    env_result_t results[2];
+    for (size_t i = 0; i < 2; i++) {
+      results[i] = env_step(envs[i], climb(observations[i]), observations[i]);
+      if (results[i].done) {
+        env_reset(envs[i], observations[i]);
+      }
+    }
+    assert(results[0].done == results[1].done);
+    assert(within(1e-3, results[0].reward, results[1].reward));
+    assert(vec_within(1e-3,
+                      (vector_t){observations[0][0], observations[0][1]},
+                      (vector_t){observations[1][0], observations[1][1]}));
+    games += results[0].done;
+  }
+  // Several games ended
+  assert(games > 1);
+  env_free(envs[0]);
+  env_free(envs[1]);
+}
+
+void test_substeps_match() {
+  check_substeps_match(0);
+  check_substeps_match(5);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  sdl_set_backend(RENDER_BACKEND_NONE);
+  DO_TEST(test_substeps_match)
+
+  puts("doodlejump_test PASS");
+}
@@ -0,0 +1,342 @@
+#include "forces.h"
+#include "mem.h"
+#include "scene.h"
+#include "test_util.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+const rgb_color_t TEST_COLOR = {0, 0, 0};
+
+/**
+ * Runs two boxes into each other head on, registering the contact with
+ * the bodies in either order, and checks they bounce back at full speed.
+ */
+void check_boxes_bounce(bool swap) {
+  scene_t *scene = scene_init();
+  body_t *left = body_init(make_box((vector_t){-20, 0}, 10, 10), 1, TEST_COLOR);
+  body_t *right = body_init(make_box((vector_t){20, 0}, 10, 10), 1, TEST_COLOR);
+  body_set_velocity(left, (vector_t){50, 0});
+  body_set_velocity(right, (vector_t){-50, 0});
+  scene_add_body(scene, left);
+  scene_add_body(scene, right);
+  if (swap) {
+    create_physics_collision(scene, 1, right, left);
+  } else {
+    create_physics_collision(scene, 1, left, right);
+  }
+  for (size_t i = 0; i < 100; i++) {
+    scene_tick(scene, 0.01);
+  }
+  assert(within(1e-6, body_get_velocity(left).x, -50));
+  assert(within(1e-6, body_get_velocity(right).x, 50));
+  assert(body_get_centroid(left).x < -10);
+  assert(body_get_centroid(right).x > 10);
+  scene_free(scene);
+}
+
+void test_contact_boxes_bounce() {
+  check_boxes_bounce(false);
+  check_boxes_bounce(true);
+}
+
+void count_collision(body_t *body1, body_t *body2, vector_t axis, void *aux) {
+  (*(size_t *)aux)++;
+}
+
+void test_collision_stats_cull() {
+  scene_t *scene = scene_init();
+  // Two immovable boxes in contact: nothing for the solver to do
+  body_t *wall1 = body_init(make_box(VEC_ZERO, 10, 10), INFINITY, TEST_COLOR);
+  body_t *wall2 =
+      body_init(make_box((vector_t){5, 0}, 10, 10), INFINITY, TEST_COLOR);
+  // Two overlapping boxes with a handler, one of them removed
+  body_t *box1 = body_init(make_box((vector_t){100, 0}, 10, 10), 1, TEST_COLOR);
+  body_t *box2 = body_init(make_box((vector_t){105, 0}, 10, 10), 1, TEST_COLOR);
+  scene_add_body(scene, wall1);
+  scene_add_body(scene, wall2);
+  scene_add_body(scene, box1);
+  scene_add_body(scene, box2);
+  create_physics_collision(scene, 1, wall1, wall2);
+  size_t collisions = 0;
+  create_collision(scene, box1, box2, count_collision, &collisions, NULL);
+
+  scene_tick(scene, 0.01);
+  collision_stats_t stats = scene_get_collision_stats(scene);
+  assert(stats.pairs_registered == 2);
+  assert(stats.pairs_culled == 1);
+  assert(stats.pairs_tested == 1);
+  assert(collisions == 1);
+
+  body_remove(box2);
+  scene_tick(scene, 0.01);
+  stats = scene_get_collision_stats(scene);
+  assert(stats.pairs_registered == 2);
+  assert(stats.pairs_culled == 2);
+  assert(stats.pairs_tested == 0);
+  assert(collisions == 1);
+  scene_free(scene);
+}
+
+void *copy_test_info(void *info) {
+  size_t *copy = mem_alloc(sizeof(size_t));
+  assert(copy);
+  *copy = *(size_t *)info;
+  return copy;
+}
+
+body_t *make_info_box(vector_t center, size_t info) {
+  size_t *id = mem_alloc(sizeof(size_t));
+  assert(id);
+  *id = info;
+  body_t *body = body_init_with_info(make_box(center, 5, 5), 1, TEST_COLOR, id,
+                                     mem_free, NULL);
+  body_set_info_copier(body, copy_test_info);
+  return body;
+}
+
+/** A scene of two boxes on a spring, falling onto a floor */
+scene_t *make_snapshot_scene() {
+  scene_t *scene = scene_init();
+  body_t *floor = body_init(make_box((vector_t){0, -10}, 100, 10), INFINITY,
+                            TEST_COLOR);
+  body_t *body1 = make_info_box((vector_t){-10, 20}, 1);
+  body_t *body2 = make_info_box((vector_t){10, 30}, 2);
+  scene_add_body(scene, floor);
+  scene_add_body(scene, body1);
+  scene_add_body(scene, body2);
+  scene_set_field(scene, 0, (scene_field_t){.acceleration = {0, -100}});
+  list_t *spring = list_init(2, NULL);
+  list_add(spring, body1);
+  list_add(spring, body2);
+  create_spring(scene, 50, spring);
+  create_physics_collision(scene, 0.5, floor, body1);
+  create_physics_collision(scene, 0.5, floor, body2);
+  return scene;
+}
+
+void test_snapshot_round_trip() {
+  const size_t ticks = 50;
+  scene_t *scene = make_snapshot_scene();
+  scene_snapshot_t *snapshot = scene_snapshot(scene);
+  for (size_t i = 0; i < ticks; i++) {
+    scene_tick(scene, 0.01);
+  }
+  vector_t expected[3];
+  for (size_t i = 0; i < 3; i++) {
+    expected[i] = body_get_centroid(scene_get_body(scene, i));
+  }
+  // Owned infos are copied, so changing the scene's leaves the snapshot's
+  *(size_t *)body_get_info(scene_get_body(scene, 1)) = 10;
+
+  // Every restore replays the same ticks
+  for (size_t restore = 0; restore < 2; restore++) {
+    scene_restore(scene, snapshot);
+    assert(scene_bodies(scene) == 3);
+    assert(vec_isclose(body_get_centroid(scene_get_body(scene, 1)),
+                       (vector_t){-10, 20}));
+    assert(*(size_t *)body_get_info(scene_get_body(scene, 1)) == 1);
+    assert(*(size_t *)body_get_info(scene_get_body(scene, 2)) == 2);
+    for (size_t i = 0; i < ticks; i++) {
+      scene_tick(scene, 0.01);
+    }
+    for (size_t i = 0; i < 3; i++) {
+      assert(vec_isclose(body_get_centroid(scene_get_body(scene, i)),
+                         expected[i]));
+    }
+  }
+  scene_snapshot_free(snapshot);
+  scene_free(scene);
+}
+
+void snapshot_owned_aux(void *aux) {
+  scene_t *scene = aux;
+  body_t *body = body_init(make_box(VEC_ZERO, 5, 5), 1, TEST_COLOR);
+  scene_add_body(scene, body);
+  list_t *bodies = list_init(1, NULL);
+  list_add(bodies, body);
+  // Owned, but with no copier
+  scene_add_bodies_force_creator(scene, NULL, NULL, mem_alloc(sizeof(double)),
+                                 bodies, mem_free);
+  scene_snapshot(scene);
+}
+
+void test_snapshot_needs_copier() {
+  scene_t *scene = scene_init();
+  assert(test_assert_fail(snapshot_owned_aux, scene));
+  scene_free(scene);
+}
+
+/** A unit mass on a spring of constant 100 to a fixed anchor, at rest 10 out */
+scene_t *make_oscillator_scene(integrator_t integrator) {
+  scene_t *scene = scene_init();
+  scene_set_integrator(scene, integrator);
+  body_t *anchor = body_init(make_box(VEC_ZERO, 1, 1), INFINITY, TEST_COLOR);
+  body_t *mass =
+      body_init(make_box((vector_t){10, 0}, 1, 1), 1, TEST_COLOR);
+  scene_add_body(scene, anchor);
+  scene_add_body(scene, mass);
+  list_t *spring = list_init(2, NULL);
+  list_add(spring, anchor);
+  list_add(spring, mass);
+  create_spring(scene, 100, spring);
+  return scene;
+}
+
+double oscillator_energy(scene_t *scene) {
+  body_t *mass = scene_get_body(scene, 1);
+  double x = body_get_centroid(mass).x;
+  double v = body_get_velocity(mass).x;
+  return 0.5 * v * v + 0.5 * 100 * x * x;
+}
+
+/** Runs about 16 periods and returns the largest relative energy error */
+double oscillator_energy_drift(integrator_t integrator) {
+  scene_t *scene = make_oscillator_scene(integrator);
+  double initial = oscillator_energy(scene);
+  double drift = 0;
+  for (size_t i = 0; i < 1000; i++) {
+    scene_tick(scene, 0.01);
+    drift = fmax(drift, fabs(oscillator_energy(scene) - initial) / initial);
+  }
+  scene_free(scene);
+  return drift;
+}
+
+void test_integrator_energy_drift() {
+  assert(oscillator_energy_drift(INTEGRATOR_VELOCITY_VERLET) < 0.01);
+  assert(oscillator_energy_drift(INTEGRATOR_RK4) < 1e-4);
+  // The first-order integrators don't conserve it
+  assert(oscillator_energy_drift(INTEGRATOR_AVERAGED_EULER) > 0.1);
+}
+
+void count_calls(void *aux, list_t *bodies) { (*(size_t *)aux)++; }
+
+void test_integrator_stages_rerun_pure_creators() {
+  scene_t *scene = make_oscillator_scene(INTEGRATOR_RK4);
+  size_t calls = 0;
+  list_t *bodies = list_init(1, NULL);
+  list_add(bodies, scene_get_body(scene, 1));
+  scene_add_named_bodies_force_creator(scene, "count_calls", count_calls, NULL,
+                                       &calls, bodies, NULL, NULL);
+  for (size_t i = 0; i < 10; i++) {
+    scene_tick(scene, 0.01);
+  }
+  // The stages rerun only the spring, and their calls are not counted
+  assert(calls == 10);
+  callback_stats_t stats;
+  assert(scene_find_callback_stats(scene, "spring", &stats));
+  assert(stats.invocations == 10);
+  assert(scene_find_callback_stats(scene, "count_calls", &stats));
+  assert(stats.invocations == 10);
+  scene_free(scene);
+}
+
+/** The bodies a radial field's handler was last called with */
+typedef struct radial_kill_record {
+  size_t kills;
+  body_t *body;
+  body_t *source;
+} radial_kill_record_t;
+
+void record_radial_kill(body_t *body1, body_t *body2, vector_t axis,
+                        void *aux) {
+  radial_kill_record_t *record = aux;
+  record->kills++;
+  record->body = body1;
+  record->source = body2;
+}
+
+void test_radial_field() {
+  scene_t *scene = scene_init();
+  body_t *source = body_init(make_box(VEC_ZERO, 5, 5), 1, TEST_COLOR);
+  // Halfway to the edge, and close enough to be killed
+  body_t *pulled =
+      body_init(make_box((vector_t){50, 0}, 1, 1), 1, TEST_COLOR);
+  body_t *killed =
+      body_init(make_box((vector_t){0, -10}, 1, 1), 1, TEST_COLOR);
+  // In a layer the field ignores, out of its radius, and immovable
+  body_t *masked =
+      body_init(make_box((vector_t){-50, 0}, 1, 1), 1, TEST_COLOR);
+  body_set_layer(masked, 1);
+  body_t *far = body_init(make_box((vector_t){0, 150}, 1, 1), 1, TEST_COLOR);
+  body_t *wall =
+      body_init(make_box((vector_t){0, 50}, 1, 1), INFINITY, TEST_COLOR);
+  body_t *bodies[] = {source, pulled, killed, masked, far, wall};
+  for (size_t i = 0; i < 6; i++) {
+    scene_add_body(scene, bodies[i]);
+  }
+  radial_field_t field = {.radius = 100,
+                          .strength = 1000,
+                          .falloff = 1,
+                          .kill_radius = 20,
+                          .layers = 1 << 0};
+  radial_kill_record_t record = {0};
+  scene_add_radial_field(scene, source, field, record_radial_kill, &record,
+                         NULL, NULL);
+
+  scene_tick(scene, 0.01);
+  // Pulled towards the source, by half the strength halfway out
+  assert(vec_isclose(body_get_velocity(pulled), (vector_t){-5, 0}));
+  assert(body_get_velocity(killed).x == 0 && body_get_velocity(killed).y > 0);
+  for (size_t i = 3; i < 6; i++) {
+    assert(vec_equal(body_get_velocity(bodies[i]), VEC_ZERO));
+  }
+  // The source isn't pulled by its own field
+  assert(vec_equal(body_get_velocity(source), VEC_ZERO));
+  assert(record.kills == 1);
+  assert(record.body == killed);
+  assert(record.source == source);
+
+  // Once the pulled body is in another layer, the field lets it go
+  body_set_layer(pulled, 1);
+  vector_t velocity = body_get_velocity(pulled);
+  scene_tick(scene, 0.01);
+  assert(vec_isclose(body_get_velocity(pulled), velocity));
+  assert(record.kills == 2);
+  scene_free(scene);
+}
+
+void remove_first_body(body_t *body1, body_t *body2, vector_t axis,
+                       void *aux) {
+  body_remove(body1);
+}
+
+void test_radial_kill_skips_removed() {
+  scene_t *scene = scene_init();
+  body_t *hole = body_init(make_box(VEC_ZERO, 5, 5), 1, TEST_COLOR);
+  body_t *player = body_init(make_box((vector_t){5, 0}, 5, 5), 1, TEST_COLOR);
+  scene_add_body(scene, hole);
+  scene_add_body(scene, player);
+  size_t kills = 0;
+  radial_field_t field = {
+      .radius = 100, .strength = 10, .kill_radius = 50, .layers = 1};
+  scene_add_radial_field(scene, hole, field, count_collision, &kills, NULL,
+                         NULL);
+  // A collision handler removes the player first, in the same tick
+  create_collision(scene, player, hole, remove_first_body, NULL, NULL);
+  scene_tick(scene, 0.01);
+  assert(kills == 0);
+  scene_free(scene);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_contact_boxes_bounce)
+  DO_TEST(test_collision_stats_cull)
+  DO_TEST(test_snapshot_round_trip)
+  DO_TEST(test_snapshot_needs_copier)
+  DO_TEST(test_integrator_energy_drift)
+  DO_TEST(test_integrator_stages_rerun_pure_creators)
+  DO_TEST(test_radial_field)
+  DO_TEST(test_radial_kill_skips_removed)
+
+  puts("scene_test PASS");
+}
@@ -0,0 +1,99 @@
+#include "rng.h"
+#include "spatial_hash.h"
+#include "test_util.h"
+#include <assert.h>
+#include <stdlib.h>
+
+#define NUM_POINTS 500
+
+/** Counts how many times a query visited each point */
+void count_visit(size_t index, void *aux) { ((size_t *)aux)[index]++; }
+
+/**
+ * Checks that a query visits exactly the points within the radius,
+ * each once, by testing every point
+ */
+void check_query(spatial_hash_t *hash, vector_t *points, vector_t center,
+                 double radius) {
+  size_t visits[NUM_POINTS];
+  for (size_t i = 0; i < NUM_POINTS; i++) {
+    visits[i] = 0;
+  }
+  size_t visited = spatial_hash_query(hash, center, radius, count_visit, visits);
+  size_t expected = 0;
+  for (size_t i = 0; i < NUM_POINTS; i++) {
+    vector_t offset = vec_subtract(points[i], center);
+    bool inside = vec_dot(offset, offset) <= radius * radius;
+    assert(visits[i] == (inside ? 1 : 0));
+    expected += inside;
+  }
+  assert(visited == expected);
+}
+
+void check_queries_match_brute_force(double spread, double cell_size) {
+  rng_t rng;
+  rng_seed(&rng, 1);
+  vector_t points[NUM_POINTS];
+  for (size_t i = 0; i < NUM_POINTS; i++) {
+    points[i] = (vector_t){rng_between(&rng, -spread, spread),
+                           rng_between(&rng, -spread, spread)};
+  }
+  spatial_hash_t *hash = spatial_hash_init();
+  spatial_hash_build(hash, points, NUM_POINTS, cell_size);
+  // Radii around the cell size search a few cells; the largest cover more
+  // cells than there are points, so every point is checked instead
+  double radii[] = {0, cell_size / 2, cell_size, 3 * cell_size, 4 * spread};
+  for (size_t r = 0; r < sizeof(radii) / sizeof(radii[0]); r++) {
+    for (size_t q = 0; q < 50; q++) {
+      vector_t center = {rng_between(&rng, -spread, spread),
+                         rng_between(&rng, -spread, spread)};
+      check_query(hash, points, center, radii[r]);
+    }
+    // Centered on a point, which is always found
+    check_query(hash, points, points[r], radii[r]);
+  }
+  spatial_hash_free(hash);
+}
+
+void test_query_matches_brute_force() {
+  // Dense: many points per cell
+  check_queries_match_brute_force(100, 20);
+  // Sparse: far more cells than buckets, so cells share buckets
+  check_queries_match_brute_force(10000, 5);
+}
+
+void test_rebuild() {
+  vector_t points[NUM_POINTS];
+  for (size_t i = 0; i < NUM_POINTS; i++) {
+    points[i] = (vector_t){i, -(double)i};
+  }
+  spatial_hash_t *hash = spatial_hash_init();
+  // Grows from a few points to all of them, then shrinks again
+  size_t counts[] = {3, NUM_POINTS, 10};
+  for (size_t c = 0; c < 3; c++) {
+    spatial_hash_build(hash, points, counts[c], 10);
+    size_t visits[NUM_POINTS] = {0};
+    size_t visited = spatial_hash_query(hash, (vector_t){1000, -1000}, 3000,
+                                        count_visit, visits);
+    assert(visited == counts[c]);
+    for (size_t i = 0; i < NUM_POINTS; i++) {
+      assert(visits[i] == (i < counts[c] ? 1 : 0));
+    }
+  }
+  spatial_hash_free(hash);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_query_matches_brute_force)
+  DO_TEST(test_rebuild)
+
+  puts("spatial_hash_test PASS");
+}